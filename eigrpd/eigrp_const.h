@@ -45,10 +45,54 @@
 #define EIGRP_PACKET_RETRANS_MAX         16 /* number of retrans attempts */
 #define PLAINTEXT_LENGTH                 81
 
+/*Output scheduling: packets per send call and per write thread wakeup*/
+#define EIGRP_WRITE_BATCH                16
+#define EIGRP_WRITE_BUDGET               64
+
+/*Input processing: datagrams per receive call and per read thread wakeup*/
+#define EIGRP_READ_BATCH                 16
+#define EIGRP_READ_BUDGET                64
+#define EIGRP_READ_BUDGET_MSEC           20
+
+/*Stub routing, route types stub router advertises*/
+#define EIGRP_STUB_CONNECTED             0x0001
+#define EIGRP_STUB_STATIC                0x0002
+#define EIGRP_STUB_SUMMARY               0x0004
+#define EIGRP_STUB_RECEIVE_ONLY          0x0008
+#define EIGRP_STUB_REDISTRIBUTED         0x0010
+#define EIGRP_STUB_LEAKMAP               0x0020
+#define EIGRP_STUB_DEFAULT               (EIGRP_STUB_CONNECTED | EIGRP_STUB_SUMMARY)
+
 /*Metric variance multiplier*/
 #define EIGRP_VARIANCE_DEFAULT  1
 #define EIGRP_MAX_PATHS_DEFAULT 4
 
+/*Active timer, in minutes, 0 if disabled. SIA-Query goes out each half
+  of it, neighbor not answering one is reset*/
+#define EIGRP_ACTIVE_TIME_DEFAULT        3
+#define EIGRP_SIA_QUERY_MAX              3
+
+/*Timer wheel of active routes, one tick per second, each level has
+  EIGRP_WHEEL_SLOTS slots spanning EIGRP_WHEEL_SLOTS times more ticks*/
+#define EIGRP_WHEEL_BITS                 6
+#define EIGRP_WHEEL_SLOTS                (1 << EIGRP_WHEEL_BITS)
+#define EIGRP_WHEEL_LEVELS               4
+
+/*Redistribution, delay collecting burst of routes from zebra and number
+  of routes originated at once before other threads get their turn*/
+#define EIGRP_EXTERNAL_DELAY_MSEC        50
+#define EIGRP_EXTERNAL_BATCH             2000
+
+/*Topology objects carved from one pool slab and chunk size of arena
+  holding decoded TLVs of one received packet*/
+#define EIGRP_POOL_SLAB_OBJECTS          256
+#define EIGRP_PACKET_ARENA_SIZE          8192
+
+/*Graceful restart resync, delay of next chunk grows with number of packets
+  waiting in neighbor retransmit queue*/
+#define EIGRP_GR_PACE_MSEC               10
+#define EIGRP_GR_PACE_MAX_MSEC           500
+
 
 /* Return values of functions involved in packet verification */
 #define MSG_OK    0
@@ -93,10 +137,20 @@
 #define EIGRP_DELAY_DEFAULT                 1000
 #define EIGRP_RELIABILITY_DEFAULT           255
 #define EIGRP_LOAD_DEFAULT                  1
+#define EIGRP_BANDWIDTH_PERCENT_DEFAULT     50
 
 #define EIGRP_MULTICAST_ADDRESS            0xe000000A /*224.0.0.10*/
 
 #define EIGRP_MAX_METRIC                   0xffffffffU    /*4294967295*/
+#define EIGRP_MAX_DISTANCE                 0xffffffffffffffffULL /* unreachable */
+
+/* Wide (64-bit) metrics, RFC 7868 */
+#define EIGRP_MAX_WIDE_VALUE               0xffffffffffffULL /* 48-bit delay and bandwidth */
+#define EIGRP_WIDE_SCALE                   65536ULL
+#define EIGRP_WIDE_BANDWIDTH               10000000ULL    /* throughput scale, kbps */
+#define EIGRP_WIDE_DELAY_PICO              1000000ULL     /* latency scale, picoseconds */
+#define EIGRP_WIDE_DELAY_UNIT              10000000ULL    /* picoseconds in delay unit of 10us */
+#define EIGRP_RIB_SCALE                    128            /* wide distance to 32-bit RIB metric */
 
 #define DEFAULT_ROUTE               ZEBRA_ROUTE_MAX
 #define DEFAULT_ROUTE_TYPE(T) ((T) == DEFAULT_ROUTE)
@@ -125,6 +179,9 @@
 #define EIGRP_TOPOLOGY_TYPE_CONNECTED           0 // Connected network
 #define EIGRP_TOPOLOGY_TYPE_REMOTE              1 // Remote internal network
 #define EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL     2 // Remote external network
+#define EIGRP_TOPOLOGY_TYPE_SUMMARY             3 // Interface summary address
+
+#define EIGRP_SUMMARY_DISTANCE                  5 // Administrative distance of summary discard route
 
 /*EIGRP TT entry flags*/
 #define EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG     1
@@ -146,6 +203,7 @@
 /*EIGRP FSM events return values*/
 #define EIGRP_FSM_NEED_UPDATE				1
 #define EIGRP_FSM_NEED_QUERY				2
+#define EIGRP_FSM_NEED_RIB				4
 
 /*EIGRP FSM events*/
 #define EIGRP_FSM_EVENT_NQ_FCN                  0 /*input event other than query from succ, FC not satisfied*/
@@ -257,6 +315,8 @@
 #define EIGRP_TLV_SEQ_BASE_LEN          (5U)
 #define EIGRP_TLV_SW_VERSION            (EIGRP_TLV_GENERAL | 0x0004)    /*!< software version */
 #define EIGRP_TLV_SW_VERSION_LEN        (8U)
+#define EIGRP_TLV_STUB                  (EIGRP_TLV_GENERAL | 0x0006)    /*!< stub routing */
+#define EIGRP_TLV_STUB_LEN              (6U)
 #define EIGRP_TLV_NEXT_MCAST_SEQ        (EIGRP_TLV_GENERAL | 0x0005)    /*!< sequence number */
 #define EIGRP_TLV_PEER_TERMINATION      (EIGRP_TLV_GENERAL | 0x0007)    /*!< peer termination */
 #define EIGRP_TLV_PEER_TERMINATION_LEN 	(9U)
@@ -279,9 +339,32 @@
 #define EIGRP_TLV_IPv4_EXT              (EIGRP_TLV_IPv4 | EIGRP_TLV_EXTERNAL)
 #define EIGRP_TLV_IPv4_COM              (EIGRP_TLV_IPv4 | EIGRP_TLV_COMMUNITY)
 
+#define EIGRP_TLV_MP_INT                (EIGRP_TLV_MP | EIGRP_TLV_INTERNAL)
+#define EIGRP_TLV_MP_EXT                (EIGRP_TLV_MP | EIGRP_TLV_EXTERNAL)
+
+/* TLV carrying route, classic or multi-protocol */
+#define EIGRP_TLV_IS_ROUTE(T) \
+  ((T) == EIGRP_TLV_IPv4_INT || (T) == EIGRP_TLV_IPv4_EXT \
+   || (T) == EIGRP_TLV_MP_INT || (T) == EIGRP_TLV_MP_EXT)
+
+/* Multi-protocol address family of IPv4 */
+#define EIGRP_AF_IPv4                   1
+
 /* max number of TLV IPv4 prefixes in packet */
 #define EIGRP_TLV_MAX_IPv4				25
 
+/* IPv4 internal TLV without destinations: header, next hop and metric */
+#define EIGRP_TLV_IPv4_INT_FIXED_LEN	(24U)
+
+/* IPv4 external TLV without destination: also originator and external data */
+#define EIGRP_TLV_IPv4_EXT_FIXED_LEN	(44U)
+
+/* 2.0 TLV without destination: header, topology, family, router id,
+ * wide metric, (external data) and next hop */
+#define EIGRP_TLV_WIDE_METRIC_LEN		(24U)
+#define EIGRP_TLV_MP_INT_FIXED_LEN		(40U)
+#define EIGRP_TLV_MP_EXT_FIXED_LEN		(60U)
+
 /**
  *
  * extdata flag field definitions
@@ -429,4 +512,9 @@
 #define EIGRP_FILTER_OUT 1
 #define EIGRP_FILTER_MAX 2
 
+/* cached outbound filter verdicts */
+#define EIGRP_FILTER_UNKNOWN 0
+#define EIGRP_FILTER_PERMIT  1
+#define EIGRP_FILTER_DENY    2
+
 #endif /* _ZEBRA_EIGRP_CONST_H_ */
@@ -448,18 +448,25 @@ show_ip_eigrp_prefix_entry (struct vty *vty, struct eigrp_prefix_entry *tn)
   vty_out (vty, "%-3c",(tn->state > 0) ? 'A' : 'P');
   vty_out (vty, "%s/%u, ",inet_ntoa (tn->destination_ipv4->prefix),tn->destination_ipv4->prefixlen);
   vty_out (vty, "%u successors, ",eigrp_topology_get_successor(tn)->count);
-  vty_out (vty, "FD is %u, serno: %lu %s",tn->fdistance, tn->serno, VTY_NEWLINE);
+  vty_out (vty, "FD is %llu, serno: %lu %s",(unsigned long long) tn->fdistance, tn->serno, VTY_NEWLINE);
 
 }
 
 void
 show_ip_eigrp_neighbor_entry (struct vty *vty, struct eigrp *eigrp, struct eigrp_neighbor_entry *te)
 {
-  if (te->adv_router == eigrp->neighbor_self)
+  if (te->prefix->nt == EIGRP_TOPOLOGY_TYPE_SUMMARY)
+    vty_out (vty, "%-7s%s (%llu/%llu), %s%s"," ","via Summary",(unsigned long long) te->distance, (unsigned long long) te->reported_distance, "Null0", VTY_NEWLINE);
+  else if (te->adv_router == eigrp->neighbor_self
+           && te->prefix->nt == EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL)
+    vty_out (vty, "%-7s%s (%llu/%llu)%s"," ","via Redistributed",(unsigned long long) te->distance, (unsigned long long) te->reported_distance, VTY_NEWLINE);
+  else if (te->adv_router == eigrp->neighbor_self)
     vty_out (vty, "%-7s%s, %s%s"," ","via Connected",eigrp_if_name_string (te->ei), VTY_NEWLINE);
+  else if (te->adv_router == NULL)
+    vty_out (vty, "%-7s%s (%llu/%llu)%s"," ","via neighbor down",(unsigned long long) te->distance, (unsigned long long) te->reported_distance, VTY_NEWLINE);
   else
     {
-      vty_out (vty, "%-7s%s%s (%u/%u), %s%s"," ","via ",inet_ntoa (te->adv_router->src),te->distance, te->reported_distance, eigrp_if_name_string (te->ei), VTY_NEWLINE);
+      vty_out (vty, "%-7s%s%s (%llu/%llu), %s%s"," ","via ",inet_ntoa (te->adv_router->src),(unsigned long long) te->distance, (unsigned long long) te->reported_distance, eigrp_if_name_string (te->ei), VTY_NEWLINE);
     }
 }
 
@@ -0,0 +1,387 @@
+/*
+ * EIGRP Redistributed (External) Route Functions.
+ * Copyright (C) 2013-2016
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *   Frantisek Gazo
+ *   Tomas Hvorkovy
+ *   Martin Kontsek
+ *   Lukas Koribsky
+ *
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+
+#include "thread.h"
+#include "prefix.h"
+#include "table.h"
+#include "linklist.h"
+#include "memory.h"
+#include "log.h"
+#include "routemap.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_const.h"
+#include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_network.h"
+#include "eigrpd/eigrp_zebra.h"
+#include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_external.h"
+
+extern struct thread_master *master;
+
+/*
+ * Routes redistributed from zebra are kept in process wide table, one
+ * record per prefix, so a burst of adds and deletes for same prefix
+ * collapses into its last state. Changed records wait in queue, which
+ * is processed by timer in batches: each batch applies route-maps,
+ * originates or withdraws external prefix entries and then runs single
+ * batch flush, so routes of whole batch are packed into few updates.
+ */
+
+static struct eigrp_external *
+eigrp_external_new (struct prefix_ipv4 *p)
+{
+  struct eigrp_external *new;
+
+  new = XCALLOC (MTYPE_EIGRP_EXTERNAL, sizeof (struct eigrp_external));
+  new->prefix = *p;
+
+  return new;
+}
+
+static void
+eigrp_external_free (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct route_node *rn;
+
+  rn = route_node_lookup (eigrp->externals, (struct prefix *) &ext->prefix);
+  if (rn)
+    {
+      rn->info = NULL;
+      route_unlock_node (rn); /* route_node_lookup reference */
+      route_unlock_node (rn); /* initial reference */
+    }
+
+  XFREE (MTYPE_EIGRP_EXTERNAL, ext);
+}
+
+/* Source protocol as carried in external TLV */
+static u_char
+eigrp_external_protocol (int type)
+{
+  switch (type)
+    {
+    case ZEBRA_ROUTE_CONNECT:
+      return CONN_PROTID;
+    case ZEBRA_ROUTE_STATIC:
+      return STATIC_PROTID;
+    case ZEBRA_ROUTE_RIP:
+      return RIP_PROTID;
+    case ZEBRA_ROUTE_OSPF:
+      return OSPF_PROTID;
+    case ZEBRA_ROUTE_ISIS:
+      return ISIS_PROTID;
+    case ZEBRA_ROUTE_BGP:
+      return BGP_PROTID;
+    default:
+      return NULL_PROTID;
+    }
+}
+
+/*
+ * Withdraw originated route, it is advertised as unreachable and removed
+ * from topology table by the next RIB flush. If neighbors advertise the
+ * prefix too, their routes are kept.
+ */
+static void
+eigrp_external_withdraw (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct eigrp_prefix_entry *pe = ext->pe;
+  struct eigrp_neighbor_entry *ne;
+
+  if (pe == NULL)
+    return;
+  ext->pe = NULL;
+
+  ne = eigrp_prefix_entry_lookup (pe->entries, eigrp->neighbor_self);
+  if (ne && listcount (pe->entries) > 1)
+    {
+      eigrp_neighbor_entry_delete (pe, ne);
+      eigrp_IPv4_ExternalTLV_free (pe->extTLV);
+      pe->extTLV = NULL;
+      pe->nt = EIGRP_TOPOLOGY_TYPE_REMOTE;
+
+      ne = listnode_head (pe->entries);
+      pe->distance = pe->fdistance = pe->rdistance = ne->distance;
+      pe->reported_metric = ne->total_metric;
+      eigrp_topology_update_node_flags (pe);
+      eigrp_topology_change_add (eigrp, pe,
+                                 EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_RIB);
+      return;
+    }
+
+  pe->distance = pe->fdistance = pe->rdistance = EIGRP_MAX_DISTANCE;
+  pe->reported_metric.delay = EIGRP_MAX_METRIC;
+  if (ne)
+    ne->distance = EIGRP_MAX_DISTANCE;
+  eigrp_topology_change_add (eigrp, pe,
+                             EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_RIB);
+}
+
+/*
+ * Originate external route with metric configured for its source, or
+ * refresh it if metric or external data changed
+ */
+static void
+eigrp_external_originate (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct eigrp_prefix_entry *pe = ext->pe;
+  struct eigrp_neighbor_entry *ne;
+  struct TLV_IPv4_External_type *data;
+  struct eigrp_metrics *metric = &eigrp->dmetric[ext->type];
+  u_int64_t distance = eigrp_calculate_metrics (eigrp, metric);
+  u_char protocol = eigrp_external_protocol (ext->type);
+
+  if (pe == NULL)
+    {
+      /* prefix known to EIGRP already (connected, summary or learned)
+       * is advertised as it is */
+      if (eigrp_topology_table_lookup_ipv4 (eigrp->topology_table,
+                                            &ext->prefix) != NULL)
+        return;
+
+      pe = eigrp_prefix_entry_new ();
+      pe->serno = ++eigrp->serno;
+      pe->destination_ipv4 = prefix_ipv4_new ();
+      *pe->destination_ipv4 = ext->prefix;
+      pe->af = AF_INET;
+      pe->nt = EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL;
+      pe->state = EIGRP_FSM_STATE_PASSIVE;
+      pe->extTLV = eigrp_IPv4_ExternalTLV_new ();
+      eigrp_prefix_entry_add (eigrp->topology_table, pe);
+
+      ne = eigrp_neighbor_entry_new ();
+      ne->adv_router = eigrp->neighbor_self;
+      ne->reported_distance = 0;
+      ne->flags = EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG;
+      ne->prefix = pe;
+      eigrp_neighbor_entry_add (pe, ne);
+
+      ext->pe = pe;
+    }
+  else if (pe->distance == distance
+           && eigrp_metrics_is_same (&pe->reported_metric, metric)
+           && pe->extTLV->originating_router.s_addr == eigrp->router_id
+           && pe->extTLV->administrative_tag == ext->tag
+           && pe->extTLV->external_metric == ext->metric
+           && pe->extTLV->external_protocol == protocol)
+    return;
+
+  data = pe->extTLV;
+  data->originating_router.s_addr = eigrp->router_id;
+  data->originating_as = eigrp->AS;
+  data->administrative_tag = ext->tag;
+  data->external_metric = ext->metric;
+  data->external_protocol = protocol;
+  data->external_flags = 0;
+  data->next_hop.s_addr = 0;
+
+  pe->distance = pe->fdistance = pe->rdistance = distance;
+  pe->reported_metric = *metric;
+  if ((ne = eigrp_prefix_entry_lookup (pe->entries, eigrp->neighbor_self)))
+    {
+      ne->distance = distance;
+      ne->total_metric = *metric;
+      ne->reported_metric = *metric;
+    }
+  eigrp_topology_change_add (eigrp, pe, EIGRP_FSM_NEED_UPDATE);
+}
+
+static void
+eigrp_external_process (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct route_map *map;
+
+  /* zebra doesn't withdraw routes when redistribution is turned off */
+  if (ext->deleted || !eigrp_is_type_redistributed (ext->type))
+    {
+      eigrp_external_withdraw (eigrp, ext);
+      eigrp_external_free (eigrp, ext);
+      return;
+    }
+
+  ext->tag = 0;
+  map = eigrp->route_map[ext->type].map;
+  if (map && route_map_apply (map, (struct prefix *) &ext->prefix,
+                              RMAP_EIGRP, ext) == RMAP_DENYMATCH)
+    {
+      eigrp_external_withdraw (eigrp, ext);
+      return;
+    }
+
+  eigrp_external_originate (eigrp, ext);
+}
+
+static int
+eigrp_external_timer (struct thread *thread)
+{
+  struct eigrp *eigrp = THREAD_ARG (thread);
+  struct listnode *node;
+  struct eigrp_external *ext;
+  int count = 0;
+
+  eigrp->t_external = NULL;
+
+  while (count++ < EIGRP_EXTERNAL_BATCH
+         && (node = listhead (eigrp->externals_queue)) != NULL)
+    {
+      ext = listgetdata (node);
+      list_delete_node (eigrp->externals_queue, node);
+      ext->queued = 0;
+      eigrp_external_process (eigrp, ext);
+    }
+
+  /* whole batch goes out at once */
+  eigrp_fsm_batch_flush (eigrp, NULL);
+
+  /* rest waits behind packets and timers already pending */
+  if (!list_isempty (eigrp->externals_queue))
+    eigrp->t_external = thread_add_event (master, eigrp_external_timer,
+                                          eigrp, 0);
+
+  return 0;
+}
+
+static void
+eigrp_external_queue (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  if (!ext->queued)
+    {
+      listnode_add (eigrp->externals_queue, ext);
+      ext->queued = 1;
+    }
+
+  if (eigrp->t_external == NULL)
+    eigrp->t_external = thread_add_timer_msec (master, eigrp_external_timer,
+                                               eigrp, EIGRP_EXTERNAL_DELAY_MSEC);
+}
+
+/*
+ * Route of given type was added or changed in zebra
+ */
+void
+eigrp_external_add (struct eigrp *eigrp, int type, struct prefix_ipv4 *p,
+                    struct in_addr nexthop, unsigned int ifindex,
+                    u_int32_t metric)
+{
+  struct route_node *rn;
+  struct eigrp_external *ext;
+
+  rn = route_node_get (eigrp->externals, (struct prefix *) p);
+  if (rn->info)
+    {
+      route_unlock_node (rn);
+      ext = rn->info;
+    }
+  else
+    rn->info = ext = eigrp_external_new (p);
+
+  ext->type = type;
+  ext->nexthop = nexthop;
+  ext->ifindex = ifindex;
+  ext->metric = metric;
+  ext->deleted = 0;
+
+  eigrp_external_queue (eigrp, ext);
+}
+
+/*
+ * Route of given type was deleted from zebra
+ */
+void
+eigrp_external_delete (struct eigrp *eigrp, int type, struct prefix_ipv4 *p)
+{
+  struct route_node *rn;
+  struct eigrp_external *ext;
+
+  rn = route_node_lookup (eigrp->externals, (struct prefix *) p);
+  if (rn == NULL)
+    return;
+  route_unlock_node (rn);
+
+  /* route of other type may have replaced it meanwhile */
+  ext = rn->info;
+  if (ext->type != type)
+    return;
+
+  ext->deleted = 1;
+  eigrp_external_queue (eigrp, ext);
+}
+
+/*
+ * Reevaluate all routes of given type, after metric, route-map or
+ * redistribution itself changed
+ */
+void
+eigrp_external_routes_refresh (struct eigrp *eigrp, int type)
+{
+  struct route_node *rn;
+  struct eigrp_external *ext;
+
+  for (rn = route_top (eigrp->externals); rn; rn = route_next (rn))
+    {
+      if ((ext = rn->info) == NULL || ext->type != type)
+        continue;
+
+      eigrp_external_queue (eigrp, ext);
+    }
+}
+
+/*
+ * Free all externals, topology table entries are left to topology cleanup
+ */
+void
+eigrp_external_free_all (struct eigrp *eigrp)
+{
+  struct route_node *rn;
+
+  THREAD_OFF (eigrp->t_external);
+  list_delete (eigrp->externals_queue);
+
+  for (rn = route_top (eigrp->externals); rn; rn = route_next (rn))
+    {
+      if (rn->info == NULL)
+        continue;
+
+      XFREE (MTYPE_EIGRP_EXTERNAL, rn->info);
+      rn->info = NULL;
+      route_unlock_node (rn);
+    }
+
+  route_table_finish (eigrp->externals);
+}
@@ -70,6 +70,8 @@ eigrp_distribute_update (struct distribute *dist)
   struct prefix_list *plist;
   struct route_map *routemap;
   struct eigrp *e;
+  struct access_list *old_alist;
+  struct prefix_list *old_plist;
 
   /* if no interface address is present, set list to eigrp process struct */
   e = eigrp_lookup();
@@ -77,6 +79,9 @@ eigrp_distribute_update (struct distribute *dist)
   /* Check if distribute-list was set for process or interface */
   if (! dist->ifname)
     {
+	  old_alist = e->list[EIGRP_FILTER_IN];
+	  old_plist = e->prefix[EIGRP_FILTER_IN];
+
 	  /* access list IN for whole process */
 	  if (dist->list[DISTRIBUTE_IN])
 	    {
@@ -165,7 +170,12 @@ eigrp_distribute_update (struct distribute *dist)
 		  e->routemap[EIGRP_FILTER_OUT] = NULL;
 		}
 
-	   //TODO: check Graceful restart after 10sec
+	   /* received routes can be refiltered only by resync from neighbors,
+	    * outbound changes are sent as delta */
+	   if (old_alist != e->list[EIGRP_FILTER_IN]
+	       || old_plist != e->prefix[EIGRP_FILTER_IN])
+	     e->filter_resync = 1;
+	   eigrp_filter_invalidate_all(e);
 
 	   /* check if there is already GR scheduled */
 	   if(e->t_distribute != NULL)
@@ -173,7 +183,7 @@ eigrp_distribute_update (struct distribute *dist)
 		   /* if is, cancel schedule */
 		   thread_cancel(e->t_distribute);
 	   }
-	   /* schedule Graceful restart for whole process in 10sec */
+	   /* schedule filter update for whole process in 10sec */
 	   e->t_distribute = thread_add_timer(master, eigrp_distribute_timer_process, e,(10));
 
 	  return;
@@ -189,6 +199,7 @@ eigrp_distribute_update (struct distribute *dist)
   ei = info->eigrp_interface;*/
   struct listnode *node, *nnode;
   struct eigrp_interface *ei2;
+  ei = NULL;
   /* Find proper interface */
   for (ALL_LIST_ELEMENTS (e->eiflist, node, nnode, ei2))
   {
@@ -201,8 +212,12 @@ eigrp_distribute_update (struct distribute *dist)
   if(ei == NULL)
   {
 	  zlog_info("Not Found eigrp interface %s",ifp->name);
+	  return;
   }
 
+  old_alist = ei->list[EIGRP_FILTER_IN];
+  old_plist = ei->prefix[EIGRP_FILTER_IN];
+
   /* Access-list for interface in */
   if (dist->list[DISTRIBUTE_IN])
     {
@@ -288,7 +303,10 @@ eigrp_distribute_update (struct distribute *dist)
 	  ei->routemap[EIGRP_FILTER_OUT] = NULL;
 	}
 
-  //TODO: check Graceful restart after 10sec
+  if (old_alist != ei->list[EIGRP_FILTER_IN]
+      || old_plist != ei->prefix[EIGRP_FILTER_IN])
+    ei->filter_resync = 1;
+  ei->filter_generation++;
 
   /* check if there is already GR scheduled */
   if(ei->t_distribute != NULL)
@@ -296,8 +314,8 @@ eigrp_distribute_update (struct distribute *dist)
 	  /* if is, cancel schedule */
 	  thread_cancel(ei->t_distribute);
   }
-  /* schedule Graceful restart for interface in 10sec */
-  e->t_distribute = thread_add_timer(master, eigrp_distribute_timer_interface, ei,(10));
+  /* schedule filter update for interface in 10sec */
+  ei->t_distribute = thread_add_timer(master, eigrp_distribute_timer_interface, ei,(10));
 
 }
 
@@ -322,6 +340,24 @@ eigrp_distribute_update_all (struct prefix_list *notused)
 {
   struct interface *ifp;
   struct listnode *node, *nnode;
+  struct eigrp_interface *ei;
+  struct eigrp *e;
+
+  /* list content changed, cached verdicts of the process are stale */
+  e = eigrp_lookup();
+  if (e)
+    {
+      if (e->list[EIGRP_FILTER_IN] || e->prefix[EIGRP_FILTER_IN])
+        e->filter_resync = 1;
+      for (ALL_LIST_ELEMENTS (e->eiflist, node, nnode, ei))
+        if (ei->list[EIGRP_FILTER_IN] || ei->prefix[EIGRP_FILTER_IN])
+          ei->filter_resync = 1;
+      eigrp_filter_invalidate_all(e);
+
+      if (e->t_distribute != NULL)
+        thread_cancel(e->t_distribute);
+      e->t_distribute = thread_add_timer(master, eigrp_distribute_timer_process, e,(10));
+    }
 
   for (ALL_LIST_ELEMENTS (eigrp_om->iflist, node, nnode, ifp))
     eigrp_distribute_update_interface (ifp);
@@ -344,19 +380,40 @@ eigrp_distribute_update_all_wrapper(struct access_list *notused)
  * @return int	always returns 0
  *
  * @par
- * Called when 10sec waiting time expire and
- * executes Graceful restart for whole process
+ * Called when 10sec waiting time expire. Executes Graceful restart
+ * for whole process if inbound filter changed, otherwise sends only
+ * prefixes whose outbound verdict changed.
  */
 int
 eigrp_distribute_timer_process (struct thread *thread)
 {
 	struct eigrp *eigrp;
+	struct listnode *node, *nnode;
+	struct eigrp_interface *ei;
 
 	eigrp = THREAD_ARG(thread);
 	eigrp->t_distribute = NULL;
 
-	/* execute GR for whole process */
-	eigrp_update_send_process_GR(eigrp, EIGRP_GR_FILTER, NULL);
+	if (eigrp->filter_resync)
+	{
+		/* execute GR for whole process */
+		eigrp->filter_resync = 0;
+		for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
+			ei->filter_resync = 0;
+		eigrp_update_send_process_GR(eigrp, EIGRP_GR_FILTER, NULL);
+		return 0;
+	}
+
+	for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
+	{
+		if (ei->filter_resync)
+		{
+			ei->filter_resync = 0;
+			eigrp_update_send_interface_GR(ei, EIGRP_GR_FILTER, NULL);
+		}
+		else
+			eigrp_update_send_filter_delta(ei);
+	}
 
 	return 0;
 }
@@ -369,8 +426,9 @@ eigrp_distribute_timer_process (struct thread *thread)
  * @return int	always returns 0
  *
  * @par
- * Called when 10sec waiting time expire and
- * executes Graceful restart for interface
+ * Called when 10sec waiting time expire. Executes Graceful restart
+ * for interface if its inbound filter changed, otherwise sends only
+ * prefixes whose outbound verdict changed.
  */
 int
 eigrp_distribute_timer_interface (struct thread *thread)
@@ -380,8 +438,184 @@ eigrp_distribute_timer_interface (struct thread *thread)
 	ei = THREAD_ARG(thread);
 	ei->t_distribute = NULL;
 
-	/* execute GR for interface */
-	eigrp_update_send_interface_GR(ei, EIGRP_GR_FILTER, NULL);
+	if (ei->filter_resync)
+	{
+		/* execute GR for interface */
+		ei->filter_resync = 0;
+		eigrp_update_send_interface_GR(ei, EIGRP_GR_FILTER, NULL);
+	}
+	else
+		eigrp_update_send_filter_delta(ei);
 
 	return 0;
 }
+
+/*
+ * Evaluate outbound access-lists and prefix-lists of process and
+ * interface for prefix.
+ */
+static u_char
+eigrp_filter_out_apply (struct eigrp_interface *ei, struct prefix_ipv4 *p)
+{
+  struct eigrp *e = ei->eigrp;
+  struct access_list *alist;
+  struct prefix_list *plist;
+
+  alist = e->list[EIGRP_FILTER_OUT];
+  if (alist && access_list_apply (alist, (struct prefix *) p) == FILTER_DENY)
+    return EIGRP_FILTER_DENY;
+  plist = e->prefix[EIGRP_FILTER_OUT];
+  if (plist && prefix_list_apply (plist, (struct prefix *) p) == PREFIX_DENY)
+    return EIGRP_FILTER_DENY;
+  alist = ei->list[EIGRP_FILTER_OUT];
+  if (alist && access_list_apply (alist, (struct prefix *) p) == FILTER_DENY)
+    return EIGRP_FILTER_DENY;
+  plist = ei->prefix[EIGRP_FILTER_OUT];
+  if (plist && prefix_list_apply (plist, (struct prefix *) p) == PREFIX_DENY)
+    return EIGRP_FILTER_DENY;
+
+  return EIGRP_FILTER_PERMIT;
+}
+
+/*
+ * @fn eigrp_filter_out
+ *
+ * @param[in]		ei		interface prefix is advertised on
+ * @param[in]		pe		prefix to check
+ * @param[out]		prev	verdict cached before this call, EIGRP_FILTER_UNKNOWN
+ * 							if prefix was not checked on interface yet
+ *
+ * @return u_char	EIGRP_FILTER_PERMIT or EIGRP_FILTER_DENY
+ *
+ * @par
+ * Outbound filter verdict for prefix on interface. Verdicts are cached
+ * per interface and stay valid until filter generation of interface
+ * changes, so lists are evaluated only once per prefix and filter change.
+ */
+u_char
+eigrp_filter_out (struct eigrp_interface *ei, struct eigrp_prefix_entry *pe,
+                  u_char *prev)
+{
+  struct eigrp_filter_verdict *v;
+  struct route_node *rn;
+
+  if (ei->filter_cache == NULL)
+    ei->filter_cache = route_table_init();
+
+  rn = route_node_get(ei->filter_cache, (struct prefix *) pe->destination_ipv4);
+  if (rn->info)
+    {
+      /* node is held by its verdict already */
+      route_unlock_node(rn);
+      v = rn->info;
+      if (prev)
+        *prev = v->verdict;
+      if (v->generation == ei->filter_generation)
+        return v->verdict;
+    }
+  else
+    {
+      v = XCALLOC(MTYPE_EIGRP_FILTER_VERDICT, sizeof(struct eigrp_filter_verdict));
+      rn->info = v;
+      if (prev)
+        *prev = EIGRP_FILTER_UNKNOWN;
+    }
+
+  v->generation = ei->filter_generation;
+  v->verdict = eigrp_filter_out_apply(ei, pe->destination_ipv4);
+
+  return v->verdict;
+}
+
+/*
+ * @fn eigrp_filter_out_peek
+ *
+ * @param[in]		ei		interface prefix is advertised on
+ * @param[in]		pe		prefix to check
+ *
+ * @return u_char	EIGRP_FILTER_PERMIT or EIGRP_FILTER_DENY
+ *
+ * @par
+ * Outbound filter verdict for single neighbor on interface (initial
+ * update, resync).  Cached verdict is used while it is current, but
+ * stale one is not refreshed: it is what the other neighbors on
+ * interface were told, eigrp_update_send_filter_delta() still has to
+ * correct them.
+ */
+u_char
+eigrp_filter_out_peek (struct eigrp_interface *ei, struct eigrp_prefix_entry *pe)
+{
+  struct eigrp_filter_verdict *v;
+  struct route_node *rn;
+
+  if (ei->filter_cache)
+    {
+      rn = route_node_lookup(ei->filter_cache,
+                             (struct prefix *) pe->destination_ipv4);
+      if (rn)
+        {
+          v = rn->info;
+          route_unlock_node(rn);
+          if (v && v->generation == ei->filter_generation)
+            return v->verdict;
+        }
+    }
+
+  return eigrp_filter_out_apply(ei, pe->destination_ipv4);
+}
+
+/* Process wide lists changed, no cached verdict is valid anymore */
+void
+eigrp_filter_invalidate_all (struct eigrp *eigrp)
+{
+  struct listnode *node;
+  struct eigrp_interface *ei;
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    ei->filter_generation++;
+}
+
+/* Drop cached verdicts of prefix removed from topology table */
+void
+eigrp_filter_forget (struct eigrp *eigrp, struct prefix_ipv4 *p)
+{
+  struct listnode *node;
+  struct eigrp_interface *ei;
+  struct route_node *rn;
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    {
+      if (ei->filter_cache == NULL)
+        continue;
+      rn = route_node_lookup(ei->filter_cache, (struct prefix *) p);
+      if (rn == NULL)
+        continue;
+      if (rn->info)
+        {
+          XFREE(MTYPE_EIGRP_FILTER_VERDICT, rn->info);
+          rn->info = NULL;
+          route_unlock_node(rn);
+        }
+      route_unlock_node(rn);
+    }
+}
+
+/* Free verdict cache of interface */
+void
+eigrp_filter_cache_free (struct eigrp_interface *ei)
+{
+  struct route_node *rn;
+
+  if (ei->filter_cache == NULL)
+    return;
+
+  for (rn = route_top(ei->filter_cache); rn; rn = route_next(rn))
+    if (rn->info)
+      {
+        XFREE(MTYPE_EIGRP_FILTER_VERDICT, rn->info);
+        rn->info = NULL;
+        route_unlock_node(rn);
+      }
+  route_table_finish(ei->filter_cache);
+  ei->filter_cache = NULL;
+}
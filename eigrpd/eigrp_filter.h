@@ -40,5 +40,12 @@ extern void eigrp_distribute_update_all (struct prefix_list *);
 extern void eigrp_distribute_update_all_wrapper(struct access_list *);
 extern int eigrp_distribute_timer_process (struct thread *);
 extern int eigrp_distribute_timer_interface (struct thread *);
+extern u_char eigrp_filter_out (struct eigrp_interface *,
+                                struct eigrp_prefix_entry *, u_char *);
+extern u_char eigrp_filter_out_peek (struct eigrp_interface *,
+                                     struct eigrp_prefix_entry *);
+extern void eigrp_filter_invalidate_all (struct eigrp *);
+extern void eigrp_filter_forget (struct eigrp *, struct prefix_ipv4 *);
+extern void eigrp_filter_cache_free (struct eigrp_interface *);
 
 #endif /* EIGRPD_EIGRP_FILTER_H_ */
@@ -88,6 +88,8 @@
 #include "eigrpd/eigrp_dump.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_sia.h"
 
 /*
  * Prototypes
@@ -227,17 +229,12 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 		eigrp_topology_update_distance(msg);
 
 		if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
-			if (prefix->rij->count) {
+			eigrp_sia_replied(prefix, entry->adv_router);
+			if (prefix->rij.count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
 				zlog_info("All reply received\n");
-				if (((struct eigrp_neighbor_entry *) prefix->entries->head->data)->reported_distance
-						< prefix->fdistance) {
-					return EIGRP_FSM_EVENT_LR_FCS;
-				}
-
-				return EIGRP_FSM_EVENT_LR_FCN;
+				return eigrp_fsm_last_reply_event(prefix);
 			}
 		} else if (msg->packet_type == EIGRP_OPC_QUERY
 				&& (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)) {
@@ -255,12 +252,12 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 				&& (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)) {
 			return EIGRP_FSM_EVENT_QACT;
 		} else if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
+			eigrp_sia_replied(prefix, entry->adv_router);
 
 			if (change == 1
 					&& (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)) {
 				return EIGRP_FSM_EVENT_DINC;
-			} else if (prefix->rij->count) {
+			} else if (prefix->rij.count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
 				zlog_info("All reply received\n");
@@ -279,17 +276,12 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 		eigrp_topology_update_distance(msg);
 
 		if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
-			if (prefix->rij->count) {
+			eigrp_sia_replied(prefix, entry->adv_router);
+			if (prefix->rij.count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
 				zlog_info("All reply received\n");
-				if (((struct eigrp_neighbor_entry *) prefix->entries->head->data)->reported_distance
-						< prefix->fdistance) {
-					return EIGRP_FSM_EVENT_LR_FCS;
-				}
-
-				return EIGRP_FSM_EVENT_LR_FCN;
+				return eigrp_fsm_last_reply_event(prefix);
 			}
 		}
 		return EIGRP_FSM_KEEP_STATE;
@@ -301,12 +293,12 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 		int change = eigrp_topology_update_distance(msg);
 
 		if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
+			eigrp_sia_replied(prefix, entry->adv_router);
 
 			if (change == 1
 					&& (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)) {
 				return EIGRP_FSM_EVENT_DINC;
-			} else if (prefix->rij->count) {
+			} else if (prefix->rij.count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
 				zlog_info("All reply received\n");
@@ -325,6 +317,27 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 	return EIGRP_FSM_KEEP_STATE;
 }
 
+/*
+ * Event of active prefix whose last outstanding reply arrived, either
+ * in reply packet or by neighbor going down.
+ */
+int eigrp_fsm_last_reply_event(struct eigrp_prefix_entry *prefix) {
+	switch (prefix->state) {
+	case EIGRP_FSM_STATE_ACTIVE_0:
+	case EIGRP_FSM_STATE_ACTIVE_2:
+		if (((struct eigrp_neighbor_entry *) prefix->entries->head->data)->reported_distance
+				< prefix->fdistance) {
+			return EIGRP_FSM_EVENT_LR_FCS;
+		}
+		return EIGRP_FSM_EVENT_LR_FCN;
+	case EIGRP_FSM_STATE_ACTIVE_1:
+	case EIGRP_FSM_STATE_ACTIVE_3:
+		return EIGRP_FSM_EVENT_LR;
+	}
+
+	return EIGRP_FSM_KEEP_STATE;
+}
+
 /*
  * Function made to execute in separate thread.
  * Load argument from thread and execute proper NSM function
@@ -337,6 +350,22 @@ int eigrp_fsm_event(struct eigrp_fsm_action_message *msg, int event) {
 
 	return 1;
 }
+/*
+ * Finish batch of DUAL events (usually all TLVs of one received packet).
+ * FSM functions only queue their results, so queries and updates are
+ * built here once for the whole batch and routing table changes are
+ * pushed to zebra once per affected prefix. Summaries covering changed
+ * prefixes are refreshed first, so their updates go out in the same batch.
+ */
+void eigrp_fsm_batch_flush(struct eigrp *eigrp,
+		struct eigrp_interface *exception) {
+
+	eigrp_summary_flush(eigrp);
+	eigrp_query_send_all(eigrp);
+	eigrp_update_send_all(eigrp, exception);
+	eigrp_topology_rib_flush(eigrp);
+}
+
 /*
  * Function of event 0.
  *
@@ -352,8 +381,7 @@ int eigrp_fsm_event_nq_fcn(struct eigrp_fsm_action_message *msg) {
 			((struct eigrp_neighbor_entry *) successors->head->data)->total_metric;
 
 	if (eigrp_nbr_count_get()) {
-		prefix->req_action |= EIGRP_FSM_NEED_QUERY;
-		listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+		eigrp_topology_change_add(eigrp, prefix, EIGRP_FSM_NEED_QUERY);
 	} else {
 		eigrp_fsm_event_lr(msg); //in the case that there are no more neighbors left
 	}
@@ -371,8 +399,7 @@ int eigrp_fsm_event_q_fcn(struct eigrp_fsm_action_message *msg) {
 	prefix->reported_metric =
 			((struct eigrp_neighbor_entry *) successors->head->data)->total_metric;
 	if (eigrp_nbr_count_get()) {
-			prefix->req_action |= EIGRP_FSM_NEED_QUERY;
-			listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+			eigrp_topology_change_add(eigrp, prefix, EIGRP_FSM_NEED_QUERY);
 		} else {
 			eigrp_fsm_event_lr(msg); //in the case that there are no more neighbors left
 		}
@@ -396,11 +423,10 @@ int eigrp_fsm_event_keep_state(struct eigrp_fsm_action_message *msg) {
 					((struct eigrp_neighbor_entry *) prefix->entries->head->data)->total_metric;
 			if (msg->packet_type == EIGRP_OPC_QUERY)
 				eigrp_send_reply(msg->adv_router, prefix);
-			prefix->req_action |= EIGRP_FSM_NEED_UPDATE;
-			listnode_add((eigrp_lookup())->topology_changes_internalIPV4,prefix);
+			eigrp_topology_change_add(msg->eigrp, prefix, EIGRP_FSM_NEED_UPDATE);
 		}
 		eigrp_topology_update_node_flags(prefix);
-		eigrp_update_routing_table(prefix);
+		eigrp_topology_change_add(msg->eigrp, prefix, EIGRP_FSM_NEED_RIB);
 	}
 
 	if (msg->packet_type == EIGRP_OPC_QUERY)
@@ -412,22 +438,35 @@ int eigrp_fsm_event_keep_state(struct eigrp_fsm_action_message *msg) {
 int eigrp_fsm_event_lr(struct eigrp_fsm_action_message *msg) {
 	struct eigrp *eigrp = msg->eigrp;
 	struct eigrp_prefix_entry *prefix = msg->prefix;
-	prefix->fdistance =
-			prefix->distance =
-					prefix->rdistance =
-							((struct eigrp_neighbor_entry *) (prefix->entries->head->data))->distance;
-	prefix->reported_metric =
-			((struct eigrp_neighbor_entry *) (prefix->entries->head->data))->total_metric;
-	if (prefix->state == EIGRP_FSM_STATE_ACTIVE_3)
-		eigrp_send_reply(
-				((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
-						prefix)->head->data))->adv_router, prefix);
+	struct list *successors;
+
+	/* last reply may be injected without any reply received (nobody
+	 * was queried), prefix without entries is simply unreachable */
+	if (listcount(prefix->entries)) {
+		prefix->fdistance =
+				prefix->distance =
+						prefix->rdistance =
+								((struct eigrp_neighbor_entry *) (prefix->entries->head->data))->distance;
+		prefix->reported_metric =
+				((struct eigrp_neighbor_entry *) (prefix->entries->head->data))->total_metric;
+	} else {
+		prefix->fdistance = prefix->distance = prefix->rdistance =
+				EIGRP_MAX_DISTANCE;
+		prefix->reported_metric.delay = EIGRP_MAX_METRIC;
+	}
+	if (prefix->state == EIGRP_FSM_STATE_ACTIVE_3) {
+		/* querying successor may have lost its flag meanwhile */
+		successors = eigrp_topology_get_successor(prefix);
+		if (listcount(successors))
+			eigrp_send_reply(
+					((struct eigrp_neighbor_entry *) successors->head->data)->adv_router,
+					prefix);
+	}
 	prefix->state = EIGRP_FSM_STATE_PASSIVE;
-	prefix->req_action |= EIGRP_FSM_NEED_UPDATE;
-	listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+	eigrp_sia_stop(eigrp, prefix);
+	eigrp_topology_change_add(eigrp, prefix,
+			EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_RIB);
 	eigrp_topology_update_node_flags(prefix);
-	eigrp_update_routing_table(prefix);
-	eigrp_update_topology_table_prefix(eigrp->topology_table, prefix);
 
 	return 1;
 }
@@ -440,7 +479,7 @@ int eigrp_fsm_event_dinc(struct eigrp_fsm_action_message *msg) {
 	msg->prefix->distance =
 			((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
 					msg->prefix)->head->data))->distance;
-	if (!msg->prefix->rij->count) {
+	if (!msg->prefix->rij.count) {
 		(*(NSM[msg->prefix->state][eigrp_get_fsm_event(msg)].func))(msg);
 	}
 
@@ -451,6 +490,7 @@ int eigrp_fsm_event_lr_fcs(struct eigrp_fsm_action_message *msg) {
 	struct eigrp *eigrp = msg->eigrp;
 	struct eigrp_prefix_entry *prefix = msg->prefix;
 	prefix->state = EIGRP_FSM_STATE_PASSIVE;
+	eigrp_sia_stop(eigrp, prefix);
 	prefix->distance =
 			prefix->rdistance =
 					((struct eigrp_neighbor_entry *) (prefix->entries->head->data))->distance;
@@ -463,11 +503,9 @@ int eigrp_fsm_event_lr_fcs(struct eigrp_fsm_action_message *msg) {
 		eigrp_send_reply(
 				((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
 						prefix)->head->data))->adv_router, prefix);
-	prefix->req_action |= EIGRP_FSM_NEED_UPDATE;
-	listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+	eigrp_topology_change_add(eigrp, prefix,
+			EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_RIB);
 	eigrp_topology_update_node_flags(prefix);
-	eigrp_update_routing_table(prefix);
-	eigrp_update_topology_table_prefix(eigrp->topology_table, prefix);
 
 	return 1;
 }
@@ -484,8 +522,7 @@ int eigrp_fsm_event_lr_fcn(struct eigrp_fsm_action_message *msg) {
 	prefix->rdistance = prefix->distance = best_successor->distance;
 	prefix->reported_metric = best_successor->total_metric;
 	if (eigrp_nbr_count_get()) {
-		prefix->req_action |= EIGRP_FSM_NEED_QUERY;
-		listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+		eigrp_topology_change_add(eigrp, prefix, EIGRP_FSM_NEED_QUERY);
 	} else {
 		eigrp_fsm_event_lr(msg); //in the case that there are no more neighbors left
 	}
@@ -32,6 +32,8 @@
 
 extern int eigrp_get_fsm_event (struct eigrp_fsm_action_message *);
 extern int eigrp_fsm_event (struct eigrp_fsm_action_message *, int);
+extern void eigrp_fsm_batch_flush (struct eigrp *, struct eigrp_interface *);
+extern int eigrp_fsm_last_reply_event (struct eigrp_prefix_entry *);
 
 
 #endif /* _ZEBRA_EIGRP_DUAL_H */
@@ -63,6 +63,7 @@ static const struct message eigrp_general_tlv_type_str[] =
   { EIGRP_TLV_SEQ,		"SEQ"			},
   { EIGRP_TLV_SW_VERSION,	"SW_VERSION"		},
   { EIGRP_TLV_NEXT_MCAST_SEQ,	"NEXT_MCAST_SEQ"	},
+  { EIGRP_TLV_STUB,		"STUB"			},
   { EIGRP_TLV_PEER_TERMINATION,	"PEER_TERMINATION"	},
   { EIGRP_TLV_PEER_MTRLIST,	"PEER_MTRLIST"		},
   { EIGRP_TLV_PEER_TIDLIST,	"PEER_TIDLIST"		},
@@ -258,6 +259,95 @@ eigrp_peer_termination_decode (struct eigrp_neighbor *nbr,
 	}
 }
 
+/**
+ * @fn eigrp_sequence_decode
+ *
+ * @param[in]		nbr	neighbor the Hello was received from
+ * @param[in]		tlv	pointer to TLV with list of addresses
+ *
+ * @return int		1 if our address is listed, 0 otherwise
+ *
+ * @par
+ * Part of conditional receive process. Neighbor lists peers which
+ * have to ignore following CR flagged multicast.
+ */
+static int
+eigrp_sequence_decode (struct eigrp_neighbor *nbr,
+		       struct eigrp_tlv_hdr_type *tlv)
+{
+  u_char *data = (u_char *)tlv;
+  u_int16_t length = ntohs(tlv->length);
+  u_char addr_len;
+  u_int16_t offset;
+  struct in_addr addr;
+
+  if (length < EIGRP_TLV_SEQ_BASE_LEN)
+    return 0;
+
+  addr_len = data[EIGRP_TLV_SEQ_BASE_LEN - 1];
+  if (addr_len != IPV4_MAX_BYTELEN)
+    return 0;
+
+  for (offset = EIGRP_TLV_SEQ_BASE_LEN; offset + addr_len <= length;
+       offset += addr_len)
+    {
+      memcpy(&addr, data + offset, addr_len);
+      if (addr.s_addr == nbr->ei->address->u.prefix4.s_addr)
+	return 1;
+    }
+
+  return 0;
+}
+
+/**
+ * @fn eigrp_next_sequence_decode
+ *
+ * @param[in]		nbr	neighbor the Hello was received from
+ * @param[in]		tlv	pointer to Next Multicast Sequence TLV
+ *
+ * @return void
+ *
+ * @par
+ * Remember sequence number of the CR flagged multicast neighbor
+ * is going to send next.
+ */
+static void
+eigrp_next_sequence_decode (struct eigrp_neighbor *nbr,
+			    struct eigrp_tlv_hdr_type *tlv)
+{
+  struct TLV_Next_Multicast_Sequence *param =
+    (struct TLV_Next_Multicast_Sequence *)tlv;
+
+  if (ntohs(tlv->length) < EIGRP_NEXT_SEQUENCE_TLV_SIZE)
+    return;
+
+  nbr->cr_sequence = ntohl(param->multicast_sequence);
+}
+
+/**
+ * @fn eigrp_stub_decode
+ *
+ * @param[in]		nbr	neighbor the Hello was received from
+ * @param[in]		tlv	pointer to Stub TLV
+ *
+ * @return u_int16_t	stub flags of neighbor
+ *
+ * @par
+ * Read route types stub neighbor advertises. Neighbor is not queried
+ * while it announces itself as stub.
+ */
+static u_int16_t
+eigrp_stub_decode (struct eigrp_neighbor *nbr,
+		   struct eigrp_tlv_hdr_type *tlv)
+{
+  struct TLV_Stub_Type *stub = (struct TLV_Stub_Type *)tlv;
+
+  if (ntohs(tlv->length) < EIGRP_TLV_STUB_LEN)
+    return 0;
+
+  return ntohs(stub->flags);
+}
+
 /**
  * @fn eigrp_peer_termination_encode
  *
@@ -316,6 +406,8 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
   struct eigrp_neighbor *nbr;
   uint16_t	type;
   uint16_t	length;
+  int		seq_seen = 0, next_seen = 0, listed = 0, param_seen = 0;
+  u_int16_t	stub = 0;
 
   /* get neighbor struct */
   nbr = eigrp_nbr_get(ei, eigrph, iph);
@@ -347,6 +439,7 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 	switch (type)
 	  {
 	  case EIGRP_TLV_PARAMETER:
+	    param_seen = 1;
 	    eigrp_hello_parameter_decode(nbr, tlv_header);
 	    break;
 	  case EIGRP_TLV_AUTH:
@@ -358,11 +451,18 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
               break;
 	    }
 	  case EIGRP_TLV_SEQ:
+	    seq_seen = 1;
+	    listed = eigrp_sequence_decode(nbr, tlv_header);
 	    break;
 	  case EIGRP_TLV_SW_VERSION:
 	    eigrp_sw_version_decode(nbr, tlv_header);
 	    break;
 	  case EIGRP_TLV_NEXT_MCAST_SEQ:
+	    next_seen = 1;
+	    eigrp_next_sequence_decode(nbr, tlv_header);
+	    break;
+	  case EIGRP_TLV_STUB:
+	    stub = eigrp_stub_decode(nbr, tlv_header);
 	    break;
 	  case EIGRP_TLV_PEER_TERMINATION:
 	    eigrp_peer_termination_decode(nbr, tlv_header);
@@ -380,6 +480,21 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 
   } while (size > 0);
 
+  /* Sequence Hello announces CR multicast, accept it unless listed */
+  if (seq_seen || next_seen)
+    nbr->cr_mode = (next_seen && !listed);
+
+  /* every periodic Hello of stub router carries Stub TLV, while ACK
+   * is Hello without any TLV and says nothing about stub state */
+  if (ntohl(eigrph->ack) == 0 && param_seen)
+    {
+      if (stub != nbr->stub)
+	zlog_info ("Neighbor %s (%s) is %s",
+		   inet_ntoa (nbr->src), ifindex2ifname (nbr->ei->ifp->ifindex),
+		   stub ? "stub" : "no longer stub");
+      nbr->stub = stub;
+    }
+
 
   /*If received packet is hello with Parameter TLV*/
   if (ntohl(eigrph->ack) == 0)
@@ -398,6 +513,7 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 /**
  * @fn eigrp_sw_version_encode
  *
+ * @param[in]		ei	interface the hello is sent on
  * @param[in,out]	s	packet stream TLV is stored to
  *
  * @return u_int16_t	number of bytes added to packet stream
@@ -405,10 +521,11 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
  * @par
  * Store the software version in the specified location.
  * This consists of two bytes of OS version, and two bytes of EIGRP
- * revision number.
+ * revision number. Revision 2.0 tells neighbors we understand
+ * wide metric TLVs.
  */
 static u_int16_t
-eigrp_sw_version_encode (struct stream *s)
+eigrp_sw_version_encode (struct eigrp_interface *ei, struct stream *s)
 {
   u_int16_t length = EIGRP_TLV_SW_VERSION_LEN;
 
@@ -422,12 +539,47 @@ eigrp_sw_version_encode (struct stream *s)
   stream_putc(s, 99);		//!< minor os version
 
   /* and the core eigrp version */
-  stream_putc(s, EIGRP_MAJOR_VERSION);
-  stream_putc(s, EIGRP_MINOR_VERSION);
+  if (ei->eigrp->wide_metrics)
+    {
+      stream_putc(s, EIGRP_WIDE_MAJOR_VERSION);
+      stream_putc(s, EIGRP_WIDE_MINOR_VERSION);
+    }
+  else
+    {
+      stream_putc(s, EIGRP_MAJOR_VERSION);
+      stream_putc(s, EIGRP_MINOR_VERSION);
+    }
 
   return(length);
 }
 
+/**
+ * @fn eigrp_stub_encode
+ *
+ * @param[in]		ei	interface the hello is sent on
+ * @param[in,out]	s	packet stream TLV is stored to
+ *
+ * @return u_int16_t	number of bytes added to packet stream
+ *
+ * @par
+ * If router is configured as stub, store route types it advertises,
+ * so neighbors do not send queries to it.
+ */
+static u_int16_t
+eigrp_stub_encode (struct eigrp_interface *ei, struct stream *s)
+{
+  u_int16_t length = EIGRP_TLV_STUB_LEN;
+
+  if (ei->eigrp->stub == 0)
+    return 0;
+
+  stream_putw(s, EIGRP_TLV_STUB);
+  stream_putw(s, length);
+  stream_putw(s, ei->eigrp->stub);
+
+  return length;
+}
+
 /**
  * @fn eigrp_tidlist_encode
  *
@@ -449,31 +601,26 @@ eigrp_tidlist_encode (struct stream *s)
 /**
  * @fn eigrp_sequence_encode
  *
+ * @param[in]           ei      interface the hello is sent on
  * @param[in,out]       s       packet stream TLV is stored to
  *
  * @return u_int16_t    number of bytes added to packet stream
  *
  * @par
- * Part of conditional receive process
+ * Part of conditional receive process. Lists neighbors which still
+ * have unacknowledged packets, they must not accept the next
+ * conditionally received multicast.
  *
  */
 static u_int16_t
-eigrp_sequence_encode (struct stream *s)
+eigrp_sequence_encode (struct eigrp_interface *ei, struct stream *s)
 {
   u_int16_t length = EIGRP_TLV_SEQ_BASE_LEN;
-  struct eigrp *eigrp;
-  struct eigrp_interface *ei;
-  struct listnode *node, *node2, *nnode2;
+  struct listnode *node2, *nnode2;
   struct eigrp_neighbor *nbr;
   size_t backup_end, size_end;
   int found;
 
-  eigrp = eigrp_lookup ();
-  if (eigrp == NULL)
-    {
-      return 0;
-    }
-
   // add in the parameters TLV
   backup_end = stream_get_endp(s);
   stream_putw(s, EIGRP_TLV_SEQ);
@@ -482,15 +629,12 @@ eigrp_sequence_encode (struct stream *s)
   stream_putc(s, IPV4_MAX_BYTELEN);
 
   found = 0;
-  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+  for (ALL_LIST_ELEMENTS (ei->nbrs, node2, nnode2, nbr))
     {
-      for (ALL_LIST_ELEMENTS (ei->nbrs, node2, nnode2, nbr))
+      if((nbr->state == EIGRP_NEIGHBOR_UP) && (nbr->retrans_queue->count > 0))
         {
-          if(nbr->multicast_queue->count > 0)
-            {
-              length += (u_int16_t) stream_put_ipv4(s,nbr->src.s_addr);
-              found = 1;
-            }
+          length += (u_int16_t) stream_put_ipv4(s,nbr->src.s_addr);
+          found = 1;
         }
     }
 
@@ -509,9 +653,10 @@ eigrp_sequence_encode (struct stream *s)
 }
 
 /**
- * @fn eigrp_sequence_encode
+ * @fn eigrp_next_sequence_encode
  *
  * @param[in,out]       s       packet stream TLV is stored to
+ * @param[in]           seq     sequence number of next multicast packet
  *
  * @return u_int16_t    number of bytes added to packet stream
  *
@@ -520,21 +665,14 @@ eigrp_sequence_encode (struct stream *s)
  *
  */
 static u_int16_t
-eigrp_next_sequence_encode (struct stream *s)
+eigrp_next_sequence_encode (struct stream *s, u_int32_t seq)
 {
   u_int16_t length = EIGRP_NEXT_SEQUENCE_TLV_SIZE;
-  struct eigrp *eigrp;
-
-  eigrp = eigrp_lookup ();
-  if (eigrp == NULL)
-    {
-      return 0;
-    }
 
   // add in the parameters TLV
     stream_putw(s, EIGRP_TLV_NEXT_MCAST_SEQ);
     stream_putw(s, EIGRP_NEXT_SEQUENCE_TLV_SIZE);
-    stream_putl(s,eigrp->sequence_number+1);
+    stream_putl(s, seq);
 
   return length;
 }
@@ -597,6 +735,7 @@ eigrp_hello_parameter_encode (struct eigrp_interface *ei, struct stream *s, u_ch
  * @param[in]		ack	 if non-zero, neigbors sequence packet to ack
  * @param[in]		flags  type of hello packet
  * @param[in]		nbr_addr  pointer to neighbor address for Peer Termination TLV
+ * @param[in]		next_seq  sequence of next multicast, with EIGRP_HELLO_ADD_SEQUENCE
  *
  * @return eigrp_packet		pointer initialize hello packet
  *
@@ -605,7 +744,8 @@ eigrp_hello_parameter_encode (struct eigrp_interface *ei, struct stream *s, u_ch
  *
  */
 static struct eigrp_packet *
-eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack, u_char flags, struct in_addr *nbr_addr)
+eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack, u_char flags, struct in_addr *nbr_addr,
+                    u_int32_t next_seq)
 {
   struct eigrp_packet *ep;
   u_int16_t length = EIGRP_HEADER_LEN;
@@ -635,12 +775,15 @@ eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack, u
         length += eigrp_hello_parameter_encode(ei, ep->s, EIGRP_HELLO_NORMAL);
 
       // figure out the version of code we're running
-      length += eigrp_sw_version_encode(ep->s);
+      length += eigrp_sw_version_encode(ei, ep->s);
+
+      // announce stub routing
+      length += eigrp_stub_encode(ei, ep->s);
 
       if(flags & EIGRP_HELLO_ADD_SEQUENCE)
         {
-          length += eigrp_sequence_encode(ep->s);
-          length += eigrp_next_sequence_encode(ep->s);
+          length += eigrp_sequence_encode(ei, ep->s);
+          length += eigrp_next_sequence_encode(ep->s, next_seq);
         }
 
       // add in the TID list if doing multi-topology
@@ -691,7 +834,7 @@ eigrp_hello_send_ack (struct eigrp_neighbor *nbr)
   struct eigrp_packet *ep;
 
   /* if packet succesfully created, add it to the interface queue */
-  ep = eigrp_hello_encode(nbr->ei, nbr->src.s_addr, nbr->recv_sequence_number, EIGRP_HELLO_NORMAL, NULL);
+  ep = eigrp_hello_encode(nbr->ei, nbr->src.s_addr, nbr->recv_sequence_number, EIGRP_HELLO_NORMAL, NULL, 0);
 
   if (ep)
     {
@@ -743,7 +886,7 @@ eigrp_hello_send (struct eigrp_interface *ei, u_char flags, struct in_addr *nbr_
     zlog_debug("Queueing [Hello] Interface(%s)", IF_NAME(ei));
 
   /* if packet was succesfully created, then add it to the interface queue */
-  ep = eigrp_hello_encode(ei, htonl(EIGRP_MULTICAST_ADDRESS), 0, flags, nbr_addr);
+  ep = eigrp_hello_encode(ei, htonl(EIGRP_MULTICAST_ADDRESS), 0, flags, nbr_addr, 0);
 
   if (ep)
     {
@@ -772,3 +915,45 @@ eigrp_hello_send (struct eigrp_interface *ei, u_char flags, struct in_addr *nbr_
 	}
     }
 }
+
+/**
+ * @fn eigrp_hello_send_sequence
+ *
+ * @param[in]		ei	pointer to interface hello should be sent
+ * @param[in]		next_seq  sequence number of following CR multicast
+ *
+ * @return void
+ *
+ * @par
+ * Announce conditionally received multicast packet: Sequence TLV
+ * lists lagging neighbors which must ignore it and Next Multicast
+ * Sequence TLV tells the rest which packet to accept.  Hello is put
+ * on the interface queue ahead of the CR packet itself.
+ */
+void
+eigrp_hello_send_sequence (struct eigrp_interface *ei, u_int32_t next_seq)
+{
+  struct eigrp_packet *ep;
+
+  ep = eigrp_hello_encode(ei, htonl(EIGRP_MULTICAST_ADDRESS), 0,
+                          EIGRP_HELLO_ADD_SEQUENCE, NULL, next_seq);
+
+  if (ep)
+    {
+      if (IS_DEBUG_EIGRP_PACKET(0, SEND))
+        zlog_debug("Queueing [Hello] Sequence Next [%u] Interface(%s)",
+                   next_seq, IF_NAME(ei));
+
+      eigrp_fifo_push_head(ei->obuf, ep);
+
+      /* Hook thread to write packet. */
+      if (ei->on_write_q == 0)
+        {
+          listnode_add(ei->eigrp->oi_write_q, ei);
+          ei->on_write_q = 1;
+        }
+      if (ei->eigrp->t_write == NULL)
+        ei->eigrp->t_write =
+          thread_add_write(master, eigrp_write, ei->eigrp, ei->eigrp->fd);
+    }
+}
@@ -42,6 +42,9 @@
 #include "stream.h"
 #include "log.h"
 #include "keychain.h"
+#include "filter.h"
+#include "plist.h"
+#include "distribute.h"
 
 #include "eigrpd/eigrp_structs.h"
 #include "eigrpd/eigrpd.h"
@@ -52,6 +55,7 @@
 #include "eigrpd/eigrp_vty.h"
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_filter.h"
 
 static void
 eigrp_delete_from_if (struct interface *, struct eigrp_interface *);
@@ -192,6 +196,9 @@ eigrp_if_new_hook (struct interface *ifp)
   SET_IF_PARAM (IF_DEF_PARAMS (ifp), load);
   IF_DEF_PARAMS (ifp)->load = (u_char) EIGRP_LOAD_DEFAULT;
 
+  SET_IF_PARAM (IF_DEF_PARAMS (ifp), bandwidth_percent);
+  IF_DEF_PARAMS (ifp)->bandwidth_percent = (u_int32_t) EIGRP_BANDWIDTH_PERCENT_DEFAULT;
+
   SET_IF_PARAM (IF_DEF_PARAMS (ifp), auth_type);
   IF_DEF_PARAMS (ifp)->auth_type = EIGRP_AUTH_TYPE_NONE;
 
@@ -217,6 +224,7 @@ eigrp_new_if_params (void)
   UNSET_IF_PARAM (eip, delay);
   UNSET_IF_PARAM (eip, reliability);
   UNSET_IF_PARAM (eip, load);
+  UNSET_IF_PARAM (eip, bandwidth_percent);
   UNSET_IF_PARAM (eip, auth_keychain);
   UNSET_IF_PARAM (eip, auth_type);
 
@@ -281,6 +289,9 @@ eigrp_if_up (struct eigrp_interface *ei)
   /*Prepare metrics*/
   metric.bandwith = eigrp_bandwidth_to_scaled (EIGRP_IF_PARAM (ei,bandwidth));
   metric.delay = eigrp_delay_to_scaled (EIGRP_IF_PARAM (ei,delay));
+  metric.wide_bandwidth = EIGRP_IF_PARAM (ei,bandwidth);
+  metric.wide_delay =
+      (u_int64_t) EIGRP_IF_PARAM (ei,delay) * EIGRP_WIDE_DELAY_UNIT;
   metric.load = EIGRP_IF_PARAM (ei,load);
   metric.reliability = EIGRP_IF_PARAM (ei,reliability);
   metric.mtu[0] = 0xDC;
@@ -303,16 +314,15 @@ eigrp_if_up (struct eigrp_interface *ei)
   if (pe == NULL)
     {
       pe = eigrp_prefix_entry_new ();
-      pe->serno = eigrp->serno;
+      pe->serno = ++eigrp->serno;
       pe->destination_ipv4 = dest_addr;
       pe->af = AF_INET;
       pe->nt = EIGRP_TOPOLOGY_TYPE_CONNECTED;
 
       pe->state = EIGRP_FSM_STATE_PASSIVE;
       pe->fdistance = eigrp_calculate_metrics (eigrp, &metric);
-      pe->req_action |= EIGRP_FSM_NEED_UPDATE;
       eigrp_prefix_entry_add (eigrp->topology_table, pe);
-      listnode_add(eigrp->topology_changes_internalIPV4, pe);
+      eigrp_topology_change_add (eigrp, pe, EIGRP_FSM_NEED_UPDATE);
     }
   ne = eigrp_neighbor_entry_new ();
   ne->ei = ei;
@@ -377,6 +387,12 @@ eigrp_if_stream_unset (struct eigrp_interface *ei)
 {
   struct eigrp *eigrp = ei->eigrp;
 
+  THREAD_OFF (ei->t_pace);
+
+  /* socket may keep pointing to interface index which gets reused */
+  if (eigrp->mcast_ifindex == ei->ifp->ifindex)
+    eigrp->mcast_ifindex = 0;
+
   if (ei->obuf)
     {
       eigrp_fifo_free (ei->obuf);
@@ -444,6 +460,9 @@ eigrp_if_free (struct eigrp_interface *ei, int source)
 
   eigrp_if_down (ei);
 
+  THREAD_OFF (ei->t_distribute);
+  eigrp_filter_cache_free (ei);
+
   list_delete (ei->nbrs);
   eigrp_delete_from_if (ei->ifp, ei);
   listnode_delete (ei->eigrp->eiflist, ei);
@@ -576,6 +595,39 @@ eigrp_if_lookup_recv_if (struct eigrp *eigrp, struct in_addr src,
   return match;
 }
 
+/* Interface bandwidth or delay changed, drop cached link contribution */
+void
+eigrp_if_metric_reset (struct eigrp *eigrp, struct interface *ifp)
+{
+  struct listnode *node;
+  struct eigrp_interface *ei;
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    if (ei->ifp == ifp)
+      ei->metric_valid = 0;
+}
+
+/*
+ * Multicast route TLVs are read by every neighbor on interface, wide
+ * metric is used only if all of them announced TLV version 2.0.
+ */
+int
+eigrp_if_tlv_wide (struct eigrp_interface *ei)
+{
+  struct listnode *node;
+  struct eigrp_neighbor *nbr;
+
+  if (!ei->eigrp->wide_metrics)
+    return 0;
+
+  for (ALL_LIST_ELEMENTS_RO (ei->nbrs, node, nbr))
+    if (nbr->state != EIGRP_NEIGHBOR_DOWN
+        && nbr->tlv_rel_major < EIGRP_WIDE_MAJOR_VERSION)
+      return 0;
+
+  return 1;
+}
+
 u_int32_t
 eigrp_bandwidth_to_scaled (u_int32_t bandwidth)
 {
@@ -50,8 +50,8 @@
 #include "zclient.h"
 #include "keychain.h"
 #include "distribute.h"
-//#include "routemap.h"
-//#include "if_rmap.h"
+#include "routemap.h"
+#include "if_rmap.h"
 
 #include "eigrpd/eigrp_structs.h"
 #include "eigrpd/eigrpd.h"
@@ -64,7 +64,7 @@
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_snmp.h"
 #include "eigrpd/eigrp_filter.h"
-//#include "eigrpd/eigrp_routemap.h"
+#include "eigrpd/eigrp_routemap.h"
 
 /* eigprd privileges */
 zebra_capabilities_t _caps_p [] = 
@@ -313,8 +313,9 @@ main (int argc, char **argv)
   prefix_list_add_hook (eigrp_distribute_update_all);
   prefix_list_delete_hook (eigrp_distribute_update_all);
 
-  /*eigrp_route_map_init();
-  route_map_add_hook (eigrp_rmap_update);
+  /* Route-maps, for redistribution */
+  eigrp_route_map_init();
+  /*route_map_add_hook (eigrp_rmap_update);
   route_map_delete_hook (eigrp_rmap_update);*/
   /*if_rmap_init (EIGRP_NODE);
   if_rmap_hook_add (eigrp_if_rmap_update);
@@ -42,6 +42,8 @@
 #include "log.h"
 #include "keychain.h"
 #include "vty.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "eigrpd/eigrp_structs.h"
 #include "eigrpd/eigrpd.h"
@@ -53,7 +55,44 @@
 #include "eigrpd/eigrp_vty.h"
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_sia.h"
 
+static unsigned int
+eigrp_nbr_hash_key (void *arg)
+{
+  struct eigrp_neighbor *nbr = arg;
+
+  return jhash_2words(nbr->ei->ifp->ifindex, nbr->src.s_addr, 0);
+}
+
+static int
+eigrp_nbr_hash_cmp (const void *a, const void *b)
+{
+  const struct eigrp_neighbor *nbr1 = a;
+  const struct eigrp_neighbor *nbr2 = b;
+
+  return (nbr1->ei->ifp->ifindex == nbr2->ei->ifp->ifindex)
+    && (nbr1->src.s_addr == nbr2->src.s_addr);
+}
+
+/* Create per process index of neighbors keyed by interface and address */
+struct hash *
+eigrp_nbr_hash_new (void)
+{
+  return hash_create(eigrp_nbr_hash_key, eigrp_nbr_hash_cmp);
+}
+
+/* Look up neighbor with given address on interface in process index. */
+static struct eigrp_neighbor *
+eigrp_nbr_hash_lookup (struct eigrp_interface *ei, struct in_addr addr)
+{
+  struct eigrp_neighbor key;
+
+  key.ei = ei;
+  key.src = addr;
+
+  return hash_lookup(ei->eigrp->nbrs_hash, &key);
+}
 
 struct eigrp_neighbor *
 eigrp_nbr_new (struct eigrp_interface *ei)
@@ -88,6 +127,7 @@ eigrp_nbr_add (struct eigrp_interface *ei, struct eigrp_header *eigrph,
 
   nbr = eigrp_nbr_new (ei);
   nbr->src = iph->ip_src;
+  eigrp_nbr_id_get (ei->eigrp, nbr);
 
 //  if (IS_DEBUG_EIGRP_EVENT)
 //    zlog_debug("NSM[%s:%s]: start", IF_NAME (nbr->oi),
@@ -101,18 +141,14 @@ eigrp_nbr_get (struct eigrp_interface *ei, struct eigrp_header *eigrph,
               struct ip *iph)
 {
   struct eigrp_neighbor *nbr;
-  struct listnode *node, *nnode;
 
-  for (ALL_LIST_ELEMENTS (ei->nbrs, node, nnode, nbr))
-    {
-      if (iph->ip_src.s_addr == nbr->src.s_addr)
-        {
-          return nbr;
-        }
-    }
+  nbr = eigrp_nbr_hash_lookup (ei, iph->ip_src);
+  if (nbr)
+    return nbr;
 
   nbr = eigrp_nbr_add (ei, eigrph, iph);
   listnode_add (ei->nbrs, nbr);
+  hash_get (ei->eigrp->nbrs_hash, nbr, hash_alloc_intern);
 
   return nbr;
 }
@@ -132,18 +168,7 @@ eigrp_nbr_get (struct eigrp_interface *ei, struct eigrp_header *eigrph,
 struct eigrp_neighbor *
 eigrp_nbr_lookup_by_addr (struct eigrp_interface *ei, struct in_addr *addr)
 {
-  struct eigrp_neighbor *nbr;
-  struct listnode *node, *nnode;
-
-  for (ALL_LIST_ELEMENTS (ei->nbrs, node, nnode, nbr))
-      {
-        if (addr == nbr->src.s_addr)
-          {
-            return nbr;
-          }
-      }
-
-  return NULL;
+  return eigrp_nbr_hash_lookup (ei, *addr);
 }
 
 /**
@@ -162,21 +187,15 @@ struct eigrp_neighbor *
 eigrp_nbr_lookup_by_addr_process (struct eigrp *eigrp, struct in_addr nbr_addr)
 {
 	struct eigrp_interface *ei;
-	struct listnode *node, *node2, *nnode2;
+	struct listnode *node;
 	struct eigrp_neighbor *nbr;
 
-  	/* iterate over all eigrp interfaces */
+  	/* look for neighbor on each eigrp interface */
 	for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
 	{
-		/* iterate over all neighbors on eigrp interface */
-		for (ALL_LIST_ELEMENTS (ei->nbrs, node2, nnode2, nbr))
-		{
-			/* compare if neighbor address is same as arg address */
-			if (nbr->src.s_addr == nbr_addr.s_addr)
-			{
-				return nbr;
-			}
-		}
+		nbr = eigrp_nbr_hash_lookup (ei, nbr_addr);
+		if (nbr)
+			return nbr;
 	}
 
 	return NULL;
@@ -196,8 +215,15 @@ eigrp_nbr_delete (struct eigrp_neighbor *nbr)
   eigrp_fifo_free (nbr->multicast_queue);
   eigrp_fifo_free (nbr->retrans_queue);
   THREAD_OFF (nbr->t_holddown);
+  eigrp_update_send_GR_stop (nbr);
 
-  listnode_delete (nbr->ei->nbrs,nbr);
+  if (nbr->ei)
+    {
+      listnode_delete (nbr->ei->nbrs,nbr);
+      hash_release (nbr->ei->eigrp->nbrs_hash, nbr);
+      eigrp_nbr_id_release (nbr->ei->eigrp, nbr);
+    }
+  eigrp_topology_neighbor_detach (nbr);
   XFREE (MTYPE_EIGRP_NEIGHBOR, nbr);
 }
 
@@ -385,3 +411,20 @@ void eigrp_nbr_hard_restart(struct eigrp_neighbor *nbr, struct vty *vty)
 	/* delete neighbor */
 	eigrp_nbr_delete (nbr);
 }
+
+/**
+ * @fn eigrp_nbr_tlv_wide
+ *
+ * @param[in]		nbr	Neighbor route TLVs are sent to
+ * @return int		1 if TLVs with wide metric can be used
+ *
+ * @par
+ * Wide metric TLVs are sent only if they are enabled locally and
+ * neighbor announced TLV version 2.0 or newer in its hello.
+ */
+int
+eigrp_nbr_tlv_wide(struct eigrp_neighbor *nbr)
+{
+  return (nbr->ei->eigrp->wide_metrics
+          && nbr->tlv_rel_major >= EIGRP_WIDE_MAJOR_VERSION);
+}
@@ -38,6 +38,7 @@ extern struct eigrp_neighbor *eigrp_nbr_get(struct eigrp_interface *,
 					    struct eigrp_header *,
 					    struct ip *);
 extern struct eigrp_neighbor *eigrp_nbr_new (struct eigrp_interface *);
+extern struct hash *eigrp_nbr_hash_new (void);
 extern void eigrp_nbr_delete(struct eigrp_neighbor *);
 
 extern int holddown_timer_expired(struct thread *);
@@ -51,5 +52,6 @@ extern const char *eigrp_nbr_state_str(struct eigrp_neighbor *);
 extern struct eigrp_neighbor *eigrp_nbr_lookup_by_addr (struct eigrp_interface *, struct in_addr *);
 extern struct eigrp_neighbor *eigrp_nbr_lookup_by_addr_process (struct eigrp *, struct in_addr);
 extern void eigrp_nbr_hard_restart(struct eigrp_neighbor *nbr, struct vty *vty);
+extern int eigrp_nbr_tlv_wide(struct eigrp_neighbor *);
 
 #endif /* _ZEBRA_EIGRP_NEIGHBOR_H */
@@ -384,24 +384,88 @@ eigrp_network_unset(struct eigrp *eigrp, struct prefix_ipv4 *p)
   return 1;
 }
 
-u_int32_t
+/*
+ * Select metric kernel for configured K-values.  Default K1 = K3 = 1 with
+ * other weights zero reduces composite metric to sum of bandwidth and delay.
+ */
+void
+eigrp_metric_kernel_update(struct eigrp *eigrp)
+{
+  eigrp->k_classic = (eigrp->k_values[0] == 1 && eigrp->k_values[1] == 0
+                      && eigrp->k_values[2] == 1 && eigrp->k_values[3] == 0
+                      && eigrp->k_values[4] == 0);
+}
+
+/*
+ * Wide metric kernel, RFC 7868.  Throughput and latency are scaled by 65536
+ * so that links faster than 10 Gbps and sub-microsecond delays still differ.
+ */
+static u_int64_t
+eigrp_calculate_wide_metrics(struct eigrp *eigrp, struct eigrp_metrics *metric)
+{
+  u_int64_t throughput, latency, temp_metric, divisor;
+
+  /* unreachable routes may be marked by classic delay only */
+  if (metric->wide_delay >= EIGRP_MAX_WIDE_VALUE
+      || metric->delay == EIGRP_MAX_METRIC)
+    return EIGRP_MAX_DISTANCE;
+
+  throughput = metric->wide_bandwidth ?
+      (EIGRP_WIDE_BANDWIDTH * EIGRP_WIDE_SCALE) / metric->wide_bandwidth :
+      EIGRP_WIDE_BANDWIDTH * EIGRP_WIDE_SCALE;
+  /* split so picoseconds times scale does not overflow */
+  latency = (metric->wide_delay / EIGRP_WIDE_DELAY_PICO) * EIGRP_WIDE_SCALE
+      + ((metric->wide_delay % EIGRP_WIDE_DELAY_PICO) * EIGRP_WIDE_SCALE)
+        / EIGRP_WIDE_DELAY_PICO;
+
+  if (eigrp->k_classic)
+    return throughput + latency;
+
+  temp_metric = 0;
+  if (eigrp->k_values[0])
+    temp_metric += eigrp->k_values[0] * throughput;
+  if (eigrp->k_values[1])
+    temp_metric += (eigrp->k_values[1] * throughput) / (256 - metric->load);
+  if (eigrp->k_values[2])
+    temp_metric += eigrp->k_values[2] * latency;
+  if (eigrp->k_values[4])
+    {
+      /* reliability comes from the wire, 0 under K4 = 0 counts as 1 */
+      divisor = eigrp->k_values[3] + metric->reliability;
+      temp_metric = (temp_metric * eigrp->k_values[4])
+          / (divisor ? divisor : 1);
+    }
+
+  return temp_metric < EIGRP_MAX_DISTANCE ? temp_metric : EIGRP_MAX_DISTANCE - 1;
+}
+
+u_int64_t
 eigrp_calculate_metrics(struct eigrp *eigrp, struct eigrp_metrics *metric)
 {
   u_int64_t temp_metric;
   temp_metric = 0;
 
+  if (eigrp->wide_metrics)
+    return eigrp_calculate_wide_metrics(eigrp, metric);
+
   if(metric->delay == EIGRP_MAX_METRIC)
-    return EIGRP_MAX_METRIC;
+    return EIGRP_MAX_DISTANCE;
+
+  if (eigrp->k_classic)
+    {
+      temp_metric = (u_int64_t) metric->bandwith + metric->delay;
+      return temp_metric < EIGRP_MAX_METRIC ? temp_metric : EIGRP_MAX_DISTANCE;
+    }
 
   // EIGRP Metric = {K1*BW+[(K2*BW)/(256-load)]+(K3*delay)}*{K5/(reliability+K4)}
 
   if (eigrp->k_values[0])
-    temp_metric += (eigrp->k_values[0] * metric->bandwith);
+    temp_metric += ((u_int64_t) eigrp->k_values[0] * metric->bandwith);
   if (eigrp->k_values[1])
-    temp_metric += ((eigrp->k_values[1] * metric->bandwith)
+    temp_metric += (((u_int64_t) eigrp->k_values[1] * metric->bandwith)
         / (256 - metric->load));
   if (eigrp->k_values[2])
-    temp_metric += (eigrp->k_values[2] * metric->delay);
+    temp_metric += ((u_int64_t) eigrp->k_values[2] * metric->delay);
   if (eigrp->k_values[3] && !eigrp->k_values[4])
     temp_metric *= eigrp->k_values[3];
   if (!eigrp->k_values[3] && eigrp->k_values[4])
@@ -410,29 +474,120 @@ eigrp_calculate_metrics(struct eigrp *eigrp, struct eigrp_metrics *metric)
     temp_metric *= ((eigrp->k_values[4] / metric->reliability)
         + eigrp->k_values[3]);
 
-  if (temp_metric <= EIGRP_MAX_METRIC)
-    return (u_int32_t) temp_metric;
+  if (temp_metric < EIGRP_MAX_METRIC)
+    return temp_metric;
   else
-    return EIGRP_MAX_METRIC;
+    return EIGRP_MAX_DISTANCE;
 }
 
-u_int32_t
+/*
+ * Delay and bandwidth the interface adds to routes received on it, scaled
+ * the way metric TLVs carry them.  Kept until interface is reconfigured.
+ */
+static void
+eigrp_if_metric_update(struct eigrp_interface *ei)
+{
+  ei->metric_delay = eigrp_delay_to_scaled (EIGRP_IF_PARAM (ei, delay));
+  ei->metric_bandwidth =
+      eigrp_bandwidth_to_scaled (EIGRP_IF_PARAM (ei, bandwidth));
+  ei->metric_wide_delay =
+      (u_int64_t) EIGRP_IF_PARAM (ei, delay) * EIGRP_WIDE_DELAY_UNIT;
+  ei->metric_wide_bandwidth = EIGRP_IF_PARAM (ei, bandwidth);
+  ei->metric_valid = 1;
+}
+
+u_int64_t
 eigrp_calculate_total_metrics(struct eigrp *eigrp,
     struct eigrp_neighbor_entry *entry)
 {
+  struct eigrp_interface *ei = entry->ei;
+  u_int64_t temp_delay;
+
+  if (!ei->metric_valid)
+    eigrp_if_metric_update(ei);
+
   entry->total_metric = entry->reported_metric;
-  u_int64_t temp_delay = (u_int64_t) entry->total_metric.delay
-      + (u_int64_t) EIGRP_IF_PARAM (entry->ei, delay);
+  temp_delay = (u_int64_t) entry->total_metric.delay + ei->metric_delay;
   entry->total_metric.delay =
       temp_delay > EIGRP_MAX_METRIC ? EIGRP_MAX_METRIC : (u_int32_t) temp_delay;
 
-  u_int32_t bw = EIGRP_IF_PARAM (entry->ei,bandwidth);
-  entry->total_metric.bandwith =
-      entry->total_metric.bandwith > bw ? bw : entry->total_metric.bandwith;
+  /* scaled bandwidth is inverse, slowest link has the largest one */
+  if (entry->total_metric.bandwith < ei->metric_bandwidth)
+    entry->total_metric.bandwith = ei->metric_bandwidth;
+
+  /* wide values are not inverted, slowest link has the smallest one */
+  if (entry->total_metric.wide_delay < EIGRP_MAX_WIDE_VALUE)
+    {
+      temp_delay = entry->total_metric.wide_delay + ei->metric_wide_delay;
+      entry->total_metric.wide_delay =
+          temp_delay < EIGRP_MAX_WIDE_VALUE ? temp_delay : EIGRP_MAX_WIDE_VALUE;
+    }
+  if (entry->total_metric.wide_bandwidth > ei->metric_wide_bandwidth)
+    entry->total_metric.wide_bandwidth = ei->metric_wide_bandwidth;
 
   return eigrp_calculate_metrics(eigrp, &entry->total_metric);
 }
 
+/*
+ * Fill wide delay and bandwidth from classic scaled values, used for
+ * routes learned from 1.2 TLVs and for locally originated metrics.
+ */
+void
+eigrp_metric_classic_to_wide(struct eigrp_metrics *metric)
+{
+  if (metric->delay == EIGRP_MAX_METRIC)
+    metric->wide_delay = EIGRP_MAX_WIDE_VALUE;
+  else
+    metric->wide_delay = ((u_int64_t) metric->delay * EIGRP_WIDE_DELAY_UNIT) / 256;
+
+  if (metric->bandwith)
+    metric->wide_bandwidth = (256ULL * EIGRP_WIDE_BANDWIDTH) / metric->bandwith;
+  else
+    metric->wide_bandwidth = EIGRP_MAX_WIDE_VALUE;
+}
+
+/*
+ * Fill classic scaled values from wide delay and bandwidth, used for
+ * routes learned from 2.0 TLVs and sent to 1.2 neighbors.
+ */
+void
+eigrp_metric_wide_to_classic(struct eigrp_metrics *metric)
+{
+  u_int64_t temp;
+
+  if (metric->wide_delay >= EIGRP_MAX_WIDE_VALUE)
+    metric->delay = EIGRP_MAX_METRIC;
+  else
+    {
+      temp = (metric->wide_delay * 256) / EIGRP_WIDE_DELAY_UNIT;
+      metric->delay = temp < EIGRP_MAX_METRIC ? (u_int32_t) temp : EIGRP_MAX_METRIC - 1;
+    }
+
+  if (metric->wide_bandwidth)
+    {
+      temp = (256ULL * EIGRP_WIDE_BANDWIDTH) / metric->wide_bandwidth;
+      metric->bandwith = temp < EIGRP_MAX_METRIC ? (u_int32_t) temp : EIGRP_MAX_METRIC;
+    }
+  else
+    metric->bandwith = EIGRP_MAX_METRIC;
+}
+
+/*
+ * Metric installed into zebra.  Wide distances do not fit 32 bits, so they
+ * are scaled down the same way other implementations do.
+ */
+u_int32_t
+eigrp_rib_metric(struct eigrp *eigrp, u_int64_t distance)
+{
+  if (distance == EIGRP_MAX_DISTANCE)
+    return EIGRP_MAX_METRIC;
+
+  if (eigrp && eigrp->wide_metrics)
+    distance /= EIGRP_RIB_SCALE;
+
+  return distance < EIGRP_MAX_METRIC ? (u_int32_t) distance : EIGRP_MAX_METRIC;
+}
+
 u_char
 eigrp_metrics_is_same(struct eigrp_metrics *metric1,
     struct eigrp_metrics *metric2)
@@ -444,15 +599,11 @@ eigrp_metrics_is_same(struct eigrp_metrics *metric1,
       && (metric1->reliability == metric2->reliability)
       && (metric1->mtu[0] == metric2->mtu[0])
       && (metric1->mtu[1] == metric2->mtu[1])
-      && (metric1->mtu[2] == metric2->mtu[2]))
+      && (metric1->mtu[2] == metric2->mtu[2])
+      && (metric1->wide_delay == metric2->wide_delay)
+      && (metric1->wide_bandwidth == metric2->wide_bandwidth))
       return 1;
 
     return 0; // if different
 }
-void
-eigrp_external_routes_refresh (struct eigrp *eigrp, int type)
-{
-
-
-}
 
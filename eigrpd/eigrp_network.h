@@ -44,9 +44,12 @@ extern int eigrp_if_drop_allspfrouters (struct eigrp *top, struct prefix *p,
                                         unsigned int ifindex);
 extern void eigrp_adjust_sndbuflen (struct eigrp *, unsigned int);
 
-extern u_int32_t eigrp_calculate_metrics (struct eigrp *, struct eigrp_metrics *);
-extern u_int32_t eigrp_calculate_total_metrics (struct eigrp *, struct eigrp_neighbor_entry *);
+extern void eigrp_metric_kernel_update (struct eigrp *);
+extern u_int64_t eigrp_calculate_metrics (struct eigrp *, struct eigrp_metrics *);
+extern u_int64_t eigrp_calculate_total_metrics (struct eigrp *, struct eigrp_neighbor_entry *);
+extern void eigrp_metric_classic_to_wide (struct eigrp_metrics *);
+extern void eigrp_metric_wide_to_classic (struct eigrp_metrics *);
+extern u_int32_t eigrp_rib_metric (struct eigrp *, u_int64_t);
 extern u_char eigrp_metrics_is_same(struct eigrp_metrics *,struct eigrp_metrics *);
-extern void eigrp_external_routes_refresh (struct eigrp *, int);
 
 #endif /* EIGRP_NETWORK_H_ */
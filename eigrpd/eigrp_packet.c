@@ -39,6 +39,7 @@
 #include "stream.h"
 #include "log.h"
 #include "sockopt.h"
+#include "network.h"
 #include "checksum.h"
 #include "md5.h"
 #include "sha256.h"
@@ -75,7 +76,8 @@ const size_t eigrp_packet_type_str_max = sizeof(eigrp_packet_type_str) /
 static unsigned char zeropad[16] = {0};
 
 /* Forward function reference*/
-static struct stream * eigrp_recv_packet (int, struct interface **, struct stream *);
+static struct stream * eigrp_recv_check (struct stream *, int, struct msghdr *,
+                                         struct interface **);
 static int eigrp_verify_header (struct stream *, struct eigrp_interface *, struct ip *,
 				struct eigrp_header *);
 static int eigrp_check_network_mask (struct eigrp_interface *, struct in_addr);
@@ -352,134 +354,297 @@ eigrp_packet_dump (struct stream *s)
 //  return result;
 //}
 
-int
-eigrp_write (struct thread *thread)
+/* Bytes per second EIGRP may send on interface */
+static u_int64_t
+eigrp_pace_rate (struct eigrp_interface *ei)
+{
+  u_int64_t rate;
+
+  /* bandwidth is in kilobits per second */
+  rate = (u_int64_t) IF_DEF_PARAMS (ei->ifp)->bandwidth * 1000 / 8;
+  rate = rate * IF_DEF_PARAMS (ei->ifp)->bandwidth_percent / 100;
+
+  return rate ? rate : 1;
+}
+
+/* Add credit earned since last refill, up to one full batch of packets */
+static void
+eigrp_pace_refill (struct eigrp_interface *ei)
+{
+  struct timeval now;
+  unsigned long elapsed;
+  int64_t burst = (int64_t) EIGRP_WRITE_BATCH * ei->ifp->mtu;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  elapsed = timeval_elapsed (now, ei->pace_last);
+  ei->pace_last = now;
+
+  if (elapsed > 1000000L)
+    elapsed = 1000000L;
+
+  ei->pace_credit += eigrp_pace_rate (ei) * elapsed / 1000000L;
+  if (ei->pace_credit > burst)
+    ei->pace_credit = burst;
+}
+
+/* Hellos and acks keep adjacencies up, they are never held back */
+static int
+eigrp_pace_hold (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  struct eigrp_header *eigrph = (struct eigrp_header *) STREAM_DATA(ep->s);
+
+  return (ei->pace_credit <= 0) && (eigrph->opcode != EIGRP_OPC_HELLO);
+}
+
+/* Pacing delay is over, put interface back on write queue */
+static int
+eigrp_pace_timer (struct thread *thread)
+{
+  struct eigrp_interface *ei = THREAD_ARG(thread);
+  struct eigrp *eigrp = ei->eigrp;
+
+  ei->t_pace = NULL;
+
+  if (ei->obuf == NULL || eigrp_fifo_tail(ei->obuf) == NULL)
+    return 0;
+
+  if (ei->on_write_q == 0)
+    {
+      listnode_add(eigrp->oi_write_q, ei);
+      ei->on_write_q = 1;
+    }
+  if (eigrp->t_write == NULL)
+    eigrp->t_write = thread_add_write(master, eigrp_write, eigrp, eigrp->fd);
+
+  return 0;
+}
+
+/*
+ * Send up to max packets from interface output queue with one system
+ * call. Batch stops at first packet held back by pacing or sent with
+ * different flags (multicast or unicast). Returns number of packets
+ * removed from queue.
+ */
+static int
+eigrp_write_batch (struct eigrp *eigrp, struct eigrp_interface *ei, int max)
 {
-  struct eigrp *eigrp = THREAD_ARG(thread);
   struct eigrp_header *eigrph;
-  struct eigrp_interface *ei;
   struct eigrp_packet *ep;
-  struct sockaddr_in sa_dst;
-  struct ip iph;
-  struct msghdr msg;
-  struct iovec iov[2];
+  struct sockaddr_in sa_dst[EIGRP_WRITE_BATCH];
+  struct ip iph[EIGRP_WRITE_BATCH];
+  struct iovec iov[EIGRP_WRITE_BATCH][2];
+  u_int16_t len[EIGRP_WRITE_BATCH];
+#ifdef HAVE_SENDMMSG
+  struct mmsghdr msgs[EIGRP_WRITE_BATCH];
+#else
+  struct msghdr msgs[EIGRP_WRITE_BATCH];
+#endif /* HAVE_SENDMMSG */
+  struct msghdr *msg;
   u_int16_t opcode = 0;
-
-  int ret;
-  int flags = 0;
-  struct listnode *node;
+  int flags = 0, pflags;
+  int ret, i, n = 0;
 #ifdef WANT_EIGRP_WRITE_FRAGMENT
   static u_int16_t ipid = 0;
 #endif /* WANT_EIGRP_WRITE_FRAGMENT */
 #define EIGRP_WRITE_IPHL_SHIFT 2
 
-  eigrp->t_write = NULL;
-
-  node = listhead(eigrp->oi_write_q);
-  assert(node);
-  ei = listgetdata(node);
-  assert(ei);
-
 #ifdef WANT_EIGRP_WRITE_FRAGMENT
   /* seed ipid static with low order bits of time */
   if (ipid == 0)
   ipid = (time(NULL) & 0xffff);
 #endif /* WANT_EIGRP_WRITE_FRAGMENT */
 
-  /* Get one packet from queue. */
-  ep = eigrp_fifo_head(ei->obuf);
-  assert(ep);
-  assert(ep->length >= EIGRP_HEADER_LEN);
+  if (max > EIGRP_WRITE_BATCH)
+    max = EIGRP_WRITE_BATCH;
+
+  eigrp_pace_refill (ei);
+
+  memset(msgs, 0, sizeof(msgs));
+
+  /* Oldest packets are at the tail of the queue. */
+  for (ep = eigrp_fifo_tail(ei->obuf); ep && n < max; ep = ep->previous)
+    {
+      assert(ep->length >= EIGRP_HEADER_LEN);
 
-  if (ep->dst.s_addr == htonl(EIGRP_MULTICAST_ADDRESS))
-    eigrp_if_ipmulticast(eigrp, ei->address, ei->ifp->ifindex);
+      /* Set DONTROUTE flag if dst is unicast. */
+      pflags = IN_MULTICAST(htonl(ep->dst.s_addr)) ? 0 : MSG_DONTROUTE;
+      if (n > 0 && pflags != flags)
+        break;
+      if (eigrp_pace_hold (ei, ep))
+        break;
+      flags = pflags;
 
-  memset(&iph, 0, sizeof(struct ip));
-  memset(&sa_dst, 0, sizeof(sa_dst));
+      memset(&iph[n], 0, sizeof(struct ip));
+      memset(&sa_dst[n], 0, sizeof(struct sockaddr_in));
 
-  sa_dst.sin_family = AF_INET;
+      sa_dst[n].sin_family = AF_INET;
 #ifdef HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
-  sa_dst.sin_len = sizeof(sa_dst);
+      sa_dst[n].sin_len = sizeof(struct sockaddr_in);
 #endif /* HAVE_STRUCT_SOCKADDR_IN_SIN_LEN */
-  sa_dst.sin_addr = ep->dst;
-  sa_dst.sin_port = htons(0);
+      sa_dst[n].sin_addr = ep->dst;
+      sa_dst[n].sin_port = htons(0);
 
-  /* Set DONTROUTE flag if dst is unicast. */
-  if (!IN_MULTICAST(htonl(ep->dst.s_addr)))
-    flags = MSG_DONTROUTE;
+      iph[n].ip_hl = sizeof(struct ip) >> EIGRP_WRITE_IPHL_SHIFT;
+      /* it'd be very strange for header to not be 4byte-word aligned but.. */
+      if (sizeof(struct ip) > (unsigned int)(iph[n].ip_hl << EIGRP_WRITE_IPHL_SHIFT))
+        iph[n].ip_hl++; /* we presume sizeof struct ip cant overflow ip_hl.. */
 
-  iph.ip_hl = sizeof(struct ip) >> EIGRP_WRITE_IPHL_SHIFT;
-  /* it'd be very strange for header to not be 4byte-word aligned but.. */
-  if (sizeof(struct ip) > (unsigned int)(iph.ip_hl << EIGRP_WRITE_IPHL_SHIFT))
-    iph.ip_hl++; /* we presume sizeof struct ip cant overflow ip_hl.. */
-
-  iph.ip_v = IPVERSION;
-  iph.ip_tos = IPTOS_PREC_INTERNETCONTROL;
-  iph.ip_len = (iph.ip_hl << EIGRP_WRITE_IPHL_SHIFT) + ep->length;
+      iph[n].ip_v = IPVERSION;
+      iph[n].ip_tos = IPTOS_PREC_INTERNETCONTROL;
+      iph[n].ip_len = len[n] = (iph[n].ip_hl << EIGRP_WRITE_IPHL_SHIFT) + ep->length;
 
 #if defined (__DragonFly__)
-  /*
-   * DragonFly's raw socket expects ip_len/ip_off in network byte order.
-   */
-  iph.ip_len = htons(iph.ip_len);
+      /*
+       * DragonFly's raw socket expects ip_len/ip_off in network byte order.
+       */
+      iph[n].ip_len = htons(iph[n].ip_len);
 #endif
 
-  iph.ip_off = 0;
-  iph.ip_ttl = EIGRP_IP_TTL;
-  iph.ip_p = IPPROTO_EIGRPIGP;
-  iph.ip_sum = 0;
-  iph.ip_src.s_addr = ei->address->u.prefix4.s_addr;
-  iph.ip_dst.s_addr = ep->dst.s_addr;
+      iph[n].ip_off = 0;
+      iph[n].ip_ttl = EIGRP_IP_TTL;
+      iph[n].ip_p = IPPROTO_EIGRPIGP;
+      iph[n].ip_sum = 0;
+      iph[n].ip_src.s_addr = ei->address->u.prefix4.s_addr;
+      iph[n].ip_dst.s_addr = ep->dst.s_addr;
+
+#ifdef HAVE_SENDMMSG
+      msg = &msgs[n].msg_hdr;
+#else
+      msg = &msgs[n];
+#endif /* HAVE_SENDMMSG */
+      msg->msg_name = (caddr_t) &sa_dst[n];
+      msg->msg_namelen = sizeof(struct sockaddr_in);
+      msg->msg_iov = iov[n];
+      msg->msg_iovlen = 2;
+
+      iov[n][0].iov_base = (char*)&iph[n];
+      iov[n][0].iov_len = iph[n].ip_hl << EIGRP_WRITE_IPHL_SHIFT;
+      iov[n][1].iov_base = STREAM_DATA(ep->s);
+      iov[n][1].iov_len = ep->length;
+
+      ei->pace_credit -= len[n];
+      n++;
+    }
+
+  if (n == 0)
+    return 0;
+
+  /* Socket remembers outgoing multicast interface, set it only on change */
+  if (flags == 0 && eigrp->mcast_ifindex != ei->ifp->ifindex)
+    {
+      if (eigrp_if_ipmulticast(eigrp, ei->address, ei->ifp->ifindex) < 0)
+        eigrp->mcast_ifindex = 0;
+      else
+        eigrp->mcast_ifindex = ei->ifp->ifindex;
+    }
 
-  memset(&msg, 0, sizeof(msg));
-  msg.msg_name = (caddr_t) &sa_dst;
-  msg.msg_namelen = sizeof(sa_dst);
-  msg.msg_iov = iov;
-  msg.msg_iovlen = 2;
+  for (i = 0; i < n; i++)
+    sockopt_iphdrincl_swab_htosys(&iph[i]);
 
-  iov[0].iov_base = (char*)&iph;
-  iov[0].iov_len = iph.ip_hl << EIGRP_WRITE_IPHL_SHIFT;
-  iov[1].iov_base = STREAM_PNT(ep->s);
-  iov[1].iov_len = ep->length;
+#ifdef HAVE_SENDMMSG
+  ret = sendmmsg(eigrp->fd, msgs, n, flags);
+#else
+  for (ret = 0; ret < n; ret++)
+    if (sendmsg(eigrp->fd, &msgs[ret], flags) < 0)
+      break;
+  if (ret == 0)
+    ret = -1;
+#endif /* HAVE_SENDMMSG */
 
-  /* send final fragment (could be first) */
-  sockopt_iphdrincl_swab_htosys(&iph);
-  ret = sendmsg(eigrp->fd, &msg, flags);
-  sockopt_iphdrincl_swab_systoh(&iph);
+  for (i = 0; i < n; i++)
+    sockopt_iphdrincl_swab_systoh(&iph[i]);
 
-  if (IS_DEBUG_EIGRP_TRANSMIT(0, SEND))
+  if (ret < 0)
     {
-      eigrph = (struct eigrp_header *) STREAM_DATA(ep->s);
-      opcode = eigrph->opcode;
-      zlog_debug("Sending [%s] to [%s] via [%s] ret [%d].",
-		 LOOKUP(eigrp_packet_type_str, opcode), inet_ntoa(ep->dst),
-		 IF_NAME(ei), ret);
+      zlog_warn("*** sendmsg in eigrp_write failed to %s, "
+                "id %d, off %d, len %d, interface %s, mtu %u: %s",
+                inet_ntoa(iph[0].ip_dst), iph[0].ip_id, iph[0].ip_off,
+                iph[0].ip_len, ei->ifp->name, ei->ifp->mtu,
+                safe_strerror(errno));
+      /* failed packet is dropped, others stay queued */
+      ret = 1;
     }
 
-  if (ret < 0)
-    zlog_warn("*** sendmsg in eigrp_write failed to %s, "
-	      "id %d, off %d, len %d, interface %s, mtu %u: %s",
-	      inet_ntoa(iph.ip_dst), iph.ip_id, iph.ip_off, iph.ip_len, ei->ifp->name,
-	      ei->ifp->mtu, safe_strerror(errno));
+  /* Packets not sent are not paid for */
+  for (i = ret; i < n; i++)
+    ei->pace_credit += len[i];
 
-  /* Show debug sending packet. */
-  if (IS_DEBUG_EIGRP_TRANSMIT(0, SEND) && (IS_DEBUG_EIGRP_TRANSMIT(0, PACKET_DETAIL)))
+  for (i = 0; i < ret; i++)
     {
-      zlog_debug("-----------------------------------------------------");
-      eigrp_ip_header_dump(&iph);
-      stream_set_getp(ep->s, 0);
-      eigrp_packet_dump(ep->s);
-      zlog_debug("-----------------------------------------------------");
+      ep = eigrp_fifo_tail(ei->obuf);
+
+      if (IS_DEBUG_EIGRP_TRANSMIT(0, SEND))
+        {
+          eigrph = (struct eigrp_header *) STREAM_DATA(ep->s);
+          opcode = eigrph->opcode;
+          zlog_debug("Sending [%s] to [%s] via [%s] ret [%d].",
+                     LOOKUP(eigrp_packet_type_str, opcode), inet_ntoa(ep->dst),
+                     IF_NAME(ei), len[i]);
+        }
+
+      /* Show debug sending packet. */
+      if (IS_DEBUG_EIGRP_TRANSMIT(0, SEND) && (IS_DEBUG_EIGRP_TRANSMIT(0, PACKET_DETAIL)))
+        {
+          zlog_debug("-----------------------------------------------------");
+          eigrp_ip_header_dump(&iph[i]);
+          stream_set_getp(ep->s, 0);
+          eigrp_packet_dump(ep->s);
+          zlog_debug("-----------------------------------------------------");
+        }
+
+      /* Now delete packet from queue. */
+      eigrp_packet_delete(ei);
     }
 
-  /* Now delete packet from queue. */
-  eigrp_packet_delete(ei);
+  return ret;
+}
 
-  if (eigrp_fifo_head(ei->obuf) == NULL)
+/*
+ * Write thread. Interfaces on write queue are served round robin, each
+ * with batch of packets per turn, until queues are empty, wakeup budget
+ * is used or remaining interfaces are held back by pacing.
+ */
+int
+eigrp_write (struct thread *thread)
+{
+  struct eigrp *eigrp = THREAD_ARG(thread);
+  struct eigrp_interface *ei;
+  struct listnode *node, *nnode;
+  int budget = EIGRP_WRITE_BUDGET;
+  int sent, round;
+
+  eigrp->t_write = NULL;
+
+  do
     {
-      ei->on_write_q = 0;
-      list_delete_node(eigrp->oi_write_q, node);
+      round = 0;
+
+      for (ALL_LIST_ELEMENTS (eigrp->oi_write_q, node, nnode, ei))
+        {
+          if (budget <= 0)
+            break;
+
+          sent = eigrp_write_batch(eigrp, ei, budget);
+          budget -= sent;
+          round += sent;
+
+          if (eigrp_fifo_tail(ei->obuf) == NULL)
+            {
+              ei->on_write_q = 0;
+              list_delete_node(eigrp->oi_write_q, node);
+            }
+          else if (eigrp_pace_hold(ei, eigrp_fifo_tail(ei->obuf)))
+            {
+              /* wait until interface earns credit for next packet */
+              ei->on_write_q = 0;
+              list_delete_node(eigrp->oi_write_q, node);
+              THREAD_TIMER_MSEC_ON(master, ei->t_pace, eigrp_pace_timer, ei,
+                                   1 + (-ei->pace_credit) * 1000
+                                       / eigrp_pace_rate(ei));
+            }
+        }
     }
+  while (budget > 0 && round > 0 && !list_isempty(eigrp->oi_write_q));
 
   /* If packets still remain in queue, call write thread. */
   if (!list_isempty(eigrp->oi_write_q))
@@ -488,35 +653,20 @@ eigrp_write (struct thread *thread)
   return 0;
 }
 
-/* Starting point of packet process function. */
-int
-eigrp_read (struct thread *thread)
+/* Process one received datagram, ifp is interface it came from. */
+static int
+eigrp_read_packet (struct eigrp *eigrp, struct stream *ibuf,
+                   struct interface *ifp)
 {
   int ret;
-  struct stream *ibuf;
-  struct eigrp *eigrp;
   struct eigrp_interface *ei;
   struct ip *iph;
   struct eigrp_header *eigrph;
-  struct interface *ifp;
   struct eigrp_neighbor *nbr;
 
   u_int16_t opcode = 0;
   u_int16_t length = 0;
 
-  /* first of all get interface pointer. */
-  eigrp = THREAD_ARG(thread);
-
-  /* prepare for next packet. */
-  eigrp->t_read = thread_add_read(master, eigrp_read, eigrp, eigrp->fd);
-
-  stream_reset(eigrp->ibuf);
-  if (!(ibuf = eigrp_recv_packet(eigrp->fd, &ifp, eigrp->ibuf)))
-    {
-      /* This raw packet is known to be at least as big as its IP header. */
-      return -1;
-    }
-
   /* Note that there should not be alignment problems with this assignment
    because this is at the beginning of the stream data buffer. */
   iph = (struct ip *)STREAM_DATA(ibuf);
@@ -530,7 +680,7 @@ eigrp_read (struct thread *thread)
   if (IS_DEBUG_EIGRP_TRANSMIT(0, RECV) && IS_DEBUG_EIGRP_TRANSMIT(0, PACKET_DETAIL))
       eigrp_ip_header_dump(iph);
 
-  /* Note that sockopt_iphdrincl_swab_systoh was called in eigrp_recv_packet. */
+  /* Note that sockopt_iphdrincl_swab_systoh was called in eigrp_recv_check. */
   if (ifp == NULL)
     {
       /* Handle cases where the platform does not support retrieving the ifindex,
@@ -564,7 +714,7 @@ eigrp_read (struct thread *thread)
     }
 
   /* Advance from IP header to EIGRP header (iph->ip_hl has been verified
-   by eigrp_recv_packet() to be correct). */
+   by eigrp_recv_check() to be correct). */
 
   stream_forward_getp(ibuf, (iph->ip_hl * 4));
   eigrph = (struct eigrp_header *) STREAM_PNT(ibuf);
@@ -645,6 +795,22 @@ eigrp_read (struct thread *thread)
   /* Read rest of the packet and call each sort of packet routine. */
   stream_forward_getp(ibuf, EIGRP_HEADER_LEN);
 
+  /* Conditionally received packet is accepted only when announced
+   * to us by preceding Sequence Hello. */
+  if (ntohl(eigrph->flags) & EIGRP_CR_FLAG)
+    {
+      nbr = eigrp_nbr_lookup_by_addr(ei, &iph->ip_src);
+      if (nbr == NULL || !nbr->cr_mode
+          || nbr->cr_sequence != ntohl(eigrph->sequence))
+        {
+          if (IS_DEBUG_EIGRP_TRANSMIT(0, RECV))
+            zlog_debug("Ignoring CR packet Seq [%u] from [%s]",
+                       ntohl(eigrph->sequence), inet_ntoa(iph->ip_src));
+          return 0;
+        }
+      nbr->cr_mode = 0;
+    }
+
 
   /* New testing block of code for handling Acks */
   if (ntohl(eigrph->ack) != 0)
@@ -670,7 +836,7 @@ eigrp_read (struct thread *thread)
                  eigrp_update_send_EOT(nbr);
                }
              ep = eigrp_fifo_pop_tail(nbr->retrans_queue);
-             /*eigrp_packet_free(ep);*/
+             eigrp_packet_free(ep);
              if (nbr->retrans_queue->count > 0)
                {
                  eigrp_send_packet_reliably(nbr);
@@ -729,33 +895,21 @@ eigrp_read (struct thread *thread)
   return 0;
 }
 
+/*
+ * Check datagram of ret bytes received into ibuf and find interface it
+ * arrived on. Returns NULL if datagram is to be dropped.
+ */
 static struct stream *
-eigrp_recv_packet (int fd, struct interface **ifp, struct stream *ibuf)
+eigrp_recv_check (struct stream *ibuf, int ret, struct msghdr *msgh,
+                  struct interface **ifp)
 {
-  int ret;
   struct ip *iph;
   u_int16_t ip_len;
   unsigned int ifindex = 0;
-  struct iovec iov;
-  /* Header and data both require alignment. */
-  char buff[CMSG_SPACE(SOPT_SIZE_CMSG_IFINDEX_IPV4())];
-  struct msghdr msgh;
-
-  memset(&msgh, 0, sizeof(struct msghdr));
-  msgh.msg_iov = &iov;
-  msgh.msg_iovlen = 1;
-  msgh.msg_control = (caddr_t) buff;
-  msgh.msg_controllen = sizeof(buff);
 
-  ret = stream_recvmsg(ibuf, fd, &msgh, 0, (EIGRP_PACKET_MAX_LEN + 1));
-  if (ret < 0)
-    {
-      zlog_warn("stream_recvmsg failed: %s", safe_strerror(errno));
-      return NULL;
-    }
   if ((unsigned int) ret < sizeof(iph)) /* ret must be > 0 now */
     {
-      zlog_warn("eigrp_recv_packet: discarding runt packet of length %d "
+      zlog_warn("eigrp_recv_check: discarding runt packet of length %d "
           "(ip header size is %u)", ret, (u_int) sizeof(iph));
       return NULL;
     }
@@ -794,13 +948,13 @@ eigrp_recv_packet (int fd, struct interface **ifp, struct stream *ibuf)
   ip_len = ntohs(iph->ip_len) + (iph->ip_hl << 2);
 #endif
 
-  ifindex = getsockopt_ifindex(AF_INET, &msgh);
+  ifindex = getsockopt_ifindex(AF_INET, msgh);
 
   *ifp = if_lookup_by_index(ifindex);
 
   if (ret != ip_len)
     {
-      zlog_warn("eigrp_recv_packet read length mismatch: ip_len is %d, "
+      zlog_warn("eigrp_recv_check read length mismatch: ip_len is %d, "
 		"but recvmsg returned %d", ip_len, ret);
       return NULL;
     }
@@ -808,6 +962,123 @@ eigrp_recv_packet (int fd, struct interface **ifp, struct stream *ibuf)
   return ibuf;
 }
 
+/*
+ * Receive up to max datagrams waiting on socket into receive stream
+ * pool, one system call when recvmmsg() is available. valid[i] tells
+ * whether datagram i passed the checks. Returns number of datagrams.
+ */
+static int
+eigrp_recv_batch (struct eigrp *eigrp, struct interface **ifp, int *valid,
+                  int max)
+{
+  struct iovec iov[EIGRP_READ_BATCH];
+  /* Header and data both require alignment. */
+  char buff[EIGRP_READ_BATCH][CMSG_SPACE(SOPT_SIZE_CMSG_IFINDEX_IPV4())];
+#ifdef HAVE_RECVMMSG
+  struct mmsghdr msgs[EIGRP_READ_BATCH];
+#else
+  struct msghdr msgs[EIGRP_READ_BATCH];
+  int lens[EIGRP_READ_BATCH];
+#endif /* HAVE_RECVMMSG */
+  struct msghdr *msgh;
+  int i, n, ret;
+
+  if (max > EIGRP_READ_BATCH)
+    max = EIGRP_READ_BATCH;
+
+  memset(msgs, 0, sizeof(msgs));
+  for (i = 0; i < max; i++)
+    {
+#ifdef HAVE_RECVMMSG
+      msgh = &msgs[i].msg_hdr;
+#else
+      msgh = &msgs[i];
+#endif /* HAVE_RECVMMSG */
+      stream_reset(eigrp->ibuf[i]);
+      iov[i].iov_base = STREAM_DATA(eigrp->ibuf[i]);
+      iov[i].iov_len = EIGRP_PACKET_MAX_LEN + 1;
+      msgh->msg_iov = &iov[i];
+      msgh->msg_iovlen = 1;
+      msgh->msg_control = (caddr_t) buff[i];
+      msgh->msg_controllen = sizeof(buff[i]);
+    }
+
+#ifdef HAVE_RECVMMSG
+  n = recvmmsg(eigrp->fd, msgs, max, MSG_DONTWAIT, NULL);
+#else
+  for (n = 0; n < max; n++)
+    if ((lens[n] = recvmsg(eigrp->fd, &msgs[n], MSG_DONTWAIT)) < 0)
+      break;
+  if (n == 0)
+    n = -1;
+#endif /* HAVE_RECVMMSG */
+
+  if (n < 0)
+    {
+      if (!ERRNO_IO_RETRY(errno))
+        zlog_warn("eigrp_recv_batch failed: %s", safe_strerror(errno));
+      return 0;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+#ifdef HAVE_RECVMMSG
+      msgh = &msgs[i].msg_hdr;
+      ret = msgs[i].msg_len;
+#else
+      msgh = &msgs[i];
+      ret = lens[i];
+#endif /* HAVE_RECVMMSG */
+      stream_set_endp(eigrp->ibuf[i], ret);
+      valid[i] = (eigrp_recv_check(eigrp->ibuf[i], ret, msgh, &ifp[i]) != NULL);
+    }
+
+  return n;
+}
+
+/*
+ * Starting point of packet process function. Datagrams are received in
+ * batches and processed in order until socket is drained or packet or
+ * time budget of this wakeup is used, so timers (hellos) keep running
+ * during floods. Read thread is armed again once at the end.
+ */
+int
+eigrp_read (struct thread *thread)
+{
+  struct eigrp *eigrp = THREAD_ARG(thread);
+  struct interface *ifp[EIGRP_READ_BATCH];
+  int valid[EIGRP_READ_BATCH];
+  struct timeval start, now;
+  int budget = EIGRP_READ_BUDGET;
+  int want, n, i;
+
+  eigrp->t_read = NULL;
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &start);
+
+  do
+    {
+      want = MIN(budget, EIGRP_READ_BATCH);
+      n = eigrp_recv_batch(eigrp, ifp, valid, want);
+
+      for (i = 0; i < n; i++)
+        if (valid[i])
+          {
+            eigrp_read_packet(eigrp, eigrp->ibuf[i], ifp[i]);
+            mem_arena_reset(eigrp->pkt_arena);
+          }
+
+      budget -= n;
+      quagga_gettime(QUAGGA_CLK_MONOTONIC, &now);
+    }
+  while (n == want && budget > 0
+         && timeval_elapsed(now, start) < EIGRP_READ_BUDGET_MSEC * 1000);
+
+  /* prepare for next packet. */
+  eigrp->t_read = thread_add_read(master, eigrp_read, eigrp, eigrp->fd);
+
+  return 0;
+}
+
 struct eigrp_fifo *
 eigrp_fifo_new (void)
 {
@@ -859,6 +1130,7 @@ eigrp_packet_new (size_t size)
   new = XCALLOC(MTYPE_EIGRP_PACKET, sizeof(struct eigrp_packet));
   new->s = stream_new(size);
   new->retrans_counter = 0;
+  new->refcnt = 1;
 
   return new;
 }
@@ -873,7 +1145,9 @@ eigrp_send_packet_reliably (struct eigrp_neighbor *nbr)
   if (ep)
     {
       struct eigrp_packet *duplicate;
-      duplicate = eigrp_packet_duplicate(ep, nbr);
+      duplicate = eigrp_packet_share(ep);
+      /* Multicasts queued for this neighbor are repeated by unicast */
+      duplicate->dst = nbr->src;
       /* Add packet to the top of the interface output queue*/
       eigrp_fifo_push_head(nbr->ei->obuf, duplicate);
 
@@ -896,6 +1170,162 @@ eigrp_send_packet_reliably (struct eigrp_neighbor *nbr)
     }
 }
 
+/*
+ * Start new multicast packet of given type for interface. Header and
+ * authentication TLV are encoded, length is set to bytes used so far.
+ */
+struct eigrp_packet *
+eigrp_packet_multicast_new (struct eigrp_interface *ei, int type,
+                            u_int16_t *length)
+{
+  struct eigrp_packet *ep;
+
+  ep = eigrp_packet_new(ei->ifp->mtu);
+  eigrp_packet_header_init(type, ei, ep->s, 0, ei->eigrp->sequence_number, 0);
+  *length = EIGRP_HEADER_LEN;
+
+  // encode Authentication TLV, if needed
+  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+    {
+      *length += eigrp_add_authTLV_MD5_to_stream(ep->s,ei);
+    }
+
+  return ep;
+}
+
+/* Largest EIGRP packet which fits into interface MTU */
+size_t
+eigrp_packet_max_length (struct eigrp_interface *ei)
+{
+  return ei->ifp->mtu - sizeof(struct ip);
+}
+
+/* Put packet on interface output queue and schedule write thread. */
+static void
+eigrp_packet_output (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  eigrp_fifo_push_head(ei->obuf, ep);
+
+  if (ei->on_write_q == 0)
+    {
+      listnode_add(ei->eigrp->oi_write_q, ei);
+      ei->on_write_q = 1;
+    }
+  if (ei->eigrp->t_write == NULL)
+    ei->eigrp->t_write =
+      thread_add_write(master, eigrp_write, ei->eigrp, ei->eigrp->fd);
+}
+
+/* Set sequence, digest and checksum of fully encoded multicast packet. */
+static void
+eigrp_packet_multicast_finish (struct eigrp_interface *ei,
+                               struct eigrp_packet *ep, u_int16_t length,
+                               u_int32_t sequence)
+{
+  struct eigrp_header *eigrph = (struct eigrp_header *) STREAM_DATA(ep->s);
+
+  eigrph->sequence = htonl(sequence);
+
+  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+    {
+      eigrp_make_md5_digest(ei,ep->s, EIGRP_AUTH_UPDATE_FLAG);
+    }
+
+  /* EIGRP Checksum */
+  eigrph->checksum = 0;
+  eigrp_packet_checksum(ei, ep->s, length);
+  ep->length = length;
+
+  ep->dst.s_addr = htonl(EIGRP_MULTICAST_ADDRESS);
+
+  /*This ack number we await from neighbor*/
+  ep->sequence_number = sequence;
+}
+
+/*
+ * Finish multicast packet started by eigrp_packet_multicast_new() and
+ * put it on retransmission queue of every neighbor on interface which
+ * is up.  Neighbors share one encoded stream, which is freed with the
+ * last acknowledgement.  Each built packet consumes its own sequence
+ * number.
+ *
+ * Packet is multicast once for all neighbors with empty retransmission
+ * queue.  When some neighbors still wait for older packets, multicast
+ * is sent with CR flag, preceded by Hello listing those lagging
+ * neighbors, which get it by unicast after acknowledging what they
+ * have outstanding.
+ */
+void
+eigrp_packet_multicast_enqueue (struct eigrp_interface *ei,
+                                struct eigrp_packet *ep, u_int16_t length)
+{
+  struct listnode *node, *nnode;
+  struct eigrp_neighbor *nbr;
+  struct eigrp_packet *cr = NULL;
+  u_int32_t sequence;
+  int insync = 0, lagging = 0;
+
+  sequence = ei->eigrp->sequence_number++;
+
+  for (ALL_LIST_ELEMENTS(ei->nbrs, node, nnode, nbr))
+    {
+      if (nbr->state != EIGRP_NEIGHBOR_UP)
+        continue;
+      if (nbr->retrans_queue->count == 0)
+        insync++;
+      else
+        lagging++;
+    }
+
+  if (insync && lagging)
+    {
+      /* separate copy, retransmissions must go without CR flag */
+      cr = eigrp_packet_new(ei->ifp->mtu);
+      stream_copy(cr->s, ep->s);
+      ((struct eigrp_header *) STREAM_DATA(cr->s))->flags |=
+        htonl(EIGRP_CR_FLAG);
+      eigrp_packet_multicast_finish(ei, cr, length, sequence);
+    }
+
+  eigrp_packet_multicast_finish(ei, ep, length, sequence);
+
+  if (IS_DEBUG_EIGRP_PACKET(0, RECV))
+    zlog_debug("Enqueuing %s length[%u] Seq [%u] in sync [%d] lagging [%d]",
+               LOOKUP(eigrp_packet_type_str,
+                      ((struct eigrp_header *) STREAM_DATA(ep->s))->opcode),
+               length, ep->sequence_number, insync, lagging);
+
+  for (ALL_LIST_ELEMENTS(ei->nbrs, node, nnode, nbr))
+    {
+      if (nbr->state == EIGRP_NEIGHBOR_UP)
+        {
+          /*Put packet to retransmission queue*/
+          eigrp_fifo_push_head(nbr->retrans_queue,
+                               eigrp_packet_share(ep));
+
+          /* multicast below is the first transmission for neighbor */
+          if (nbr->retrans_queue->count == 1)
+            {
+              struct eigrp_packet *head = eigrp_fifo_tail(nbr->retrans_queue);
+
+              THREAD_TIMER_ON(master, head->t_retrans_timer,
+                              eigrp_unack_packet_retrans, nbr,
+                              EIGRP_PACKET_RETRANS_TIME);
+            }
+        }
+    }
+
+  if (cr)
+    {
+      eigrp_hello_send_sequence(ei, sequence);
+      eigrp_packet_output(ei, cr);
+    }
+  else if (insync)
+    eigrp_packet_output(ei, eigrp_packet_share(ep));
+
+  eigrp_packet_free(ep);
+}
+
 /* Calculate EIGRP checksum */
 void
 eigrp_packet_checksum (struct eigrp_interface *ei, struct stream *s,
@@ -974,7 +1404,7 @@ eigrp_packet_delete (struct eigrp_interface *ei)
 {
   struct eigrp_packet *ep;
 
-  ep = eigrp_fifo_pop (ei->obuf);
+  ep = eigrp_fifo_pop_tail (ei->obuf);
 
   if (ep)
     eigrp_packet_free(ep);
@@ -1006,14 +1436,21 @@ eigrp_fifo_pop (struct eigrp_fifo *fifo)
 void
 eigrp_packet_free (struct eigrp_packet *ep)
 {
-  if (ep->s)
-    stream_free(ep->s);
+  struct eigrp_packet *owner = ep->shared ? ep->shared : ep;
 
   THREAD_OFF(ep->t_retrans_timer);
 
-  XFREE(MTYPE_EIGRP_PACKET, ep);
+  if (ep != owner)
+    XFREE(MTYPE_EIGRP_PACKET, ep);
 
-  ep = NULL;
+  /* owner lingers until nobody refers to its stream */
+  if (--owner->refcnt > 0)
+    return;
+
+  if (owner->s)
+    stream_free(owner->s);
+
+  XFREE(MTYPE_EIGRP_PACKET, owner);
 }
 
 /* EIGRP Header verification. */
@@ -1071,7 +1508,8 @@ eigrp_unack_packet_retrans (struct thread *thread)
   if (ep)
     {
       struct eigrp_packet *duplicate;
-      duplicate = eigrp_packet_duplicate(ep, nbr);
+      duplicate = eigrp_packet_share(ep);
+      duplicate->dst = nbr->src;
 
       /* Add packet to the top of the interface output queue*/
       eigrp_fifo_push_head(nbr->ei->obuf, duplicate);
@@ -1110,7 +1548,7 @@ eigrp_unack_multicast_packet_retrans (struct thread *thread)
   if (ep)
     {
       struct eigrp_packet *duplicate;
-      duplicate = eigrp_packet_duplicate(ep, nbr);
+      duplicate = eigrp_packet_share(ep);
       /* Add packet to the top of the interface output queue*/
       eigrp_fifo_push_head(nbr->ei->obuf, duplicate);
 
@@ -1159,27 +1597,39 @@ eigrp_fifo_pop_tail (struct eigrp_fifo *fifo)
   return ep;
 }
 
+/*
+ * Return new packet referring to the same encoded stream as old one.
+ * Stream is not copied and must not be changed any more, it is freed
+ * together with the last packet referring to it.
+ */
 struct eigrp_packet *
-eigrp_packet_duplicate (struct eigrp_packet *old, struct eigrp_neighbor *nbr)
+eigrp_packet_share (struct eigrp_packet *old)
 {
   struct eigrp_packet *new;
+  struct eigrp_packet *owner = old->shared ? old->shared : old;
+
+  new = XCALLOC(MTYPE_EIGRP_PACKET, sizeof(struct eigrp_packet));
+  new->s = owner->s;
+  new->shared = owner;
+  owner->refcnt++;
 
-  new = eigrp_packet_new(nbr->ei->ifp->mtu);
   new->length = old->length;
   new->retrans_counter = old->retrans_counter;
   new->dst = old->dst;
   new->sequence_number = old->sequence_number;
-  stream_copy(new->s, old->s);
 
   return new;
 }
 
 struct TLV_IPv4_Internal_type *
-eigrp_read_ipv4_tlv (struct stream *s)
+eigrp_read_ipv4_tlv (struct stream *s, struct mem_arena *arena)
 {
   struct TLV_IPv4_Internal_type *tlv;
+  struct eigrp_metrics metric;
+  size_t start = stream_get_getp(s);
+  size_t shift;
 
-  tlv = eigrp_IPv4_InternalTLV_new ();
+  tlv = mem_arena_alloc (arena, sizeof (struct TLV_IPv4_Internal_type));
 
   tlv->type = stream_getw(s);
   tlv->length = stream_getw(s);
@@ -1194,6 +1644,10 @@ eigrp_read_ipv4_tlv (struct stream *s)
   tlv->metric.load = stream_getc(s);
   tlv->metric.tag = stream_getc(s);
   tlv->metric.flags = stream_getc(s);
+  /* TLV is packed, convert aligned copy of metric */
+  metric = tlv->metric;
+  eigrp_metric_classic_to_wide(&metric);
+  tlv->metric = metric;
 
   tlv->prefix_length = stream_getc(s);
 
@@ -1228,15 +1682,327 @@ eigrp_read_ipv4_tlv (struct stream *s)
           + (tlv->destination_part[2] << 16) + (tlv->destination_part[1] << 8)
           + tlv->destination_part[0]);
     }
+
+  /*
+   * More destinations sharing this metric may follow in the same TLV.
+   * Slide TLV header over the destination just read, so the rest of the
+   * TLV is parsed as a TLV of its own by the next read.
+   */
+  shift = stream_get_getp(s) - start - EIGRP_TLV_IPv4_INT_FIXED_LEN;
+  if (tlv->length >= EIGRP_TLV_IPv4_INT_FIXED_LEN + shift + 2
+      && start + tlv->length <= stream_get_endp(s))
+    {
+      u_char *hdr = STREAM_DATA(s) + start;
+      u_int16_t rest = htons(tlv->length - shift);
+
+      memmove(hdr + shift, hdr, EIGRP_TLV_IPv4_INT_FIXED_LEN);
+      memcpy(hdr + shift + 2, &rest, sizeof(rest));
+      stream_set_getp(s, start + shift);
+      tlv->length = EIGRP_TLV_IPv4_INT_FIXED_LEN + shift;
+    }
+
   return tlv;
 }
 
+/*
+ * Read IPv4 external TLV. Metric and destination are returned the same
+ * way as for internal TLV, so DUAL handles both alike; external data
+ * (originator, source protocol, tag) is returned separately in ext,
+ * unless ext is NULL.
+ */
+struct TLV_IPv4_Internal_type *
+eigrp_read_ipv4_ext_tlv (struct stream *s, struct TLV_IPv4_External_type **ext,
+                         struct mem_arena *arena)
+{
+  struct TLV_IPv4_Internal_type *tlv;
+  struct TLV_IPv4_External_type *data;
+  struct eigrp_metrics metric;
+  size_t start = stream_get_getp(s);
+  int i, psize;
+
+  tlv = mem_arena_alloc (arena, sizeof (struct TLV_IPv4_Internal_type));
+  data = eigrp_IPv4_ExternalTLV_new ();
+
+  tlv->type = data->type = stream_getw(s);
+  tlv->length = data->length = stream_getw(s);
+  data->next_hop.s_addr = stream_get_ipv4(s);
+  data->originating_router.s_addr = stream_get_ipv4(s);
+  data->originating_as = stream_getl(s);
+  data->administrative_tag = stream_getl(s);
+  data->external_metric = stream_getl(s);
+  data->reserved = stream_getw(s);
+  data->external_protocol = stream_getc(s);
+  data->external_flags = stream_getc(s);
+
+  tlv->forward = data->next_hop;
+  tlv->metric.delay = stream_getl(s);
+  tlv->metric.bandwith = stream_getl(s);
+  tlv->metric.mtu[0] = stream_getc(s);
+  tlv->metric.mtu[1] = stream_getc(s);
+  tlv->metric.mtu[2] = stream_getc(s);
+  tlv->metric.hop_count = stream_getc(s);
+  tlv->metric.reliability = stream_getc(s);
+  tlv->metric.load = stream_getc(s);
+  tlv->metric.tag = stream_getc(s);
+  tlv->metric.flags = stream_getc(s);
+  metric = tlv->metric;
+  eigrp_metric_classic_to_wide(&metric);
+  tlv->metric = metric;
+  data->metric = tlv->metric;
+
+  tlv->prefix_length = data->prefix_length = stream_getc(s);
+  if (tlv->prefix_length > IPV4_MAX_BITLEN)
+    tlv->prefix_length = data->prefix_length = IPV4_MAX_BITLEN;
+
+  /* default route is sent with one destination byte too */
+  psize = PSIZE(tlv->prefix_length);
+  if (psize == 0)
+    psize = 1;
+  for (i = 0; i < psize; i++)
+    tlv->destination_part[i] = stream_getc(s);
+  memcpy(&tlv->destination, tlv->destination_part, sizeof(tlv->destination));
+  memcpy(data->destination_part, tlv->destination_part,
+         sizeof(data->destination_part));
+  data->destination = tlv->destination;
+
+  /* skip whatever else sender put into TLV */
+  if (start + tlv->length > stream_get_getp(s)
+      && start + tlv->length <= stream_get_endp(s))
+    stream_set_getp(s, start + tlv->length);
+
+  if (ext)
+    *ext = data;
+  else
+    eigrp_IPv4_ExternalTLV_free (data);
+
+  return tlv;
+}
+
+/*
+ * Read multi-protocol (2.0) route TLV with wide metric.  Route is returned
+ * in the same form as classic TLVs are, with classic metric derived from
+ * wide one, so DUAL does not care which version neighbor speaks.  TLVs of
+ * other address families are skipped and NULL is returned.
+ */
+static struct TLV_IPv4_Internal_type *
+eigrp_read_mp_tlv (struct stream *s, struct TLV_IPv4_External_type **ext,
+                   struct mem_arena *arena)
+{
+  struct TLV_IPv4_Internal_type *tlv;
+  struct TLV_IPv4_External_type *data = NULL;
+  struct eigrp_metrics metric;
+  size_t start = stream_get_getp(s);
+  size_t fixed;
+  u_int16_t afi;
+  u_char offset;
+  int i, psize;
+
+  tlv = mem_arena_alloc (arena, sizeof (struct TLV_IPv4_Internal_type));
+
+  tlv->type = stream_getw(s);
+  tlv->length = stream_getw(s);
+  fixed = (tlv->type == EIGRP_TLV_MP_EXT) ? EIGRP_TLV_MP_EXT_FIXED_LEN
+                                          : EIGRP_TLV_MP_INT_FIXED_LEN;
+
+  if (tlv->length < fixed + 1 || start + tlv->length > stream_get_endp(s))
+    {
+      stream_set_getp(s, stream_get_endp(s));
+      return NULL;
+    }
+
+  stream_getw(s);               /* topology, only base one is supported */
+  afi = stream_getw(s);
+  stream_getl(s);               /* router id of sender */
+
+  /*Wide metric*/
+  offset = stream_getc(s);
+  stream_getc(s);               /* priority */
+  tlv->metric.reliability = stream_getc(s);
+  tlv->metric.load = stream_getc(s);
+  tlv->metric.mtu[0] = stream_getc(s);
+  tlv->metric.mtu[1] = stream_getc(s);
+  tlv->metric.mtu[2] = stream_getc(s);
+  tlv->metric.hop_count = stream_getc(s);
+  tlv->metric.wide_delay = (u_int64_t) stream_getw(s) << 32;
+  tlv->metric.wide_delay |= stream_getl(s);
+  tlv->metric.wide_bandwidth = (u_int64_t) stream_getw(s) << 32;
+  tlv->metric.wide_bandwidth |= stream_getl(s);
+  stream_getw(s);               /* reserved */
+  tlv->metric.flags = stream_getw(s) & 0xFF;
+
+  if (afi != EIGRP_AF_IPv4
+      || tlv->length < fixed + 1 + offset * 2)
+    {
+      stream_set_getp(s, start + tlv->length);
+      return NULL;
+    }
+
+  /* extended metrics are not used */
+  stream_forward_getp(s, offset * 2);
+  metric = tlv->metric;
+  eigrp_metric_wide_to_classic(&metric);
+  tlv->metric = metric;
+
+  if (tlv->type == EIGRP_TLV_MP_EXT)
+    {
+      data = eigrp_IPv4_ExternalTLV_new ();
+      data->type = EIGRP_TLV_IPv4_EXT;
+      data->length = tlv->length;
+      data->originating_router.s_addr = stream_get_ipv4(s);
+      data->originating_as = stream_getl(s);
+      data->administrative_tag = stream_getl(s);
+      data->external_metric = stream_getl(s);
+      data->reserved = stream_getw(s);
+      data->external_protocol = stream_getc(s);
+      data->external_flags = stream_getc(s);
+      data->metric = tlv->metric;
+    }
+
+  tlv->forward.s_addr = stream_get_ipv4(s);
+
+  tlv->prefix_length = stream_getc(s);
+  if (tlv->prefix_length > IPV4_MAX_BITLEN)
+    tlv->prefix_length = IPV4_MAX_BITLEN;
+
+  psize = PSIZE(tlv->prefix_length);
+  if (psize == 0)
+    psize = 1;
+  if (start + tlv->length < stream_get_getp(s) + psize)
+    psize = start + tlv->length - stream_get_getp(s);
+  for (i = 0; i < psize; i++)
+    tlv->destination_part[i] = stream_getc(s);
+  memcpy(&tlv->destination, tlv->destination_part, sizeof(tlv->destination));
+
+  /* rest of daemon sees it as classic TLV */
+  tlv->type = data ? EIGRP_TLV_IPv4_EXT : EIGRP_TLV_IPv4_INT;
+  stream_set_getp(s, start + tlv->length);
+
+  if (data)
+    {
+      data->next_hop = tlv->forward;
+      data->prefix_length = tlv->prefix_length;
+      memcpy(data->destination_part, tlv->destination_part,
+             sizeof(data->destination_part));
+      data->destination = tlv->destination;
+    }
+
+  if (ext)
+    *ext = data;
+  else if (data)
+    eigrp_IPv4_ExternalTLV_free (data);
+
+  return tlv;
+}
+
+/*
+ * Read any route TLV of given type, see EIGRP_TLV_IS_ROUTE.  External
+ * data is returned in ext (NULL for internal routes) unless ext is NULL.
+ * Returns NULL if TLV carries no IPv4 route.  Returned TLV lives in arena
+ * of received packet, external data is caller's to keep or free.
+ */
+struct TLV_IPv4_Internal_type *
+eigrp_read_route_tlv (struct stream *s, u_int16_t type,
+                      struct TLV_IPv4_External_type **ext,
+                      struct mem_arena *arena)
+{
+  if (ext)
+    *ext = NULL;
+
+  switch (type)
+    {
+    case EIGRP_TLV_IPv4_INT:
+      return eigrp_read_ipv4_tlv(s, arena);
+    case EIGRP_TLV_IPv4_EXT:
+      return eigrp_read_ipv4_ext_tlv(s, ext, arena);
+    default:
+      return eigrp_read_mp_tlv(s, ext, arena);
+    }
+}
+
+/*
+ * Write route as multi-protocol (2.0) TLV with wide metric.  Such TLVs
+ * carry single destination each.
+ */
+static u_int16_t
+eigrp_add_mpTLV_to_stream (struct stream *s, struct eigrp_prefix_entry *pe)
+{
+  struct TLV_IPv4_External_type *ext = pe->extTLV;
+  struct eigrp_metrics *metric = &pe->reported_metric;
+  struct eigrp *eigrp = eigrp_lookup ();
+  u_int64_t delay, bandwidth;
+  u_int16_t length;
+  int i, psize;
+
+  psize = PSIZE(pe->destination_ipv4->prefixlen);
+  if (psize == 0)
+    psize = 1;
+  length = (ext ? EIGRP_TLV_MP_EXT_FIXED_LEN : EIGRP_TLV_MP_INT_FIXED_LEN)
+      + 1 + psize;
+
+  /* routes made unreachable mark classic delay only */
+  delay = metric->wide_delay;
+  if (metric->delay == EIGRP_MAX_METRIC || delay > EIGRP_MAX_WIDE_VALUE)
+    delay = EIGRP_MAX_WIDE_VALUE;
+  bandwidth = metric->wide_bandwidth;
+  if (bandwidth > EIGRP_MAX_WIDE_VALUE)
+    bandwidth = EIGRP_MAX_WIDE_VALUE;
+
+  stream_putw(s, ext ? EIGRP_TLV_MP_EXT : EIGRP_TLV_MP_INT);
+  stream_putw(s, length);
+  stream_putw(s, 0x0000);       /* base topology */
+  stream_putw(s, EIGRP_AF_IPv4);
+  stream_put_ipv4(s, eigrp->router_id);
+
+  /*Wide metric, no extended metrics*/
+  stream_putc(s, 0);
+  stream_putc(s, 0);
+  stream_putc(s, metric->reliability);
+  stream_putc(s, metric->load);
+  stream_putc(s, metric->mtu[2]);
+  stream_putc(s, metric->mtu[1]);
+  stream_putc(s, metric->mtu[0]);
+  stream_putc(s, metric->hop_count);
+  stream_putw(s, (delay >> 32) & 0xFFFF);
+  stream_putl(s, delay & 0xFFFFFFFF);
+  stream_putw(s, (bandwidth >> 32) & 0xFFFF);
+  stream_putl(s, bandwidth & 0xFFFFFFFF);
+  stream_putw(s, 0x0000);
+  stream_putw(s, metric->flags);
+
+  if (ext)
+    {
+      /*External data*/
+      stream_put_ipv4(s, ext->originating_router.s_addr);
+      stream_putl(s, ext->originating_as);
+      stream_putl(s, ext->administrative_tag);
+      stream_putl(s, ext->external_metric);
+      stream_putw(s, 0x0000);
+      stream_putc(s, ext->external_protocol);
+      stream_putc(s, ext->external_flags);
+    }
+
+  stream_putl(s, 0x00000000);
+
+  stream_putc(s, pe->destination_ipv4->prefixlen);
+  for (i = 0; i < psize; i++)
+    stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> (8 * i)) & 0xFF);
+
+  return length;
+}
+
 u_int16_t
 eigrp_add_internalTLV_to_stream (struct stream *s,
-    struct eigrp_prefix_entry *pe)
+    struct eigrp_prefix_entry *pe, int wide)
 {
   u_int16_t length;
 
+  if (wide)
+    return eigrp_add_mpTLV_to_stream(s, pe);
+
+  /* route redistributed somewhere in AS keeps being advertised as external */
+  if (pe->extTLV)
+    return eigrp_add_externalTLV_to_stream(s, pe);
+
   stream_putw(s, EIGRP_TLV_IPv4_INT);
   if (pe->destination_ipv4->prefixlen <= 8)
     {
@@ -1305,6 +2071,116 @@ eigrp_add_internalTLV_to_stream (struct stream *s,
   return length;
 }
 
+u_int16_t
+eigrp_add_externalTLV_to_stream (struct stream *s,
+    struct eigrp_prefix_entry *pe)
+{
+  struct TLV_IPv4_External_type *ext = pe->extTLV;
+  u_int16_t length;
+  int i, psize;
+
+  psize = PSIZE(pe->destination_ipv4->prefixlen);
+  if (psize == 0)
+    psize = 1;
+  length = EIGRP_TLV_IPv4_EXT_FIXED_LEN + 1 + psize;
+
+  stream_putw(s, EIGRP_TLV_IPv4_EXT);
+  stream_putw(s, length);
+  stream_putl(s, 0x00000000);
+
+  /*External data*/
+  stream_put_ipv4(s, ext->originating_router.s_addr);
+  stream_putl(s, ext->originating_as);
+  stream_putl(s, ext->administrative_tag);
+  stream_putl(s, ext->external_metric);
+  stream_putw(s, 0x0000);
+  stream_putc(s, ext->external_protocol);
+  stream_putc(s, ext->external_flags);
+
+  /*Metric*/
+  stream_putl(s, pe->reported_metric.delay);
+  stream_putl(s, pe->reported_metric.bandwith);
+  stream_putc(s, pe->reported_metric.mtu[2]);
+  stream_putc(s, pe->reported_metric.mtu[1]);
+  stream_putc(s, pe->reported_metric.mtu[0]);
+  stream_putc(s, pe->reported_metric.hop_count);
+  stream_putc(s, pe->reported_metric.reliability);
+  stream_putc(s, pe->reported_metric.load);
+  stream_putc(s, pe->reported_metric.tag);
+  stream_putc(s, pe->reported_metric.flags);
+
+  stream_putc(s, pe->destination_ipv4->prefixlen);
+  for (i = 0; i < psize; i++)
+    stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> (8 * i)) & 0xFF);
+
+  return length;
+}
+
+/*
+ * Append route for prefix to packet being built.  If previous route TLV
+ * of the packet (last_tlv, 0 if none) carries the same next hop and
+ * metric, only prefix length and destination are appended to it.
+ * Wide (2.0) TLVs are never joined.
+ * Returns number of bytes added, or 0 if prefix doesn't fit below limit.
+ */
+u_int16_t
+eigrp_add_internalTLV_packed (struct stream *s, struct eigrp_prefix_entry *pe,
+                              size_t *last_tlv, size_t limit, int wide)
+{
+  size_t start = stream_get_endp(s);
+  u_char *data;
+  u_int16_t length, dlen, tlv_len;
+
+  if (wide)
+    {
+      if (start + EIGRP_TLV_MP_EXT_FIXED_LEN + 5 > limit)
+        return 0;
+      *last_tlv = 0;
+      return eigrp_add_mpTLV_to_stream(s, pe);
+    }
+
+  if (pe->extTLV)
+    {
+      /* external TLVs carry single destination, nothing joins them */
+      if (start + EIGRP_TLV_IPv4_EXT_FIXED_LEN + 5 > limit)
+        return 0;
+      *last_tlv = 0;
+      return eigrp_add_externalTLV_to_stream(s, pe);
+    }
+
+  if (start + EIGRP_TLV_IPv4_INT_FIXED_LEN + 5 > limit)
+    return 0;
+
+  length = eigrp_add_internalTLV_to_stream(s, pe, 0);
+  if (*last_tlv == 0)
+    {
+      *last_tlv = start;
+      return length;
+    }
+
+  data = STREAM_DATA(s);
+  dlen = length - EIGRP_TLV_IPv4_INT_FIXED_LEN;
+  memcpy(&tlv_len, data + *last_tlv + 2, sizeof(tlv_len));
+  tlv_len = ntohs(tlv_len);
+
+  if (memcmp(data + *last_tlv + EIGRP_TLV_HDR_LENGTH,
+             data + start + EIGRP_TLV_HDR_LENGTH,
+             EIGRP_TLV_IPv4_INT_FIXED_LEN - EIGRP_TLV_HDR_LENGTH) != 0
+      || tlv_len + dlen > 0xFFFF)
+    {
+      *last_tlv = start;
+      return length;
+    }
+
+  /* same attributes, move destination into previous TLV */
+  memmove(data + start, data + start + EIGRP_TLV_IPv4_INT_FIXED_LEN, dlen);
+  stream_set_endp(s, start + dlen);
+  tlv_len = htons(tlv_len + dlen);
+  memcpy(data + *last_tlv + 2, &tlv_len, sizeof(tlv_len));
+
+  return dlen;
+}
+
 u_int16_t
 eigrp_add_authTLV_MD5_to_stream (struct stream *s,
     struct eigrp_interface *ei)
@@ -1432,7 +2308,7 @@ eigrp_IPv4_InternalTLV_new ()
 {
   struct TLV_IPv4_Internal_type *new;
 
-  new = XCALLOC(MTYPE_EIGRP_IPV4_INT_TLV,sizeof(struct TLV_IPv4_Internal_type));
+  new = mem_pool_alloc(eigrp_om->int_tlv_pool);
 
   return new;
 }
@@ -1441,7 +2317,24 @@ void
 eigrp_IPv4_InternalTLV_free (struct TLV_IPv4_Internal_type *IPv4_InternalTLV)
 {
 
-  XFREE(MTYPE_EIGRP_IPV4_INT_TLV, IPv4_InternalTLV);
+  mem_pool_free(eigrp_om->int_tlv_pool, IPv4_InternalTLV);
+}
+
+struct TLV_IPv4_External_type *
+eigrp_IPv4_ExternalTLV_new ()
+{
+  struct TLV_IPv4_External_type *new;
+
+  new = mem_pool_alloc(eigrp_om->ext_tlv_pool);
+
+  return new;
+}
+
+void
+eigrp_IPv4_ExternalTLV_free (struct TLV_IPv4_External_type *IPv4_ExternalTLV)
+{
+
+  mem_pool_free(eigrp_om->ext_tlv_pool, IPv4_ExternalTLV);
 }
 
 struct TLV_Sequence_Type *
@@ -38,12 +38,15 @@ extern int eigrp_read (struct thread *);
 extern int eigrp_write (struct thread *);
 
 extern struct eigrp_packet *eigrp_packet_new (size_t);
-extern struct eigrp_packet *eigrp_packet_duplicate (struct eigrp_packet *, struct eigrp_neighbor *);
+extern struct eigrp_packet *eigrp_packet_share (struct eigrp_packet *);
 extern void eigrp_packet_free (struct eigrp_packet *);
 extern void eigrp_packet_delete (struct eigrp_interface *);
 extern void eigrp_packet_header_init (int, struct eigrp_interface *, struct stream *,
 				     u_int32_t, u_int32_t, u_int32_t);
 extern void eigrp_packet_checksum (struct eigrp_interface *, struct stream *, u_int16_t);
+extern struct eigrp_packet *eigrp_packet_multicast_new (struct eigrp_interface *, int, u_int16_t *);
+extern void eigrp_packet_multicast_enqueue (struct eigrp_interface *, struct eigrp_packet *, u_int16_t);
+extern size_t eigrp_packet_max_length (struct eigrp_interface *);
 
 extern struct eigrp_fifo *eigrp_fifo_new (void);
 extern struct eigrp_packet *eigrp_fifo_head (struct eigrp_fifo *);
@@ -56,8 +59,17 @@ extern void eigrp_fifo_reset (struct eigrp_fifo *);
 
 extern void eigrp_send_packet_reliably (struct eigrp_neighbor *);
 
-extern struct TLV_IPv4_Internal_type *eigrp_read_ipv4_tlv (struct stream *);
-extern u_int16_t eigrp_add_internalTLV_to_stream (struct stream *, struct eigrp_prefix_entry *);
+extern struct TLV_IPv4_Internal_type *eigrp_read_ipv4_tlv (struct stream *, struct mem_arena *);
+extern struct TLV_IPv4_Internal_type *eigrp_read_ipv4_ext_tlv (struct stream *,
+                                                               struct TLV_IPv4_External_type **,
+                                                               struct mem_arena *);
+extern struct TLV_IPv4_Internal_type *eigrp_read_route_tlv (struct stream *, u_int16_t,
+                                                            struct TLV_IPv4_External_type **,
+                                                            struct mem_arena *);
+extern u_int16_t eigrp_add_internalTLV_to_stream (struct stream *, struct eigrp_prefix_entry *, int);
+extern u_int16_t eigrp_add_externalTLV_to_stream (struct stream *, struct eigrp_prefix_entry *);
+extern u_int16_t eigrp_add_internalTLV_packed (struct stream *, struct eigrp_prefix_entry *,
+                                               size_t *, size_t, int);
 extern u_int16_t eigrp_add_authTLV_MD5_to_stream (struct stream *, struct eigrp_interface *);
 extern u_int16_t eigrp_add_authTLV_SHA256_to_stream (struct stream *, struct eigrp_interface *);
 
@@ -70,6 +82,7 @@ extern int eigrp_unack_multicast_packet_retrans (struct thread *);
  */
 extern void eigrp_hello_send (struct eigrp_interface *, u_char, struct in_addr *);
 extern void eigrp_hello_send_ack (struct eigrp_neighbor *);
+extern void eigrp_hello_send_sequence (struct eigrp_interface *, u_int32_t);
 extern void eigrp_hello_receive (struct eigrp *, struct ip *, struct eigrp_header *,
 				struct stream *, struct eigrp_interface *, int);
 extern int  eigrp_hello_timer (struct thread *);
@@ -81,10 +94,12 @@ extern void eigrp_update_send (struct eigrp_interface *);
 extern void eigrp_update_receive (struct eigrp *, struct ip *, struct eigrp_header *,
                                 struct stream *, struct eigrp_interface *, int);
 extern void eigrp_update_send_all (struct eigrp *, struct eigrp_interface *);
+extern void eigrp_update_send_filter_delta (struct eigrp_interface *);
 extern void eigrp_update_send_init (struct eigrp_neighbor *);
 extern void eigrp_update_send_EOT (struct eigrp_neighbor *);
 extern int eigrp_update_send_GR_thread(struct thread *);
 extern void eigrp_update_send_GR (struct eigrp_neighbor *, enum GR_type, struct vty *);
+extern void eigrp_update_send_GR_stop (struct eigrp_neighbor *);
 extern void eigrp_update_send_interface_GR (struct eigrp_interface *, enum GR_type, struct vty *);
 extern void eigrp_update_send_process_GR (struct eigrp *, enum GR_type, struct vty *);
 
@@ -134,6 +149,8 @@ extern int eigrp_check_sha256_digest (struct stream *, struct TLV_SHA256_Authent
 
 extern struct TLV_IPv4_Internal_type *eigrp_IPv4_InternalTLV_new (void);
 extern void eigrp_IPv4_InternalTLV_free (struct TLV_IPv4_Internal_type *);
+extern struct TLV_IPv4_External_type *eigrp_IPv4_ExternalTLV_new (void);
+extern void eigrp_IPv4_ExternalTLV_free (struct TLV_IPv4_External_type *);
 
 extern struct TLV_Sequence_Type *eigrp_SequenceTLV_new (void);
 
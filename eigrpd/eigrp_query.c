@@ -52,6 +52,8 @@
 #include "eigrpd/eigrp_macros.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_sia.h"
 
 
 u_int32_t
@@ -80,8 +82,28 @@ eigrp_query_send_all (struct eigrp *eigrp)
     {
       if(pe->req_action & EIGRP_FSM_NEED_QUERY)
         {
+          /* no neighbor was queried (all are stubs or behind summary),
+           * there is no reply to wait for; done while still queued, so
+           * the resulting update is not queued twice */
+          if (pe->rij.count == 0
+              && (pe->state == EIGRP_FSM_STATE_ACTIVE_1
+                  || pe->state == EIGRP_FSM_STATE_ACTIVE_3))
+            {
+              struct eigrp_fsm_action_message msg;
+
+              memset(&msg, 0, sizeof(msg));
+              msg.eigrp = eigrp;
+              msg.prefix = pe;
+              eigrp_fsm_event(&msg, EIGRP_FSM_EVENT_LR);
+            }
+          else if (pe->rij.count)
+            eigrp_sia_start(eigrp, pe);
+
           pe->req_action &= ~EIGRP_FSM_NEED_QUERY;
-          listnode_delete(eigrp->topology_changes_internalIPV4, pe);
+
+          /* keep prefix queued while update is still pending */
+          if (!(pe->req_action & EIGRP_FSM_NEED_UPDATE))
+            listnode_delete(eigrp->topology_changes_internalIPV4, pe);
         }
     }
 
@@ -114,115 +136,115 @@ eigrp_query_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
   while (s->endp > s->getp)
     {
       type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      if (EIGRP_TLV_IS_ROUTE(type))
         {
           stream_set_getp(s, s->getp - sizeof(u_int16_t));
 
-          tlv = eigrp_read_ipv4_tlv(s);
+          tlv = eigrp_read_route_tlv(s, type, NULL, eigrp->pkt_arena);
+          if (tlv == NULL)
+            continue;
 
           struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
+          dest_addr = mem_arena_alloc(eigrp->pkt_arena,
+              sizeof(struct prefix_ipv4));
+          dest_addr->family = AF_INET;
           dest_addr->prefix = tlv->destination;
           dest_addr->prefixlen = tlv->prefix_length;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
               eigrp->topology_table, dest_addr);
 
+          /* our summary is not subject to DUAL, answer it directly */
+          if (dest != NULL && dest->nt == EIGRP_TOPOLOGY_TYPE_SUMMARY)
+            {
+              eigrp_send_reply(nbr, dest);
+            }
           /* If the destination exists (it should, but one never know)*/
-          if (dest != NULL)
+          else if (dest != NULL)
             {
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
+              struct eigrp_fsm_action_message msg;
+              memset(&msg, 0, sizeof(msg));
               struct eigrp_neighbor_entry *entry = eigrp_prefix_entry_lookup(
                   dest->entries, nbr);
-              msg->packet_type = EIGRP_OPC_QUERY;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = dest;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
+              msg.packet_type = EIGRP_OPC_QUERY;
+              msg.eigrp = eigrp;
+              msg.data_type = EIGRP_TLV_IPv4_INT;
+              msg.adv_router = nbr;
+              msg.data.ipv4_int_type = tlv;
+              msg.entry = entry;
+              msg.prefix = dest;
+              int event = eigrp_get_fsm_event(&msg);
+              eigrp_fsm_event(&msg, event);
+            }
+          else
+            {
+              /* unknown here (e.g. hidden behind summary), reply
+               * unreachable at once, so the query goes no further */
+              struct eigrp_prefix_entry unknown;
+
+              memset(&unknown, 0, sizeof(unknown));
+              unknown.destination_ipv4 = dest_addr;
+              unknown.reported_metric = tlv->metric;
+              unknown.reported_metric.delay = EIGRP_MAX_METRIC;
+              eigrp_send_reply(nbr, &unknown);
             }
-          eigrp_IPv4_InternalTLV_free (tlv);
         }
     }
   eigrp_hello_send_ack(nbr);
-  eigrp_query_send_all(eigrp);
-  eigrp_update_send_all(eigrp,nbr->ei);
+  eigrp_fsm_batch_flush(eigrp, nbr->ei);
 }
 
 void
 eigrp_send_query (struct eigrp_interface *ei)
 {
-  struct eigrp_packet *ep, *duplicate;
+  struct eigrp_packet *ep;
   u_int16_t length = EIGRP_HEADER_LEN;
   struct listnode *node, *nnode, *node2, *nnode2;
   struct eigrp_neighbor *nbr;
   struct eigrp_prefix_entry *pe;
-  char has_tlv;
-
-  ep = eigrp_packet_new(ei->ifp->mtu);
-
-  /* Prepare EIGRP INIT UPDATE header */
-  eigrp_packet_header_init(EIGRP_OPC_QUERY, ei, ep->s, 0,
-                           ei->eigrp->sequence_number, 0);
-
-  // encode Authentication TLV, if needed
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
-    {
-      length += eigrp_add_authTLV_MD5_to_stream(ep->s,ei);
-    }
-
-  has_tlv = 0;
+  char has_nbr;
+  size_t last_tlv = 0;
+  size_t limit = eigrp_packet_max_length(ei);
+  int wide = eigrp_if_tlv_wide(ei);
+  u_int16_t added;
+
+  /* packets are started lazily, one per MTU worth of routes */
+  ep = NULL;
   for (ALL_LIST_ELEMENTS(ei->eigrp->topology_changes_internalIPV4, node, nnode, pe))
     {
       if(pe->req_action & EIGRP_FSM_NEED_QUERY)
         {
-          length += eigrp_add_internalTLV_to_stream(ep->s, pe);
+          /* neighbors behind summary never learned component from us */
+          if (eigrp_summary_suppressed(ei, pe))
+            continue;
+
+          has_nbr = 0;
           for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr))
             {
-        	  if(nbr->state == EIGRP_NEIGHBOR_UP)
+        	  /* stub neighbors are never queried */
+        	  if(nbr->state == EIGRP_NEIGHBOR_UP && nbr->stub == 0)
         	  {
-        		  listnode_add(pe->rij, nbr);
-                  has_tlv = 1;
+        		  eigrp_nbr_set_add(&pe->rij, nbr);
+        		  has_nbr = 1;
         	  }
             }
-        }
-    }
+          if (!has_nbr)
+            continue;
 
-  if(!has_tlv)
-    {
-      eigrp_packet_free(ep);
-      return;
-    }
-
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
-    {
-      eigrp_make_md5_digest(ei,ep->s, EIGRP_AUTH_UPDATE_FLAG);
+          if (ep == NULL)
+            ep = eigrp_packet_multicast_new(ei, EIGRP_OPC_QUERY, &length);
+          added = eigrp_add_internalTLV_packed(ep->s, pe, &last_tlv, limit, wide);
+          if (added == 0)
+            {
+              /* packet is full, send it and continue in next one */
+              eigrp_packet_multicast_enqueue(ei, ep, length);
+              ep = eigrp_packet_multicast_new(ei, EIGRP_OPC_QUERY, &length);
+              last_tlv = 0;
+              added = eigrp_add_internalTLV_packed(ep->s, pe, &last_tlv, limit, wide);
+            }
+          length += added;
+        }
     }
 
-  /* EIGRP Checksum */
-    eigrp_packet_checksum(ei, ep->s, length);
-
-    ep->length = length;
-    ep->dst.s_addr = htonl(EIGRP_MULTICAST_ADDRESS);
-
-    /*This ack number we await from neighbor*/
-    ep->sequence_number = ei->eigrp->sequence_number;
-
-    for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr))
-      {
-        if (nbr->state == EIGRP_NEIGHBOR_UP)
-          {
-            /*Put packet to retransmission queue*/
-            eigrp_fifo_push_head(nbr->retrans_queue, ep);
-
-            if (nbr->retrans_queue->count == 1)
-              {
-                eigrp_send_packet_reliably(nbr);
-              }
-          }
-      }
+  if (ep)
+    eigrp_packet_multicast_enqueue(ei, ep, length);
 }
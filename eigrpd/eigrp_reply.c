@@ -70,14 +70,18 @@ eigrp_send_reply (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
   struct prefix_list *plist_i;
   struct eigrp *e;
   struct prefix_ipv4 *dest_addr;
-  struct eigrp_prefix_entry *pe2;
+  struct eigrp_prefix_entry pe2;
+
+  /* successor which queried us may be gone meanwhile */
+  if (nbr == NULL)
+    return;
 
   //TODO: Work in progress
   /* Filtering */
   /* get list from eigrp process */
   e = eigrp_lookup();
-  pe2 = XCALLOC(MTYPE_EIGRP_PREFIX_ENTRY, sizeof(struct eigrp_prefix_entry));
-  memcpy(pe2,pe,sizeof(struct eigrp_prefix_entry));
+  /* copy only carries metric changed by filtering into the packet */
+  pe2 = *pe;
   /* Get access-lists and prefix-lists from process and interface */
   alist = e->list[EIGRP_FILTER_OUT];
   plist = e->prefix[EIGRP_FILTER_OUT];
@@ -87,13 +91,13 @@ eigrp_send_reply (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
 
   zlog_info("REPLY SEND Prefix: %s", inet_ntoa(nbr->src));
   /* Check if any list fits */
-  if ((alist && access_list_apply (alist, (struct prefix *) pe2->destination_ipv4) == FILTER_DENY)||
-	  (plist && prefix_list_apply (plist, (struct prefix *) pe2->destination_ipv4) == FILTER_DENY)||
-	  (alist_i && access_list_apply (alist_i, (struct prefix *) pe2->destination_ipv4) == FILTER_DENY)||
-	  (plist_i && prefix_list_apply (plist_i, (struct prefix *) pe2->destination_ipv4) == FILTER_DENY))
+  if ((alist && access_list_apply (alist, (struct prefix *) pe2.destination_ipv4) == FILTER_DENY)||
+	  (plist && prefix_list_apply (plist, (struct prefix *) pe2.destination_ipv4) == FILTER_DENY)||
+	  (alist_i && access_list_apply (alist_i, (struct prefix *) pe2.destination_ipv4) == FILTER_DENY)||
+	  (plist_i && prefix_list_apply (plist_i, (struct prefix *) pe2.destination_ipv4) == FILTER_DENY))
   {
     zlog_info("REPLY SEND: Setting Metric to max");
-    pe2->reported_metric.delay = EIGRP_MAX_METRIC;
+    pe2.reported_metric.delay = EIGRP_MAX_METRIC;
 
   } else {
     zlog_info("REPLY SEND: Not setting metric");
@@ -117,7 +121,8 @@ eigrp_send_reply (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
     }
 
 
-  length += eigrp_add_internalTLV_to_stream(ep->s, pe2);
+  length += eigrp_add_internalTLV_to_stream(ep->s, &pe2,
+                                            eigrp_nbr_tlv_wide(nbr));
 
   if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
     {
@@ -172,14 +177,18 @@ eigrp_reply_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
   while (s->endp > s->getp)
     {
       type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      if (EIGRP_TLV_IS_ROUTE(type))
         {
           stream_set_getp(s, s->getp - sizeof(u_int16_t));
 
-          tlv = eigrp_read_ipv4_tlv(s);
+          tlv = eigrp_read_route_tlv(s, type, NULL, eigrp->pkt_arena);
+          if (tlv == NULL)
+            continue;
 
           struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
+          dest_addr = mem_arena_alloc(eigrp->pkt_arena,
+              sizeof(struct prefix_ipv4));
+          dest_addr->family = AF_INET;
           dest_addr->prefix = tlv->destination;
           dest_addr->prefixlen = tlv->prefix_length;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
@@ -189,9 +198,8 @@ eigrp_reply_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
            */
           assert(dest);
 
-          struct eigrp_fsm_action_message *msg;
-          msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-              sizeof(struct eigrp_fsm_action_message));
+          struct eigrp_fsm_action_message msg;
+          memset(&msg, 0, sizeof(msg));
           struct eigrp_neighbor_entry *entry = eigrp_prefix_entry_lookup(
               dest->entries, nbr);
 
@@ -228,20 +236,20 @@ eigrp_reply_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 		   * End of filtering
 		   */
 
-		  msg->packet_type = EIGRP_OPC_REPLY;
-		  msg->eigrp = eigrp;
-		  msg->data_type = EIGRP_TLV_IPv4_INT;
-		  msg->adv_router = nbr;
-		  msg->data.ipv4_int_type = tlv;
-		  msg->entry = entry;
-		  msg->prefix = dest;
-		  int event = eigrp_get_fsm_event(msg);
-		  eigrp_fsm_event(msg, event);
+		  msg.packet_type = EIGRP_OPC_REPLY;
+		  msg.eigrp = eigrp;
+		  msg.data_type = EIGRP_TLV_IPv4_INT;
+		  msg.adv_router = nbr;
+		  msg.data.ipv4_int_type = tlv;
+		  msg.entry = entry;
+		  msg.prefix = dest;
+		  int event = eigrp_get_fsm_event(&msg);
+		  eigrp_fsm_event(&msg, event);
 
 
-          eigrp_IPv4_InternalTLV_free (tlv);
         }
     }
   eigrp_hello_send_ack(nbr);
+  eigrp_fsm_batch_flush(eigrp, NULL);
 }
 
@@ -12,11 +12,10 @@
  *   Martin Kontsek
  *   Lukas Koribsky
  *
- * Note: This file contains skeleton for all possible matches and sets,
- * but they are hidden in comment block and not properly implemented.
- * At this time, the only function we consider useful for our use
- * in distribute command in EIGRP is matching destination IP (with both
- * access and prefix list).
+ * Note: This file contains skeleton for all possible matches and sets.
+ * Matches and `set tag' work on redistributed routes (struct
+ * eigrp_external); `set metric' and `set ip next-hop' are still hidden
+ * in comment block and not properly implemented.
  *
  *
  * This file is part of GNU Zebra.
@@ -54,6 +53,7 @@
 #include "eigrpd/eigrp_const.h"
 #include "eigrpd/eigrp_macros.h"
 #include "eigrpd/eigrp_routemap.h"
+#include "eigrpd/eigrp_external.h"
 
 void
 eigrp_if_rmap_update (struct if_rmap *if_rmap)
@@ -253,8 +253,12 @@ eigrp_route_map_update (const char *notused)
       for (i = 0; i < ZEBRA_ROUTE_MAX; i++)
 	{
 	  if (e->route_map[i].name)
-	    e->route_map[i].map =
-	      route_map_lookup_by_name (e->route_map[i].name);
+	    {
+	      e->route_map[i].map =
+	        route_map_lookup_by_name (e->route_map[i].name);
+	      /* route-map contents may have changed */
+	      eigrp_external_routes_refresh (e, i);
+	    }
 	}
     }
 }
@@ -267,31 +271,20 @@ static route_map_result_t
 route_match_metric (void *rule, struct prefix *prefix,
 		    route_map_object_t type, void *object)
 {
-//  u_int32_t *metric;
-//  u_int32_t  check;
-//  struct rip_info *rinfo;
-//  struct eigrp_neighbor_entry *te;
-//  struct eigrp_prefix_entry *pe;
-//  struct listnode *node, *node2, *nnode, *nnode2;
-//  struct eigrp *e;
-//
-//  e = eigrp_lookup();
-//
-//  if (type == RMAP_EIGRP)
-//    {
-//      metric = rule;
-//      rinfo = object;
-//
-//      /* If external metric is available, the route-map should
-//         work on this one (for redistribute purpose)  */
-//      /*check = (rinfo->external_metric) ? rinfo->external_metric :
-//                                         rinfo->metric;*/
-//
-//      if (check == *metric)
-//	return RMAP_MATCH;
-//      else
-//	return RMAP_NOMATCH;
-//    }
+  u_int32_t *metric;
+  struct eigrp_external *ext;
+
+  if (type == RMAP_EIGRP)
+    {
+      metric = rule;
+      ext = object;
+
+      /* redistributed route is matched by metric of its source protocol */
+      if (ext->metric == *metric)
+	return RMAP_MATCH;
+      else
+	return RMAP_NOMATCH;
+    }
   return RMAP_NOMATCH;
 }
 
@@ -299,16 +292,12 @@ route_match_metric (void *rule, struct prefix *prefix,
 static void *
 route_match_metric_compile (const char *arg)
 {
-//  u_int32_t *metric;
-//
-//  metric = XMALLOC (MTYPE_ROUTE_MAP_COMPILED, sizeof (u_int32_t));
-//  *metric = atoi (arg);
-//
-//  if(*metric > 0)
-//    return metric;
-//
-//  XFREE (MTYPE_ROUTE_MAP_COMPILED, metric);
-  return NULL;
+  u_int32_t *metric;
+
+  metric = XMALLOC (MTYPE_ROUTE_MAP_COMPILED, sizeof (u_int32_t));
+  *metric = strtoul (arg, NULL, 10);
+
+  return metric;
 }
 
 /* Free route map's compiled `match metric' value. */
@@ -333,25 +322,25 @@ static route_map_result_t
 route_match_interface (void *rule, struct prefix *prefix,
 		       route_map_object_t type, void *object)
 {
-//  struct rip_info *rinfo;
-//  struct interface *ifp;
-//  char *ifname;
-//
-//  if (type == RMAP_EIGRP)
-//    {
-//      ifname = rule;
-//      ifp = if_lookup_by_name(ifname);
-//
-//      if (!ifp)
-//	return RMAP_NOMATCH;
-//
-//      rinfo = object;
-//
-//      /*if (rinfo->ifindex_out == ifp->ifindex || rinfo->ifindex == ifp->ifindex)
-//	return RMAP_MATCH;
-//      else
-//	return RMAP_NOMATCH;*/
-//    }
+  struct eigrp_external *ext;
+  struct interface *ifp;
+  char *ifname;
+
+  if (type == RMAP_EIGRP)
+    {
+      ifname = rule;
+      ifp = if_lookup_by_name(ifname);
+
+      if (!ifp)
+	return RMAP_NOMATCH;
+
+      ext = object;
+
+      if (ext->ifindex == ifp->ifindex)
+	return RMAP_MATCH;
+      else
+	return RMAP_NOMATCH;
+    }
   return RMAP_NOMATCH;
 }
 
@@ -386,24 +375,24 @@ static route_map_result_t
 route_match_ip_next_hop (void *rule, struct prefix *prefix,
 			route_map_object_t type, void *object)
 {
-//  struct access_list *alist;
-//  struct rip_info *rinfo;
-//  struct prefix_ipv4 p;
-//
-//  if (type == RMAP_EIGRP)
-//    {
-//      rinfo = object;
-//      p.family = AF_INET;
-//      /*p.prefix = (rinfo->nexthop.s_addr) ? rinfo->nexthop : rinfo->from;*/
-//      p.prefixlen = IPV4_MAX_BITLEN;
-//
-//      alist = access_list_lookup (AFI_IP, (char *) rule);
-//      if (alist == NULL)
-//	return RMAP_NOMATCH;
-//
-//      return (access_list_apply (alist, &p) == FILTER_DENY ?
-//	      RMAP_NOMATCH : RMAP_MATCH);
-//    }
+  struct access_list *alist;
+  struct eigrp_external *ext;
+  struct prefix_ipv4 p;
+
+  if (type == RMAP_EIGRP)
+    {
+      ext = object;
+      p.family = AF_INET;
+      p.prefix = ext->nexthop;
+      p.prefixlen = IPV4_MAX_BITLEN;
+
+      alist = access_list_lookup (AFI_IP, (char *) rule);
+      if (alist == NULL)
+	return RMAP_NOMATCH;
+
+      return (access_list_apply (alist, &p) == FILTER_DENY ?
+	      RMAP_NOMATCH : RMAP_MATCH);
+    }
   return RMAP_NOMATCH;
 }
 
@@ -437,24 +426,24 @@ static route_map_result_t
 route_match_ip_next_hop_prefix_list (void *rule, struct prefix *prefix,
                                     route_map_object_t type, void *object)
 {
-//  struct prefix_list *plist;
-//  struct rip_info *rinfo;
-//  struct prefix_ipv4 p;
-//
-//  if (type == RMAP_EIGRP)
-//    {
-//      rinfo = object;
-//      p.family = AF_INET;
-//      /*p.prefix = (rinfo->nexthop.s_addr) ? rinfo->nexthop : rinfo->from;*/
-//      p.prefixlen = IPV4_MAX_BITLEN;
-//
-//      plist = prefix_list_lookup (AFI_IP, (char *) rule);
-//      if (plist == NULL)
-//        return RMAP_NOMATCH;
-//
-//      return (prefix_list_apply (plist, &p) == PREFIX_DENY ?
-//              RMAP_NOMATCH : RMAP_MATCH);
-//    }
+  struct prefix_list *plist;
+  struct eigrp_external *ext;
+  struct prefix_ipv4 p;
+
+  if (type == RMAP_EIGRP)
+    {
+      ext = object;
+      p.family = AF_INET;
+      p.prefix = ext->nexthop;
+      p.prefixlen = IPV4_MAX_BITLEN;
+
+      plist = prefix_list_lookup (AFI_IP, (char *) rule);
+      if (plist == NULL)
+        return RMAP_NOMATCH;
+
+      return (prefix_list_apply (plist, &p) == PREFIX_DENY ?
+              RMAP_NOMATCH : RMAP_MATCH);
+    }
   return RMAP_NOMATCH;
 }
 
@@ -570,20 +559,19 @@ static route_map_result_t
 route_match_tag (void *rule, struct prefix *prefix,
 		    route_map_object_t type, void *object)
 {
-//  u_short *tag;
-//  struct rip_info *rinfo;
-//
-//  if (type == RMAP_EIGRP)
-//    {
-//      tag = rule;
-//      rinfo = object;
-//
-//      /* The information stored by rinfo is host ordered. */
-//      /*if (rinfo->tag == *tag)
-//	return RMAP_MATCH;
-//      else
-//	return RMAP_NOMATCH;*/
-//    }
+  u_short *tag;
+  struct eigrp_external *ext;
+
+  if (type == RMAP_EIGRP)
+    {
+      tag = rule;
+      ext = object;
+
+      if (ext->tag == *tag)
+	return RMAP_MATCH;
+      else
+	return RMAP_NOMATCH;
+    }
   return RMAP_NOMATCH;
 }
 
@@ -591,12 +579,12 @@ route_match_tag (void *rule, struct prefix *prefix,
 static void *
 route_match_tag_compile (const char *arg)
 {
-//  u_short *tag;
-//
-//  tag = XMALLOC (MTYPE_ROUTE_MAP_COMPILED, sizeof (u_short));
-//  *tag = atoi (arg);
-//
-//  return tag;
+  u_short *tag;
+
+  tag = XMALLOC (MTYPE_ROUTE_MAP_COMPILED, sizeof (u_short));
+  *tag = atoi (arg);
+
+  return tag;
 }
 
 /* Free route map's compiled `match tag' value. */
@@ -779,19 +767,18 @@ static route_map_result_t
 route_set_tag (void *rule, struct prefix *prefix,
 		      route_map_object_t type, void *object)
 {
-//  u_short *tag;
-//  struct rip_info *rinfo;
-//
-//  if(type == RMAP_RIP)
-//    {
-//      /* Fetch routemap's rule information. */
-//      tag = rule;
-//      rinfo = object;
-//
-//      /* Set next hop value. */
-//      rinfo->tag_out = *tag;
-//    }
+  u_short *tag;
+  struct eigrp_external *ext;
 
+  if(type == RMAP_EIGRP)
+    {
+      /* Fetch routemap's rule information. */
+      tag = rule;
+      ext = object;
+
+      /* Set administrative tag of external route. */
+      ext->tag = *tag;
+    }
   return RMAP_OKAY;
 }
 
@@ -800,12 +787,12 @@ route_set_tag (void *rule, struct prefix *prefix,
 static void *
 route_set_tag_compile (const char *arg)
 {
-//  u_short *tag;
-//
-//  tag = XMALLOC (MTYPE_ROUTE_MAP_COMPILED, sizeof (u_short));
-//  *tag = atoi (arg);
-//
-//  return tag;
+  u_short *tag;
+
+  tag = XMALLOC (MTYPE_ROUTE_MAP_COMPILED, sizeof (u_short));
+  *tag = atoi (arg);
+
+  return tag;
 }
 
 /* Free route map's compiled `ip nexthop' value. */
@@ -1197,39 +1184,39 @@ eigrp_route_map_init ()
   route_map_add_hook (eigrp_route_map_update);
   route_map_delete_hook (eigrp_route_map_update);
 
-  /*route_map_install_match (&route_match_metric_cmd);
-  route_map_install_match (&route_match_interface_cmd);*/
-  /*route_map_install_match (&route_match_ip_next_hop_cmd);
+  route_map_install_match (&route_match_metric_cmd);
+  route_map_install_match (&route_match_interface_cmd);
+  route_map_install_match (&route_match_ip_next_hop_cmd);
   route_map_install_match (&route_match_ip_next_hop_prefix_list_cmd);
   route_map_install_match (&route_match_ip_address_cmd);
-  route_map_install_match (&route_match_ip_address_prefix_list_cmd);*/
-  /*route_map_install_match (&route_match_tag_cmd);*/
+  route_map_install_match (&route_match_ip_address_prefix_list_cmd);
+  route_map_install_match (&route_match_tag_cmd);
 
   /*route_map_install_set (&route_set_metric_cmd);
-  route_map_install_set (&route_set_ip_nexthop_cmd);
-  route_map_install_set (&route_set_tag_cmd);*/
+  route_map_install_set (&route_set_ip_nexthop_cmd);*/
+  route_map_install_set (&route_set_tag_cmd);
 
-  /*install_element (RMAP_NODE, &route_match_metric_cmd);
+  install_element (RMAP_NODE, &match_metric_cmd);
   install_element (RMAP_NODE, &no_match_metric_cmd);
   install_element (RMAP_NODE, &no_match_metric_val_cmd);
-  install_element (RMAP_NODE, &route_match_interface_cmd);
+  install_element (RMAP_NODE, &match_interface_cmd);
   install_element (RMAP_NODE, &no_match_interface_cmd);
   install_element (RMAP_NODE, &no_match_interface_val_cmd);
-  install_element (RMAP_NODE, &route_match_ip_next_hop_cmd);
+  install_element (RMAP_NODE, &match_ip_next_hop_cmd);
   install_element (RMAP_NODE, &no_match_ip_next_hop_cmd);
   install_element (RMAP_NODE, &no_match_ip_next_hop_val_cmd);
-  install_element (RMAP_NODE, &route_match_ip_next_hop_prefix_list_cmd);
+  install_element (RMAP_NODE, &match_ip_next_hop_prefix_list_cmd);
   install_element (RMAP_NODE, &no_match_ip_next_hop_prefix_list_cmd);
-  install_element (RMAP_NODE, &no_match_ip_next_hop_prefix_list_val_cmd);*/
-  /*install_element (RMAP_NODE, &route_match_ip_address_cmd);
+  install_element (RMAP_NODE, &no_match_ip_next_hop_prefix_list_val_cmd);
+  install_element (RMAP_NODE, &match_ip_address_cmd);
   install_element (RMAP_NODE, &no_match_ip_address_cmd);
   install_element (RMAP_NODE, &no_match_ip_address_val_cmd);
-  install_element (RMAP_NODE, &route_match_ip_address_prefix_list_cmd);
+  install_element (RMAP_NODE, &match_ip_address_prefix_list_cmd);
   install_element (RMAP_NODE, &no_match_ip_address_prefix_list_cmd);
-  install_element (RMAP_NODE, &no_match_ip_address_prefix_list_val_cmd);*/
-  /*install_element (RMAP_NODE, &route_match_tag_cmd);
+  install_element (RMAP_NODE, &no_match_ip_address_prefix_list_val_cmd);
+  install_element (RMAP_NODE, &match_tag_cmd);
   install_element (RMAP_NODE, &no_match_tag_cmd);
-  install_element (RMAP_NODE, &no_match_tag_val_cmd);*/
+  install_element (RMAP_NODE, &no_match_tag_val_cmd);
 
   /*install_element (RMAP_NODE, &set_metric_cmd);
   install_element (RMAP_NODE, &set_metric_addsub_cmd);
@@ -1237,8 +1224,8 @@ eigrp_route_map_init ()
   install_element (RMAP_NODE, &no_set_metric_val_cmd);
   install_element (RMAP_NODE, &set_ip_nexthop_cmd);
   install_element (RMAP_NODE, &no_set_ip_nexthop_cmd);
-  install_element (RMAP_NODE, &no_set_ip_nexthop_val_cmd);
+  install_element (RMAP_NODE, &no_set_ip_nexthop_val_cmd);*/
   install_element (RMAP_NODE, &set_tag_cmd);
   install_element (RMAP_NODE, &no_set_tag_cmd);
-  install_element (RMAP_NODE, &no_set_tag_val_cmd);*/
+  install_element (RMAP_NODE, &no_set_tag_val_cmd);
 }
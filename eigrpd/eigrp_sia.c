@@ -0,0 +1,492 @@
+/*
+ * EIGRP Active Timer and Stuck-In-Active Functions.
+ * Copyright (C) 2013-2016
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *   Frantisek Gazo
+ *   Tomas Hvorkovy
+ *   Martin Kontsek
+ *   Lukas Koribsky
+ *
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "prefix.h"
+#include "table.h"
+#include "linklist.h"
+#include "vector.h"
+#include "memory.h"
+#include "log.h"
+#include "if.h"
+#include "vty.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_const.h"
+#include "eigrpd/eigrp_neighbor.h"
+#include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_dump.h"
+#include "eigrpd/eigrp_sia.h"
+
+/*
+ * Route goes active when it is queried.  Its active timer fires at each
+ * half of configured active time: neighbors we still wait for are sent
+ * SIA-Query, and those which did not answer previous SIA-Query with
+ * SIA-Reply are reset.  After EIGRP_SIA_QUERY_MAX SIA-Queries everybody
+ * still not replying is reset.
+ *
+ * Timers of all active routes are kept in hierarchical timer wheel, so
+ * arming and cancelling is constant time and each second tick touches
+ * only timers due in it (plus rare cascades from upper levels), no matter
+ * how many routes are active.  Neighbors are kept in bitmaps indexed by
+ * neighbor id, so looking up a replying neighbor is constant time too.
+ * Active routes are also linked to per-process list, which holds them
+ * even when active timer is disabled or has just expired.
+ */
+
+#define EIGRP_WHEEL_MASK        (EIGRP_WHEEL_SLOTS - 1)
+
+/* Neighbor sets */
+
+int
+eigrp_nbr_set_test (struct eigrp_nbr_set *set, struct eigrp_neighbor *nbr)
+{
+  u_int16_t word = nbr->id / 32;
+
+  if (word >= set->words)
+    return 0;
+
+  return (set->bits[word] >> (nbr->id % 32)) & 1;
+}
+
+void
+eigrp_nbr_set_add (struct eigrp_nbr_set *set, struct eigrp_neighbor *nbr)
+{
+  u_int16_t word = nbr->id / 32;
+
+  if (word >= set->words)
+    {
+      set->bits = XREALLOC (MTYPE_EIGRP_NBR_SET, set->bits,
+                            (word + 1) * sizeof (u_int32_t));
+      memset (set->bits + set->words, 0,
+              (word + 1 - set->words) * sizeof (u_int32_t));
+      set->words = word + 1;
+    }
+
+  if (!eigrp_nbr_set_test (set, nbr))
+    {
+      set->bits[word] |= 1U << (nbr->id % 32);
+      set->count++;
+    }
+}
+
+/* Returns 1 if neighbor was in set */
+int
+eigrp_nbr_set_del (struct eigrp_nbr_set *set, struct eigrp_neighbor *nbr)
+{
+  if (!eigrp_nbr_set_test (set, nbr))
+    return 0;
+
+  set->bits[nbr->id / 32] &= ~(1U << (nbr->id % 32));
+  set->count--;
+
+  return 1;
+}
+
+void
+eigrp_nbr_set_clear (struct eigrp_nbr_set *set)
+{
+  if (set->bits)
+    XFREE (MTYPE_EIGRP_NBR_SET, set->bits);
+  set->bits = NULL;
+  set->words = 0;
+  set->count = 0;
+}
+
+/* Neighbors of set are put to list, so they may be removed meanwhile */
+static void
+eigrp_nbr_set_list (struct eigrp *eigrp, struct eigrp_nbr_set *set,
+                    struct list *list)
+{
+  struct eigrp_neighbor *nbr;
+  u_int32_t bits;
+  u_int16_t word;
+  int bit;
+
+  for (word = 0; word < set->words; word++)
+    for (bits = set->bits[word]; bits; bits &= bits - 1)
+      {
+        bit = ffs (bits) - 1;
+        nbr = vector_lookup (eigrp->nbr_index, word * 32 + bit);
+        if (nbr)
+          listnode_add (list, nbr);
+      }
+}
+
+/* Give neighbor the lowest free id, keeping neighbor sets small */
+void
+eigrp_nbr_id_get (struct eigrp *eigrp, struct eigrp_neighbor *nbr)
+{
+  nbr->id = vector_empty_slot (eigrp->nbr_index);
+  vector_set_index (eigrp->nbr_index, nbr->id, nbr);
+}
+
+void
+eigrp_nbr_id_release (struct eigrp *eigrp, struct eigrp_neighbor *nbr)
+{
+  if (vector_lookup (eigrp->nbr_index, nbr->id) == nbr)
+    vector_unset (eigrp->nbr_index, nbr->id);
+}
+
+/* Timer wheel */
+
+static void
+eigrp_wheel_unlink (struct eigrp_wheel_timer *timer)
+{
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = timer->prev = NULL;
+}
+
+static void
+eigrp_wheel_link (struct eigrp_wheel_timer *head,
+                  struct eigrp_wheel_timer *timer)
+{
+  timer->next = head;
+  timer->prev = head->prev;
+  head->prev->next = timer;
+  head->prev = timer;
+}
+
+static void
+eigrp_wheel_init (struct eigrp_wheel *wheel)
+{
+  int level, i;
+
+  for (level = 0; level < EIGRP_WHEEL_LEVELS; level++)
+    for (i = 0; i < EIGRP_WHEEL_SLOTS; i++)
+      wheel->slot[level][i].next = wheel->slot[level][i].prev =
+          &wheel->slot[level][i];
+}
+
+/* Put timer to slot of the lowest level able to hold its expiry */
+static void
+eigrp_wheel_place (struct eigrp_wheel *wheel, struct eigrp_wheel_timer *timer)
+{
+  u_int32_t delta = timer->expires - wheel->now;
+  int level = 0;
+
+  while (level < EIGRP_WHEEL_LEVELS - 1
+         && delta >= (1U << (EIGRP_WHEEL_BITS * (level + 1))))
+    level++;
+
+  eigrp_wheel_link (&wheel->slot[level][(timer->expires
+                                         >> (EIGRP_WHEEL_BITS * level))
+                                        & EIGRP_WHEEL_MASK],
+                    timer);
+}
+
+static int eigrp_sia_tick (struct thread *);
+
+static void
+eigrp_wheel_add (struct eigrp *eigrp, struct eigrp_wheel_timer *timer,
+                 u_int32_t ticks)
+{
+  struct eigrp_wheel *wheel = &eigrp->sia_wheel;
+  u_int32_t max = (1U << (EIGRP_WHEEL_BITS * EIGRP_WHEEL_LEVELS)) - 1;
+
+  if (timer->next)
+    {
+      eigrp_wheel_unlink (timer);
+      wheel->count--;
+    }
+
+  if (ticks == 0)
+    ticks = 1;
+  if (ticks > max)
+    ticks = max;
+  timer->expires = wheel->now + ticks;
+  eigrp_wheel_place (wheel, timer);
+  wheel->count++;
+
+  if (wheel->t_tick == NULL)
+    wheel->t_tick = thread_add_timer (master, eigrp_sia_tick, eigrp, 1);
+}
+
+static void
+eigrp_wheel_del (struct eigrp *eigrp, struct eigrp_wheel_timer *timer)
+{
+  if (timer->next == NULL)
+    return;
+
+  eigrp_wheel_unlink (timer);
+  eigrp->sia_wheel.count--;
+}
+
+/* Move timers of upper level slot down, level 1 timers go to level 0 */
+static void
+eigrp_wheel_cascade (struct eigrp_wheel *wheel, int level)
+{
+  struct eigrp_wheel_timer *head, *timer;
+
+  head = &wheel->slot[level][(wheel->now >> (EIGRP_WHEEL_BITS * level))
+                             & EIGRP_WHEEL_MASK];
+  while ((timer = head->next) != head)
+    {
+      eigrp_wheel_unlink (timer);
+      eigrp_wheel_place (wheel, timer);
+    }
+}
+
+/* Advance wheel one tick, expired timers are moved to list at head.
+ * They remain armed there, so that eigrp_wheel_del() still counts them
+ * off when they are cancelled before being processed. */
+static void
+eigrp_wheel_advance (struct eigrp_wheel *wheel, struct eigrp_wheel_timer *head)
+{
+  struct eigrp_wheel_timer *slot, *timer;
+  int level;
+
+  wheel->now++;
+
+  for (level = 1; level < EIGRP_WHEEL_LEVELS; level++)
+    {
+      if ((wheel->now >> (EIGRP_WHEEL_BITS * (level - 1))) & EIGRP_WHEEL_MASK)
+        break;
+      eigrp_wheel_cascade (wheel, level);
+    }
+
+  slot = &wheel->slot[0][wheel->now & EIGRP_WHEEL_MASK];
+  while ((timer = slot->next) != slot)
+    {
+      eigrp_wheel_unlink (timer);
+      eigrp_wheel_link (head, timer);
+    }
+}
+
+/* Active timer */
+
+static struct eigrp_prefix_entry *
+eigrp_sia_prefix (struct eigrp_wheel_timer *timer)
+{
+  return (struct eigrp_prefix_entry *)
+      ((char *) timer - offsetof (struct eigrp_prefix_entry, sia_timer));
+}
+
+static u_int32_t
+eigrp_sia_period (struct eigrp *eigrp)
+{
+  return eigrp->active_time * 30;
+}
+
+static void
+eigrp_sia_active_add (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  if (pe->sia_pprev)
+    return;
+
+  pe->sia_next = eigrp->sia_active;
+  if (pe->sia_next)
+    pe->sia_next->sia_pprev = &pe->sia_next;
+  eigrp->sia_active = pe;
+  pe->sia_pprev = &eigrp->sia_active;
+}
+
+static void
+eigrp_sia_active_del (struct eigrp_prefix_entry *pe)
+{
+  if (pe->sia_pprev == NULL)
+    return;
+
+  *pe->sia_pprev = pe->sia_next;
+  if (pe->sia_next)
+    pe->sia_next->sia_pprev = pe->sia_pprev;
+  pe->sia_next = NULL;
+  pe->sia_pprev = NULL;
+}
+
+/* Prefix went active and queries were sent, (re)start its active timer */
+void
+eigrp_sia_start (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  eigrp_nbr_set_clear (&pe->sia_pending);
+  pe->sia_rounds = 0;
+  eigrp_sia_active_add (eigrp, pe);
+
+  if (eigrp->active_time == 0)
+    {
+      eigrp_wheel_del (eigrp, &pe->sia_timer);
+      return;
+    }
+
+  eigrp_wheel_add (eigrp, &pe->sia_timer, eigrp_sia_period (eigrp));
+}
+
+/* Prefix is passive again or is being deleted */
+void
+eigrp_sia_stop (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  eigrp_wheel_del (eigrp, &pe->sia_timer);
+  eigrp_sia_active_del (pe);
+  eigrp_nbr_set_clear (&pe->sia_pending);
+  pe->sia_rounds = 0;
+}
+
+/* Neighbor replied to query of active prefix */
+void
+eigrp_sia_replied (struct eigrp_prefix_entry *pe, struct eigrp_neighbor *nbr)
+{
+  eigrp_nbr_set_del (&pe->rij, nbr);
+  eigrp_nbr_set_del (&pe->sia_pending, nbr);
+}
+
+static void
+eigrp_sia_expire (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  struct list *waiting, *stuck;
+  struct listnode *node;
+  struct eigrp_neighbor *nbr;
+  char prefix[EIGRP_IF_STRING_MAXLEN];
+
+  if (pe->state == EIGRP_FSM_STATE_PASSIVE || pe->rij.count == 0)
+    {
+      eigrp_sia_stop (eigrp, pe);
+      return;
+    }
+
+  waiting = list_new ();
+  stuck = list_new ();
+  eigrp_nbr_set_list (eigrp, &pe->rij, waiting);
+
+  for (ALL_LIST_ELEMENTS_RO (waiting, node, nbr))
+    {
+      if (eigrp_nbr_set_test (&pe->sia_pending, nbr)
+          || pe->sia_rounds >= EIGRP_SIA_QUERY_MAX)
+        listnode_add (stuck, nbr);
+      else
+        {
+          eigrp_nbr_set_add (&pe->sia_pending, nbr);
+          eigrp_send_siaquery (nbr, pe);
+        }
+    }
+  pe->sia_rounds++;
+  eigrp_wheel_add (eigrp, &pe->sia_timer, eigrp_sia_period (eigrp));
+
+  /* resetting neighbor counts as its reply, prefix may go passive
+   * or even be deleted meanwhile, so it is not touched below */
+  strncpy (prefix, eigrp_topology_ip_string (pe), sizeof (prefix) - 1);
+  prefix[sizeof (prefix) - 1] = '\0';
+  for (ALL_LIST_ELEMENTS_RO (stuck, node, nbr))
+    {
+      zlog_warn ("Neighbor %s (%s) is down: stuck in active for %s",
+                 inet_ntoa (nbr->src), ifindex2ifname (nbr->ei->ifp->ifindex),
+                 prefix);
+      eigrp_nbr_hard_restart (nbr, NULL);
+    }
+
+  list_delete (waiting);
+  list_delete (stuck);
+}
+
+static int
+eigrp_sia_tick (struct thread *thread)
+{
+  struct eigrp *eigrp = THREAD_ARG (thread);
+  struct eigrp_wheel *wheel = &eigrp->sia_wheel;
+  struct eigrp_wheel_timer expired, *timer;
+
+  wheel->t_tick = NULL;
+
+  expired.next = expired.prev = &expired;
+  eigrp_wheel_advance (wheel, &expired);
+
+  /* expiry may cancel other expired timers, take them one by one */
+  while ((timer = expired.next) != &expired)
+    {
+      eigrp_wheel_del (eigrp, timer);
+      eigrp_sia_expire (eigrp, eigrp_sia_prefix (timer));
+    }
+
+  if (wheel->count && wheel->t_tick == NULL)
+    wheel->t_tick = thread_add_timer (master, eigrp_sia_tick, eigrp, 1);
+
+  return 0;
+}
+
+/*
+ * Neighbor went down.  Its routes were already withdrawn as its replies
+ * where it had any, here it stops being waited for by prefixes it had
+ * no route for.  Prefix which got its last reply this way finishes its
+ * diffusing computation.
+ */
+void
+eigrp_sia_neighbor_down (struct eigrp *eigrp, struct eigrp_neighbor *nbr)
+{
+  struct eigrp_prefix_entry *pe;
+  struct eigrp_fsm_action_message msg;
+  struct list *done;
+  struct listnode *node;
+
+  if (eigrp->sia_active == NULL)
+    return;
+
+  /* active list holds also untimed and just expired prefixes */
+  done = list_new ();
+  for (pe = eigrp->sia_active; pe; pe = pe->sia_next)
+    {
+      eigrp_nbr_set_del (&pe->sia_pending, nbr);
+      if (eigrp_nbr_set_del (&pe->rij, nbr) && pe->rij.count == 0)
+        listnode_add (done, pe);
+    }
+
+  for (ALL_LIST_ELEMENTS_RO (done, node, pe))
+    {
+      memset (&msg, 0, sizeof (msg));
+      msg.eigrp = eigrp;
+      msg.prefix = pe;
+      msg.adv_router = nbr;
+      eigrp_fsm_event (&msg, eigrp_fsm_last_reply_event (pe));
+    }
+
+  list_delete (done);
+}
+
+void
+eigrp_sia_init (struct eigrp *eigrp)
+{
+  eigrp->active_time = EIGRP_ACTIVE_TIME_DEFAULT;
+  eigrp->nbr_index = vector_init (VECTOR_MIN_SIZE);
+  eigrp_wheel_init (&eigrp->sia_wheel);
+}
+
+void
+eigrp_sia_finish (struct eigrp *eigrp)
+{
+  THREAD_OFF (eigrp->sia_wheel.t_tick);
+  vector_free (eigrp->nbr_index);
+}
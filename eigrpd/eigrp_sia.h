@@ -0,0 +1,51 @@
+/*
+ * EIGRP Active Timer and Stuck-In-Active Functions.
+ * Copyright (C) 2013-2016
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *   Frantisek Gazo
+ *   Tomas Hvorkovy
+ *   Martin Kontsek
+ *   Lukas Koribsky
+ *
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef EIGRPD_EIGRP_SIA_H_
+#define EIGRPD_EIGRP_SIA_H_
+
+extern int eigrp_nbr_set_test (struct eigrp_nbr_set *, struct eigrp_neighbor *);
+extern void eigrp_nbr_set_add (struct eigrp_nbr_set *, struct eigrp_neighbor *);
+extern int eigrp_nbr_set_del (struct eigrp_nbr_set *, struct eigrp_neighbor *);
+extern void eigrp_nbr_set_clear (struct eigrp_nbr_set *);
+extern void eigrp_nbr_id_get (struct eigrp *, struct eigrp_neighbor *);
+extern void eigrp_nbr_id_release (struct eigrp *, struct eigrp_neighbor *);
+
+extern void eigrp_sia_start (struct eigrp *, struct eigrp_prefix_entry *);
+extern void eigrp_sia_stop (struct eigrp *, struct eigrp_prefix_entry *);
+extern void eigrp_sia_replied (struct eigrp_prefix_entry *, struct eigrp_neighbor *);
+extern void eigrp_sia_neighbor_down (struct eigrp *, struct eigrp_neighbor *);
+extern void eigrp_sia_init (struct eigrp *);
+extern void eigrp_sia_finish (struct eigrp *);
+
+#endif /* EIGRPD_EIGRP_SIA_H_ */
@@ -52,6 +52,7 @@
 #include "eigrpd/eigrp_macros.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_sia.h"
 
 
 /*EIGRP SIA-REPLY read function*/
@@ -80,41 +81,53 @@ eigrp_siareply_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header
   while (s->endp > s->getp)
     {
       type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      if (EIGRP_TLV_IS_ROUTE(type))
         {
           stream_set_getp(s, s->getp - sizeof(u_int16_t));
 
-          tlv = eigrp_read_ipv4_tlv(s);
+          tlv = eigrp_read_route_tlv(s, type, NULL, eigrp->pkt_arena);
+          if (tlv == NULL)
+            continue;
 
           struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
+          dest_addr = mem_arena_alloc(eigrp->pkt_arena,
+              sizeof(struct prefix_ipv4));
+          dest_addr->family = AF_INET;
           dest_addr->prefix = tlv->destination;
           dest_addr->prefixlen = tlv->prefix_length;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
               eigrp->topology_table, dest_addr);
 
-          /* If the destination exists (it should, but one never know)*/
-          if (dest != NULL)
+          /* only answers to our SIA-Query of route still active matter */
+          if (dest != NULL && eigrp_nbr_set_test(&dest->rij, nbr))
             {
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
-              struct eigrp_neighbor_entry *entry = eigrp_prefix_entry_lookup(
-                  dest->entries, nbr);
-              msg->packet_type = EIGRP_OPC_SIAQUERY;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = dest;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
+              if (tlv->metric.flags & EIGRP_OPAQUE_ACTIVE)
+                {
+                  /* neighbor still works on our query, keep waiting */
+                  eigrp_nbr_set_del(&dest->sia_pending, nbr);
+                }
+              else
+                {
+                  /* neighbor is passive already, this is its reply */
+                  struct eigrp_fsm_action_message msg;
+                  memset(&msg, 0, sizeof(msg));
+                  struct eigrp_neighbor_entry *entry = eigrp_prefix_entry_lookup(
+                      dest->entries, nbr);
+                  msg.packet_type = EIGRP_OPC_REPLY;
+                  msg.eigrp = eigrp;
+                  msg.data_type = EIGRP_TLV_IPv4_INT;
+                  msg.adv_router = nbr;
+                  msg.data.ipv4_int_type = tlv;
+                  msg.entry = entry;
+                  msg.prefix = dest;
+                  int event = eigrp_get_fsm_event(&msg);
+                  eigrp_fsm_event(&msg, event);
+                }
             }
-          eigrp_IPv4_InternalTLV_free (tlv);
         }
     }
   eigrp_hello_send_ack(nbr);
+  eigrp_fsm_batch_flush(eigrp, NULL);
 }
 
 void
@@ -122,6 +135,7 @@ eigrp_send_siareply (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
 {
   struct eigrp_packet *ep, *duplicate;
   u_int16_t length = EIGRP_HEADER_LEN;
+  u_char flags;
   struct listnode *node, *nnode, *node2, *nnode2;
 
   ep = eigrp_packet_new(nbr->ei->ifp->mtu);
@@ -136,7 +150,12 @@ eigrp_send_siareply (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
       length += eigrp_add_authTLV_MD5_to_stream(ep->s,nbr->ei);
     }
 
-    length += eigrp_add_internalTLV_to_stream(ep->s, pe);
+    /* we are still working on the route */
+    flags = pe->reported_metric.flags;
+    pe->reported_metric.flags |= EIGRP_OPAQUE_ACTIVE;
+    length += eigrp_add_internalTLV_to_stream(ep->s, pe,
+                                              eigrp_nbr_tlv_wide(nbr));
+    pe->reported_metric.flags = flags;
 
   if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
     {
@@ -34,10 +34,35 @@
 #define _ZEBRA_EIGRP_STRUCTS_H_
 
 #include "filter.h"
+#include "vector.h"
 
 #include "eigrpd/eigrp_const.h"
 #include "eigrpd/eigrp_macros.h"
 
+/* Set of neighbors of process, indexed by eigrp_neighbor->id */
+struct eigrp_nbr_set
+{
+  u_int32_t *bits;
+  u_int16_t words;      /* size of bits */
+  u_int16_t count;      /* neighbors in set */
+};
+
+/* Timer wheel entry, embedded into structure it times */
+struct eigrp_wheel_timer
+{
+  struct eigrp_wheel_timer *next, *prev;    /* NULL if not armed */
+  u_int32_t expires;                        /* wheel tick to fire at */
+};
+
+/* Hierarchical timer wheel, see eigrp_sia.c */
+struct eigrp_wheel
+{
+  struct eigrp_wheel_timer slot[EIGRP_WHEEL_LEVELS][EIGRP_WHEEL_SLOTS];
+  u_int32_t now;        /* ticks elapsed */
+  u_int32_t count;      /* armed or expired timers not yet processed */
+  struct thread *t_tick;
+};
+
 /* EIGRP master for system wide configuration and variables. */
 struct eigrp_master
 {
@@ -56,6 +81,12 @@ struct eigrp_master
   /* Various EIGRP global configuration. */
   u_char options;
 
+  /* Pools of frequently created and deleted topology objects. */
+  struct mem_pool *prefix_pool;
+  struct mem_pool *entry_pool;
+  struct mem_pool *int_tlv_pool;
+  struct mem_pool *ext_tlv_pool;
+
 #define EIGRP_MASTER_SHUTDOWN (1 << 0) /* deferred-shutdown */
 };
 
@@ -69,6 +100,10 @@ struct eigrp_metrics
   u_char load;
   u_char tag;
   u_char flags;
+
+  /* wide metric, kept alongside classic one for 2.0 TLVs */
+  u_int64_t wide_delay;     /* picoseconds */
+  u_int64_t wide_bandwidth; /* kbps */
 };
 
 struct eigrp
@@ -76,8 +111,12 @@ struct eigrp
   u_int16_t AS;			/* Autonomous system number */
   u_int16_t vrid;		/* Virtual Router ID */
   u_char    k_values[6];	/*Array for K values configuration*/
+  u_char    k_classic;	/*K-values are K1 = K3 = 1, others zero*/
+  u_char    wide_metrics;	/*64-bit composite metric, 2.0 TLVs to capable peers*/
   u_char variance;              /*Metric variance multiplier*/
   u_char max_paths;             /*Maximum allowed paths for 1 prefix*/
+  u_int16_t active_time;        /*Active timer in minutes, 0 if disabled*/
+  u_int16_t stub;               /*Stub routing flags, 0 if not stub*/
 
   /*Name of this EIGRP instance*/
   char *name;
@@ -87,6 +126,7 @@ struct eigrp
   u_int32_t router_id_static; /* Configured manually. */
 
   struct list *eiflist; /* eigrp interfaces */
+  struct hash *nbrs_hash; /* neighbors keyed by (ifindex, address) */
   u_char passive_interface_default; /* passive-interface default */
 
   unsigned int fd;
@@ -94,26 +134,47 @@ struct eigrp
 
   u_int32_t sequence_number; /*Global EIGRP sequence number*/
 
-  struct stream *ibuf;
+  struct stream *ibuf[EIGRP_READ_BATCH]; /* receive stream pool */
   struct list *oi_write_q;
+  unsigned int mcast_ifindex; /* IP_MULTICAST_IF set on fd, 0 if unknown */
 
   /*Threads*/
   struct thread *t_write;
   struct thread *t_read;
   struct thread *t_distribute; /* timer for distribute list */
+  u_char filter_resync; /* inbound filter changed, full resync needed */
 
   struct route_table *networks; /* EIGRP config networks. */
 
-  struct list *topology_table;
+  struct route_table *topology_table; /* prefix-indexed topology table */
+
+  struct route_table *summaries; /* interface summary addresses */
+
+  struct route_table *externals; /* routes redistributed from zebra */
+  struct list *externals_queue; /* externals waiting for origination */
+  struct thread *t_external; /* originates queued externals */
 
   u_int64_t serno; /* Global serial number counter for topology entry changes*/
   u_int64_t serno_last_update; /* Highest serial number of information send by last update*/
   struct list *topology_changes_internalIPV4;
   struct list *topology_changes_externalIPV4;
+  struct list *topology_changes_rib; /* prefixes waiting for RIB update */
 
   /*Neighbor self*/
   struct eigrp_neighbor *neighbor_self;
 
+  /* neighbors by id, for neighbor sets */
+  vector nbr_index;
+
+  /* active timers of routes waiting for replies */
+  struct eigrp_wheel sia_wheel;
+
+  /* routes waiting for replies, whether timed or not */
+  struct eigrp_prefix_entry *sia_active;
+
+  /* temporaries of received packet, reset after each one is processed */
+  struct mem_arena *pkt_arena;
+
   /*Configured metric for redistributed routes*/
   struct eigrp_metrics dmetric[ZEBRA_ROUTE_MAX + 1];
   int redistribute;           /* Num of redistributed protocols. */
@@ -171,6 +232,18 @@ struct eigrp_interface
 
   int on_write_q;
 
+  /* Scaled delay and bandwidth added to received metrics */
+  u_int32_t metric_delay;
+  u_int32_t metric_bandwidth;
+  u_int64_t metric_wide_delay;
+  u_int64_t metric_wide_bandwidth;
+  u_char metric_valid;
+
+  /* Output pacing, bytes allowed to send right now */
+  int64_t pace_credit;
+  struct timeval pace_last;
+  struct thread *t_pace;
+
   /* Statistics fields. */
   u_int32_t hello_in; /* Hello message input count. */
   u_int32_t update_in; /* Update message input count. */
@@ -195,6 +268,11 @@ struct eigrp_interface
   struct prefix_list *prefix[EIGRP_FILTER_MAX];
   /* Route-map. */
   struct route_map *routemap[EIGRP_FILTER_MAX];
+
+  /* Outbound filter verdicts per prefix, valid for filter_generation */
+  struct route_table *filter_cache;
+  u_int32_t filter_generation;
+  u_char filter_resync; /* inbound filter changed, full resync needed */
 };
 
 struct eigrp_if_params
@@ -207,6 +285,7 @@ struct eigrp_if_params
   DECLARE_IF_PARAM (u_int32_t, delay);
   DECLARE_IF_PARAM (u_char, reliability);
   DECLARE_IF_PARAM (u_char, load);
+  DECLARE_IF_PARAM (u_int32_t, bandwidth_percent); /* share of bandwidth EIGRP may use */
 
   DECLARE_IF_PARAM (char *, auth_keychain );    /* Associated keychain with interface*/
   DECLARE_IF_PARAM (int, auth_type);         /* EIGRP authentication type */
@@ -253,7 +332,15 @@ struct eigrp_neighbor
   /*If packet is unacknowledged, we try to send it again 16 times*/
   u_char retrans_counter;
 
+  /* Conditional receive: accept next CR flagged packet with cr_sequence */
+  u_char cr_mode;
+  u_int32_t cr_sequence;
+
+  /* Stub routing flags from neighbor's Hello, 0 if it is not stub */
+  u_int16_t stub;
+
   struct in_addr src; /* Neighbor Src address. */
+  u_int16_t id;       /* index in process nbr_index */
 
   u_char os_rel_major;		// system version - just for show
   u_char os_rel_minor;		// system version - just for show
@@ -277,12 +364,19 @@ struct eigrp_neighbor
   struct eigrp_fifo *retrans_queue;
   struct eigrp_fifo *multicast_queue;
 
+  /* head of list of topology entries advertised by this neighbor */
+  struct eigrp_neighbor_entry *routes;
+
   u_int32_t crypt_seqnum;           /* Cryptographic Sequence Number. */
 
   /* prefixes not received from neighbor during Graceful restart */
   struct list *nbr_gr_prefixes;
-  /* prefixes not yet send to neighbor during Graceful restart */
-  struct list *nbr_gr_prefixes_send;
+  /* next topology node to send during Graceful restart, locked */
+  struct route_node *nbr_gr_cursor;
+  /* topology serial number when current resync pass started */
+  u_int64_t nbr_gr_serno;
+  /* prefixes changed after this serial number are sent in current pass */
+  u_int64_t nbr_gr_serno_from;
   /* if packet is first or last during Graceful restart */
   enum Packet_part_type nbr_gr_packet_type;
 };
@@ -298,6 +392,12 @@ struct eigrp_packet
   /* Pointer to data stream. */
   struct stream *s;
 
+  /* Packet owning s when stream is shared, NULL if this one owns it */
+  struct eigrp_packet *shared;
+
+  /* References to s held by owner and sharing packets */
+  u_int32_t refcnt;
+
   /* IP destination address. */
   struct in_addr dst;
 
@@ -406,6 +506,13 @@ struct TLV_Next_Multicast_Sequence
   u_int32_t multicast_sequence;
 }__attribute__((packed));
 
+struct TLV_Stub_Type
+{
+  u_int16_t type;
+  u_int16_t length;
+  u_int16_t flags;
+}__attribute__((packed));
+
 struct TLV_Software_Type
 {
   u_int16_t type;
@@ -473,10 +580,20 @@ enum GR_type
 /* EIGRP Topology table node structure */
 struct eigrp_prefix_entry
 {
-  struct list *entries, *rij;
-  u_int32_t fdistance;						// FD
-  u_int32_t rdistance;						// RD
-  u_int32_t distance;						// D
+  struct list *entries;
+  struct eigrp_nbr_set rij;                 // neighbors whose reply we wait for
+  struct eigrp_nbr_set sia_pending;         // SIA-Query sent, no SIA-Reply yet
+  struct eigrp_wheel_timer sia_timer;       // active timer
+  struct eigrp_prefix_entry *sia_next;      // next on process' active list
+  struct eigrp_prefix_entry **sia_pprev;    // link to us, NULL if not on it
+  u_char sia_rounds;                        // SIA-Queries sent while active
+  struct list *successors;                  // successor entries in distance order
+  u_char successors_valid;                  // successors list matches entry flags
+  u_char rib_paths;                         // nexthops currently installed in zebra
+  u_int32_t rib_metric;                     // metric currently installed in zebra
+  u_int64_t fdistance;						// FD
+  u_int64_t rdistance;						// RD
+  u_int64_t distance;						// D
   struct eigrp_metrics reported_metric;		// RD for sending
 
   u_char nt;                                //network type
@@ -493,12 +610,42 @@ struct eigrp_prefix_entry
   u_int64_t serno; /*Serial number for this entry. Increased with each change of entry*/
 };
 
+/* EIGRP interface summary address */
+struct eigrp_summary
+{
+  struct prefix_ipv4 prefix;
+  struct list *ifaces;                      // interfaces the summary is configured on
+  struct eigrp_prefix_entry *pe;            // summary route in topology table, NULL if no component
+  u_char installed;                         // Null0 discard route was sent to zebra
+};
+
+/* Outbound filter verdict of prefix cached on interface */
+struct eigrp_filter_verdict
+{
+  u_int32_t generation;                     // interface filter generation
+  u_char verdict;                           // EIGRP_FILTER_PERMIT or DENY
+};
+
+/* EIGRP route redistributed from zebra */
+struct eigrp_external
+{
+  struct prefix_ipv4 prefix;
+  int type;                                 // zebra route type
+  struct in_addr nexthop;
+  unsigned int ifindex;
+  u_int32_t metric;                         // metric in source protocol
+  u_int32_t tag;                            // administrative tag, set by route-map
+  struct eigrp_prefix_entry *pe;            // originated route in topology table, NULL if none
+  u_char deleted;                           // withdrawn by zebra, freed once processed
+  u_char queued;                            // waiting in externals_queue
+};
+
 /* EIGRP Topology table record structure */
 struct eigrp_neighbor_entry
 {
   struct eigrp_prefix_entry *prefix;
-  u_int32_t reported_distance; 				//distance reported by neighbor
-  u_int32_t distance; 						//sum of reported distance and link cost to advertised neighbor
+  u_int64_t reported_distance; 				//distance reported by neighbor
+  u_int64_t distance; 						//sum of reported distance and link cost to advertised neighbor
 
   struct eigrp_metrics reported_metric;
   struct eigrp_metrics total_metric;
@@ -508,6 +655,11 @@ struct eigrp_neighbor_entry
 
   struct eigrp_interface *ei; 				//pointer for case of connected entry
 
+  struct listnode *pnode;                   //node in prefix->entries, NULL when not there
+
+  /* links in adv_router's list of advertised entries */
+  struct eigrp_neighbor_entry *nbr_next;
+  struct eigrp_neighbor_entry *nbr_prev;
 };
 
 //---------------------------------------------------------------------------------------------------------------------------------------------
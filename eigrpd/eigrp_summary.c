@@ -0,0 +1,404 @@
+/*
+ * EIGRP Interface Summary Address Functions.
+ * Copyright (C) 2013-2016
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *   Frantisek Gazo
+ *   Tomas Hvorkovy
+ *   Martin Kontsek
+ *   Lukas Koribsky
+ *
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "if.h"
+#include "prefix.h"
+#include "table.h"
+#include "linklist.h"
+#include "memory.h"
+#include "log.h"
+#include "vty.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_const.h"
+#include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_network.h"
+#include "eigrpd/eigrp_zebra.h"
+#include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_summary.h"
+
+/*
+ * Summary addresses are kept in process wide table, each remembers
+ * interfaces it was configured on. While at least one component route
+ * (more specific reachable prefix) exists, summary has its own prefix
+ * entry in topology table with metric of the best component and
+ * discard route to Null0 in zebra. Components are not advertised out
+ * of interfaces with covering summary, so neighbors behind them never
+ * learn (and therefore never query for) them.
+ */
+
+static struct eigrp_summary *
+eigrp_summary_new (struct prefix_ipv4 *p)
+{
+  struct eigrp_summary *new;
+
+  new = XCALLOC (MTYPE_EIGRP_SUMMARY, sizeof (struct eigrp_summary));
+  new->prefix = *p;
+  new->ifaces = list_new ();
+
+  return new;
+}
+
+static void
+eigrp_summary_free (struct eigrp_summary *summary)
+{
+  list_delete (summary->ifaces);
+  XFREE (MTYPE_EIGRP_SUMMARY, summary);
+}
+
+/*
+ * Withdraw summary route, it is advertised as unreachable and removed
+ * from topology table by the next RIB flush
+ */
+static void
+eigrp_summary_withdraw (struct eigrp *eigrp, struct eigrp_summary *summary)
+{
+  struct eigrp_prefix_entry *pe = summary->pe;
+  struct eigrp_neighbor_entry *ne;
+
+  if (pe)
+    {
+      pe->distance = pe->fdistance = pe->rdistance = EIGRP_MAX_DISTANCE;
+      pe->reported_metric.delay = EIGRP_MAX_METRIC;
+      if ((ne = listnode_head (pe->entries)) != NULL)
+        ne->distance = EIGRP_MAX_DISTANCE;
+      eigrp_topology_change_add (eigrp, pe,
+                                 EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_RIB);
+      summary->pe = NULL;
+    }
+
+  if (summary->installed)
+    {
+      /* Null0 route goes away like any other EIGRP route */
+      eigrp_zebra_route_delete (&summary->prefix);
+      summary->installed = 0;
+    }
+}
+
+/*
+ * Recompute summary route from its components
+ */
+static void
+eigrp_summary_refresh (struct eigrp *eigrp, struct eigrp_summary *summary)
+{
+  struct route_node *top, *rn;
+  struct eigrp_prefix_entry *pe, *best, *current;
+  struct eigrp_neighbor_entry *ne;
+
+  best = NULL;
+  top = route_node_get (eigrp->topology_table,
+                        (struct prefix *) &summary->prefix);
+  current = top->info;
+
+  /* walk only subtree below summary, route_next_until drops all locks */
+  for (rn = top; rn; rn = route_next_until (rn, top))
+    {
+      if (rn == top || (pe = rn->info) == NULL)
+        continue;
+
+      if (pe->nt == EIGRP_TOPOLOGY_TYPE_SUMMARY
+          || pe->distance == EIGRP_MAX_DISTANCE)
+        continue;
+
+      if (best == NULL || pe->distance < best->distance)
+        best = pe;
+    }
+
+  if (best == NULL)
+    {
+      eigrp_summary_withdraw (eigrp, summary);
+      return;
+    }
+
+  if (summary->pe == NULL)
+    {
+      if (current != NULL && current->nt != EIGRP_TOPOLOGY_TYPE_SUMMARY)
+        {
+          /* same prefix is known on its own, it is advertised instead */
+          return;
+        }
+
+      if (current != NULL)
+        {
+          /* withdrawn summary still waiting for RIB flush, reuse it */
+          summary->pe = current;
+        }
+      else
+        {
+          pe = eigrp_prefix_entry_new ();
+          pe->serno = ++eigrp->serno;
+          pe->destination_ipv4 = prefix_ipv4_new ();
+          *pe->destination_ipv4 = summary->prefix;
+          pe->af = AF_INET;
+          pe->nt = EIGRP_TOPOLOGY_TYPE_SUMMARY;
+          pe->state = EIGRP_FSM_STATE_PASSIVE;
+          eigrp_prefix_entry_add (eigrp->topology_table, pe);
+
+          ne = eigrp_neighbor_entry_new ();
+          ne->adv_router = eigrp->neighbor_self;
+          ne->reported_distance = 0;
+          ne->flags = EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG;
+          ne->prefix = pe;
+          eigrp_neighbor_entry_add (pe, ne);
+
+          summary->pe = pe;
+        }
+    }
+  else if (summary->pe->distance == best->distance
+           && eigrp_metrics_is_same (&summary->pe->reported_metric,
+                                     &best->reported_metric))
+    return;
+
+  pe = summary->pe;
+  pe->distance = pe->fdistance = pe->rdistance = best->distance;
+  pe->reported_metric = best->reported_metric;
+  if ((ne = listnode_head (pe->entries)) != NULL)
+    {
+      ne->distance = best->distance;
+      ne->total_metric = best->reported_metric;
+      ne->reported_metric = best->reported_metric;
+    }
+  eigrp_topology_change_add (eigrp, pe, EIGRP_FSM_NEED_UPDATE);
+
+  if (!summary->installed)
+    {
+      eigrp_zebra_summary_add (&summary->prefix);
+      summary->installed = 1;
+    }
+}
+
+/*
+ * Add summary covering prefix to list of summaries to refresh
+ */
+static void
+eigrp_summary_mark (struct eigrp *eigrp, struct prefix_ipv4 *p,
+                    struct list *dirty)
+{
+  struct route_node *start, *rn;
+  struct eigrp_summary *summary;
+
+  start = route_node_match (eigrp->summaries, (struct prefix *) p);
+  for (rn = start; rn; rn = rn->parent)
+    {
+      if ((summary = rn->info) == NULL
+          || summary->prefix.prefixlen >= p->prefixlen)
+        continue;
+
+      if (!listnode_lookup (dirty, summary))
+        listnode_add (dirty, summary);
+    }
+
+  if (start)
+    route_unlock_node (start);
+}
+
+/*
+ * Refresh summaries covering prefixes changed by DUAL, must be called
+ * before updates of the batch are sent
+ */
+void
+eigrp_summary_flush (struct eigrp *eigrp)
+{
+  struct listnode *node;
+  struct eigrp_prefix_entry *pe;
+  struct eigrp_summary *summary;
+  struct list *dirty;
+
+  if (route_table_count (eigrp->summaries) == 0)
+    return;
+
+  dirty = list_new ();
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->topology_changes_internalIPV4, node, pe))
+    if (pe->nt != EIGRP_TOPOLOGY_TYPE_SUMMARY)
+      eigrp_summary_mark (eigrp, pe->destination_ipv4, dirty);
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->topology_changes_rib, node, pe))
+    if (pe->nt != EIGRP_TOPOLOGY_TYPE_SUMMARY)
+      eigrp_summary_mark (eigrp, pe->destination_ipv4, dirty);
+
+  for (ALL_LIST_ELEMENTS_RO (dirty, node, summary))
+    eigrp_summary_refresh (eigrp, summary);
+
+  list_delete (dirty);
+}
+
+/*
+ * Return 1 if prefix must not be advertised out of interface, because
+ * it is component of summary configured there or it is summary which
+ * is not configured there
+ */
+int
+eigrp_summary_suppressed (struct eigrp_interface *ei,
+                          struct eigrp_prefix_entry *pe)
+{
+  struct eigrp *eigrp = ei->eigrp;
+  struct route_node *start, *rn;
+  struct eigrp_summary *summary;
+  int suppressed;
+
+  if (pe->nt != EIGRP_TOPOLOGY_TYPE_SUMMARY
+      && route_table_count (eigrp->summaries) == 0)
+    return 0;
+
+  suppressed = (pe->nt == EIGRP_TOPOLOGY_TYPE_SUMMARY);
+  start = route_node_match (eigrp->summaries,
+                            (struct prefix *) pe->destination_ipv4);
+  for (rn = start; rn; rn = rn->parent)
+    {
+      if ((summary = rn->info) == NULL
+          || !listnode_lookup (summary->ifaces, ei->ifp))
+        continue;
+
+      if (summary->prefix.prefixlen == pe->destination_ipv4->prefixlen)
+        {
+          if (pe->nt == EIGRP_TOPOLOGY_TYPE_SUMMARY)
+            suppressed = 0;
+        }
+      else
+        {
+          suppressed = 1;
+          break;
+        }
+    }
+
+  if (start)
+    route_unlock_node (start);
+
+  return suppressed;
+}
+
+/*
+ * Configure summary on interface, returns 0 if it already was there
+ */
+int
+eigrp_summary_set (struct eigrp *eigrp, struct interface *ifp,
+                   struct prefix_ipv4 *p)
+{
+  struct route_node *rn;
+  struct eigrp_summary *summary;
+
+  rn = route_node_get (eigrp->summaries, (struct prefix *) p);
+  if (rn->info)
+    {
+      route_unlock_node (rn);
+      summary = rn->info;
+    }
+  else
+    rn->info = summary = eigrp_summary_new (p);
+
+  if (listnode_lookup (summary->ifaces, ifp))
+    return 0;
+
+  listnode_add (summary->ifaces, ifp);
+  eigrp_summary_refresh (eigrp, summary);
+
+  return 1;
+}
+
+/*
+ * Remove summary from interface, returns 0 if it was not configured there
+ */
+int
+eigrp_summary_unset (struct eigrp *eigrp, struct interface *ifp,
+                     struct prefix_ipv4 *p)
+{
+  struct route_node *rn;
+  struct eigrp_summary *summary;
+
+  rn = route_node_lookup (eigrp->summaries, (struct prefix *) p);
+  if (rn == NULL)
+    return 0;
+  route_unlock_node (rn);
+
+  summary = rn->info;
+  if (!listnode_lookup (summary->ifaces, ifp))
+    return 0;
+
+  listnode_delete (summary->ifaces, ifp);
+  if (listcount (summary->ifaces) == 0)
+    {
+      eigrp_summary_withdraw (eigrp, summary);
+      eigrp_summary_free (summary);
+      rn->info = NULL;
+      route_unlock_node (rn);
+    }
+
+  return 1;
+}
+
+void
+eigrp_summary_config_write (struct vty *vty, struct eigrp *eigrp,
+                            struct interface *ifp)
+{
+  struct route_node *rn;
+  struct eigrp_summary *summary;
+
+  for (rn = route_top (eigrp->summaries); rn; rn = route_next (rn))
+    {
+      if ((summary = rn->info) == NULL
+          || !listnode_lookup (summary->ifaces, ifp))
+        continue;
+
+      vty_out (vty, " ip summary-address eigrp %d %s/%d%s", eigrp->AS,
+               inet_ntoa (summary->prefix.prefix), summary->prefix.prefixlen,
+               VTY_NEWLINE);
+    }
+}
+
+/*
+ * Free all summaries, topology table entries are left to topology cleanup
+ * and zebra connection is already closed at this point
+ */
+void
+eigrp_summary_free_all (struct eigrp *eigrp)
+{
+  struct route_node *rn;
+  struct eigrp_summary *summary;
+
+  for (rn = route_top (eigrp->summaries); rn; rn = route_next (rn))
+    {
+      if ((summary = rn->info) == NULL)
+        continue;
+
+      eigrp_summary_free (summary);
+      rn->info = NULL;
+      route_unlock_node (rn);
+    }
+
+  route_table_finish (eigrp->summaries);
+}
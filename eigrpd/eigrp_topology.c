@@ -37,6 +37,10 @@
 #include "memory.h"
 #include "log.h"
 #include "linklist.h"
+#include "vty.h"
+#include "filter.h"
+#include "plist.h"
+#include "distribute.h"
 
 #include "eigrpd/eigrp_structs.h"
 #include "eigrpd/eigrpd.h"
@@ -49,84 +53,23 @@
 #include "eigrpd/eigrp_dump.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_filter.h"
+#include "eigrpd/eigrp_sia.h"
 
-static int
-eigrp_prefix_entry_cmp(struct eigrp_prefix_entry *, struct eigrp_prefix_entry *);
-static void
-eigrp_prefix_entry_del(struct eigrp_prefix_entry *);
 static int
 eigrp_neighbor_entry_cmp(struct eigrp_neighbor_entry *,
     struct eigrp_neighbor_entry *);
 
 /*
- * asdf;laksdjf;lajsdf;kasdjf;asdjf;
- * asdfaskdjfa;sdkjf;adlskj
- * Returns linkedlist used as topology table
- * cmp - assigned function for comparing topology nodes
- * del - assigned function executed before deleting topology node by list function
+ * Returns route table used as topology table. Prefix entries are
+ * stored in route_node->info, keyed by destination prefix, so lookups,
+ * inserts and deletes are O(prefix length) and walks come out in
+ * prefix order.
  */
-struct list *
+struct route_table *
 eigrp_topology_new()
 {
-  struct list* new = list_new();
-  new->cmp = (int
-  (*)(void *, void *)) eigrp_prefix_entry_cmp;
-  new->del = (void
-  (*)(void *)) eigrp_prefix_entry_del;
-
-  return new;
-}
-
-/*
- * Topology node comparison
- */
-
-static int
-eigrp_prefix_entry_cmp(struct eigrp_prefix_entry *node1,
-    struct eigrp_prefix_entry *node2)
-{
-  if (node1->af == AF_INET)
-    {
-      if (node2->af == AF_INET)
-        {
-          if (node1->destination_ipv4->prefix.s_addr
-              < node2->destination_ipv4->prefix.s_addr)
-            {
-              return -1; // if it belong above node2
-            }
-          else
-            {
-              if (node1->destination_ipv4->prefix.s_addr
-                  > node2->destination_ipv4->prefix.s_addr)
-                {
-                  return 1; //if it belongs under node2
-                }
-              else
-                {
-                  return 0; // same value... ERROR...in case of adding same prefix again
-                }
-            }
-        }
-      else
-        {
-          return 1;
-        }
-    }
-  else
-    { // TODO check if the prefix dont exists
-      return 1; // add to end
-    }
-}
-
-/*
- * Topology node delete
- */
-
-static void
-eigrp_prefix_entry_del(struct eigrp_prefix_entry *node)
-{
-  list_delete_all_node(node->entries);
-  list_free(node->entries);
+  return route_table_init();
 }
 
 /*
@@ -138,12 +81,12 @@ struct eigrp_prefix_entry *
 eigrp_prefix_entry_new()
 {
   struct eigrp_prefix_entry *new;
-  new = XCALLOC(MTYPE_EIGRP_PREFIX_ENTRY, sizeof(struct eigrp_prefix_entry));
+  new = mem_pool_alloc(eigrp_om->prefix_pool);
   new->entries = list_new();
-  new->rij = list_new();
+  new->successors = list_new();
   new->entries->cmp = (int
   (*)(void *, void *)) eigrp_neighbor_entry_cmp;
-  new->distance = new->fdistance = new->rdistance = EIGRP_MAX_METRIC;
+  new->distance = new->fdistance = new->rdistance = EIGRP_MAX_DISTANCE;
   new->destination_ipv4 = NULL;
   new->destination_ipv6 = NULL;
 
@@ -175,22 +118,63 @@ eigrp_neighbor_entry_new()
 {
   struct eigrp_neighbor_entry *new;
 
-  new = XCALLOC(MTYPE_EIGRP_NEIGHBOR_ENTRY,
-      sizeof(struct eigrp_neighbor_entry));
-  new->reported_distance = EIGRP_MAX_METRIC;
-  new->distance = EIGRP_MAX_METRIC;
+  new = mem_pool_alloc(eigrp_om->entry_pool);
+  new->reported_distance = EIGRP_MAX_DISTANCE;
+  new->distance = EIGRP_MAX_DISTANCE;
 
   return new;
 }
 
 /*
- * Freeing topology table list
+ * Link entry into its advertising neighbor's list of entries,
+ * nothing is done if entry is already linked
+ */
+
+static void
+eigrp_neighbor_entry_link(struct eigrp_neighbor_entry *entry)
+{
+  struct eigrp_neighbor *nbr = entry->adv_router;
+
+  if (nbr == NULL || entry->nbr_prev != NULL || nbr->routes == entry)
+    return;
+
+  entry->nbr_prev = NULL;
+  entry->nbr_next = nbr->routes;
+  if (nbr->routes)
+    nbr->routes->nbr_prev = entry;
+  nbr->routes = entry;
+}
+
+/*
+ * Unlink entry from its advertising neighbor's list of entries
+ */
+
+static void
+eigrp_neighbor_entry_unlink(struct eigrp_neighbor_entry *entry)
+{
+  struct eigrp_neighbor *nbr = entry->adv_router;
+
+  if (nbr == NULL || (entry->nbr_prev == NULL && nbr->routes != entry))
+    return;
+
+  if (entry->nbr_prev)
+    entry->nbr_prev->nbr_next = entry->nbr_next;
+  else
+    nbr->routes = entry->nbr_next;
+  if (entry->nbr_next)
+    entry->nbr_next->nbr_prev = entry->nbr_prev;
+
+  entry->nbr_next = entry->nbr_prev = NULL;
+}
+
+/*
+ * Freeing topology table
  */
 
 void
-eigrp_topology_free(struct list *list)
+eigrp_topology_free(struct route_table *table)
 {
-  list_free(list);
+  route_table_finish(table);
 }
 
 /*
@@ -198,11 +182,11 @@ eigrp_topology_free(struct list *list)
  */
 
 void
-eigrp_topology_cleanup(struct list *topology)
+eigrp_topology_cleanup(struct route_table *table)
 {
-  assert(topology);
+  assert(table);
 
-  eigrp_topology_delete_all(topology);
+  eigrp_topology_delete_all(table);
 }
 
 /*
@@ -210,12 +194,94 @@ eigrp_topology_cleanup(struct list *topology)
  */
 
 void
-eigrp_prefix_entry_add(struct list *topology, struct eigrp_prefix_entry *node)
+eigrp_prefix_entry_add(struct route_table *topology,
+    struct eigrp_prefix_entry *node)
 {
-  if (listnode_lookup(topology, node) == NULL)
+  struct route_node *rn;
+
+  rn = route_node_get(topology, (struct prefix *) node->destination_ipv4);
+  if (rn->info)
     {
-      listnode_add_sort(topology, node);
+      /* prefix already present, drop the lock taken by route_node_get */
+      route_unlock_node(rn);
+      return;
     }
+
+  rn->info = node;
+}
+
+/*
+ * Move list node right behind after (to the head if after is NULL)
+ */
+
+static void
+eigrp_neighbor_entry_move(struct list *list, struct listnode *node,
+    struct listnode *after)
+{
+  /* unlink */
+  if (node->prev)
+    node->prev->next = node->next;
+  else
+    list->head = node->next;
+  if (node->next)
+    node->next->prev = node->prev;
+  else
+    list->tail = node->prev;
+
+  /* and link at new position */
+  node->prev = after;
+  node->next = after ? after->next : list->head;
+  if (node->next)
+    node->next->prev = node;
+  else
+    list->tail = node;
+  if (after)
+    after->next = node;
+  else
+    list->head = node;
+}
+
+/*
+ * Put entry to its position in prefix->entries sorted by distance.
+ * Entry is placed behind entries with equal distance, same as
+ * listnode_add_sort() does, but only nodes between old and new
+ * position are visited.
+ */
+
+static void
+eigrp_neighbor_entry_place(struct eigrp_prefix_entry *prefix,
+    struct eigrp_neighbor_entry *entry)
+{
+  struct listnode *node, *pos;
+
+  if (entry->pnode == NULL)
+    {
+      listnode_add(prefix->entries, entry);
+      entry->pnode = listtail(prefix->entries);
+    }
+  node = entry->pnode;
+
+  /* distance increased, walk towards tail */
+  for (pos = node; pos->next; pos = pos->next)
+    if (((struct eigrp_neighbor_entry *) pos->next->data)->distance
+        > entry->distance)
+      break;
+
+  if (pos == node)
+    {
+      /* distance decreased, walk towards head */
+      for (pos = node->prev; pos; pos = pos->prev)
+        if (((struct eigrp_neighbor_entry *) pos->data)->distance
+            <= entry->distance)
+          break;
+      if (pos == node->prev)
+        return;
+    }
+
+  eigrp_neighbor_entry_move(prefix->entries, node, pos);
+
+  if (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
+    prefix->successors_valid = 0;
 }
 
 /*
@@ -226,10 +292,11 @@ void
 eigrp_neighbor_entry_add(struct eigrp_prefix_entry *node,
     struct eigrp_neighbor_entry *entry)
 {
-  if (listnode_lookup(node->entries, entry) == NULL)
+  if (entry->pnode == NULL)
     {
-      listnode_add_sort(node->entries, entry);
       entry->prefix = node;
+      eigrp_neighbor_entry_place(node, entry);
+      eigrp_neighbor_entry_link(entry);
     }
 }
 
@@ -238,17 +305,47 @@ eigrp_neighbor_entry_add(struct eigrp_prefix_entry *node,
  */
 
 void
-eigrp_prefix_entry_delete(struct list *topology,
+eigrp_prefix_entry_delete(struct route_table *topology,
     struct eigrp_prefix_entry *node)
 {
-  if (listnode_lookup(topology, node) != NULL)
+  struct route_node *rn;
+
+  rn = route_node_lookup(topology, (struct prefix *) node->destination_ipv4);
+  if (rn == NULL)
+    return;
+
+  if (rn->info == node)
     {
+      struct listnode *lnode, *lnnode;
+      struct eigrp_neighbor_entry *entry;
+      struct eigrp *eigrp = eigrp_lookup();
+
+      if (eigrp)
+        {
+          eigrp_filter_forget(eigrp, node->destination_ipv4);
+          eigrp_sia_stop(eigrp, node);
+        }
+
+      /* entries die with the prefix, drop them from their neighbors' lists */
+      for (ALL_LIST_ELEMENTS(node->entries, lnode, lnnode, entry))
+        {
+          eigrp_neighbor_entry_unlink(entry);
+          mem_pool_free(eigrp_om->entry_pool, entry);
+        }
       list_delete_all_node(node->entries);
       list_free(node->entries);
-      list_free(node->rij);
-      listnode_delete(topology, node);
-      XFREE(MTYPE_EIGRP_PREFIX_ENTRY,node);
+      eigrp_nbr_set_clear(&node->rij);
+      eigrp_nbr_set_clear(&node->sia_pending);
+      list_delete(node->successors);
+      if (node->extTLV)
+        eigrp_IPv4_ExternalTLV_free(node->extTLV);
+      mem_pool_free(eigrp_om->prefix_pool, node);
+
+      rn->info = NULL;
+      route_unlock_node(rn); /* initial reference */
     }
+
+  route_unlock_node(rn); /* route_node_lookup reference */
 }
 
 /*
@@ -259,10 +356,14 @@ void
 eigrp_neighbor_entry_delete(struct eigrp_prefix_entry *node,
     struct eigrp_neighbor_entry *entry)
 {
-  if (listnode_lookup(node->entries, entry) != NULL)
+  if (entry->pnode != NULL)
     {
-      listnode_delete(node->entries, entry);
-      XFREE(MTYPE_EIGRP_NEIGHBOR_ENTRY,entry);
+      list_delete_node(node->entries, entry->pnode);
+      entry->pnode = NULL;
+      if (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
+        node->successors_valid = 0;
+      eigrp_neighbor_entry_unlink(entry);
+      mem_pool_free(eigrp_om->entry_pool, entry);
     }
 }
 
@@ -271,9 +372,19 @@ eigrp_neighbor_entry_delete(struct eigrp_prefix_entry *node,
  */
 
 void
-eigrp_topology_delete_all(struct list *topology)
+eigrp_topology_delete_all(struct route_table *topology)
 {
-  list_delete_all_node(topology);
+  struct route_node *rn;
+  struct eigrp_prefix_entry *pe;
+
+  for (rn = route_top(topology); rn; rn = route_next(rn))
+    {
+      pe = rn->info;
+      if (!pe)
+        continue;
+
+      eigrp_prefix_entry_delete(topology, pe);
+    }
 }
 
 /*
@@ -282,30 +393,35 @@ eigrp_topology_delete_all(struct list *topology)
  */
 
 unsigned int
-eigrp_topology_table_isempty(struct list *topology)
+eigrp_topology_table_isempty(struct route_table *topology)
 {
-  if (topology->count)
-    return 1;
-  else
-    return 0;
+  struct route_node *rn;
+
+  for (rn = route_top(topology); rn; rn = route_next(rn))
+    if (rn->info)
+      {
+        route_unlock_node(rn);
+        return 0;
+      }
+
+  return 1;
 }
 
 struct eigrp_prefix_entry *
-eigrp_topology_table_lookup_ipv4(struct list *topology_table,
+eigrp_topology_table_lookup_ipv4(struct route_table *topology_table,
     struct prefix_ipv4 * address)
 {
-  struct eigrp_prefix_entry *data;
-  struct listnode *node;
-  for (ALL_LIST_ELEMENTS_RO(topology_table, node, data))
-    {
+  struct eigrp_prefix_entry *data = NULL;
+  struct route_node *rn;
 
-      if ((data->af == AF_INET)
-          && (data->destination_ipv4->prefix.s_addr == address->prefix.s_addr)
-          && (data->destination_ipv4->prefixlen == address->prefixlen))
-        return data;
+  rn = route_node_lookup(topology_table, (struct prefix *) address);
+  if (rn)
+    {
+      data = rn->info;
+      route_unlock_node(rn);
     }
 
-  return NULL;
+  return data;
 }
 /* TODO
  struct eigrp_prefix_entry *
@@ -324,20 +440,30 @@ eigrp_topology_table_lookup_ipv4(struct list *topology_table,
  return NULL;
  }
  */
+/*
+ * Returns list of successors in distance order. List belongs to the
+ * prefix and is rebuilt only after successor set or its order changed,
+ * caller must not free it.
+ */
 struct list *
 eigrp_topology_get_successor(struct eigrp_prefix_entry *table_node)
 {
-  struct list *successors = list_new();
-  ;
+  struct list *successors = table_node->successors;
   struct eigrp_neighbor_entry *data;
-  struct listnode *node1, *node2;
-  for (ALL_LIST_ELEMENTS(table_node->entries, node1, node2, data))
+  struct listnode *node;
+
+  if (table_node->successors_valid)
+    return successors;
+
+  list_delete_all_node(successors);
+  for (ALL_LIST_ELEMENTS_RO(table_node->entries, node, data))
     {
       if (data->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
         {
           listnode_add(successors, data);
         }
     }
+  table_node->successors_valid = 1;
 
   return successors;
 }
@@ -378,26 +504,14 @@ eigrp_prefix_entry_lookup(struct list *entries, struct eigrp_neighbor *nbr)
 struct list *
 eigrp_neighbor_prefixes_lookup(struct eigrp *eigrp, struct eigrp_neighbor *nbr)
 {
-  struct listnode *node1, *node11, *node2, *node22;
-  struct eigrp_prefix_entry *prefix;
   struct eigrp_neighbor_entry *entry;
 
   /* create new empty list for prefixes storage */
   struct list *prefixes = list_new();
 
-  /* iterate over all prefixes in topology table */
-  for (ALL_LIST_ELEMENTS(eigrp->topology_table, node1, node11, prefix))
-    {
-	  /* iterate over all neighbor entry in prefix */
-      for (ALL_LIST_ELEMENTS(prefix->entries, node2, node22, entry))
-        {
-    	  /* if entry is from specified neighbor, add to list */
-          if (entry->adv_router == nbr)
-            {
-        	  listnode_add(prefixes, prefix);
-            }
-        }
-    }
+  /* walk only entries advertised by specified neighbor */
+  for (entry = nbr->routes; entry; entry = entry->nbr_next)
+    listnode_add(prefixes, entry->prefix);
 
   /* return list of prefixes from specified neighbor */
   return prefixes;
@@ -438,8 +552,8 @@ eigrp_topology_update_distance(struct eigrp_fsm_action_message *msg)
   /*
    * Move to correct position in list according to new distance
    */
-  listnode_delete(prefix->entries, entry);
-  listnode_add_sort(prefix->entries, entry);
+  eigrp_neighbor_entry_place(prefix, entry);
+  eigrp_neighbor_entry_link(entry);
 
   return change;
 }
@@ -447,25 +561,44 @@ eigrp_topology_update_distance(struct eigrp_fsm_action_message *msg)
 void
 eigrp_topology_update_all_node_flags(struct eigrp *eigrp)
 {
-  struct list *table = eigrp->topology_table;
+  struct route_node *rn;
   struct eigrp_prefix_entry *data;
-  struct listnode *node, *nnode;
-  for (ALL_LIST_ELEMENTS(table, node, nnode, data))
+
+  for (rn = route_top(eigrp->topology_table); rn; rn = route_next(rn))
     {
+      if ((data = rn->info) == NULL)
+        continue;
+
       eigrp_topology_update_node_flags(data);
     }
 }
 
-void
+/*
+ * Recompute successor and feasible successor flags of prefix entries.
+ * Entries are sorted by distance, so once one of them is out of
+ * variance all following are too. Returns 1 if successor set changed.
+ */
+int
 eigrp_topology_update_node_flags(struct eigrp_prefix_entry *dest)
 {
   struct listnode *node;
   struct eigrp_neighbor_entry *entry;
   struct eigrp *eigrp = eigrp_lookup();
+  u_int64_t limit = dest->distance > EIGRP_MAX_DISTANCE / eigrp->variance ?
+      EIGRP_MAX_DISTANCE : dest->distance * eigrp->variance;
+  int in_variance = 1;
+  u_char old_flags;
+  int changed = 0;
 
   for (ALL_LIST_ELEMENTS_RO(dest->entries, node, entry))
     {
-      if ((entry->distance <= (u_int64_t)(dest->distance*eigrp->variance)) && entry->distance != EIGRP_MAX_METRIC) // is successor
+      old_flags = entry->flags;
+
+      if (in_variance
+          && (entry->distance > limit || entry->distance == EIGRP_MAX_DISTANCE))
+        in_variance = 0;
+
+      if (in_variance) // is successor
         {
           entry->flags |= EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG;
           entry->flags &= 0xfd; // 1111 1101 set fs flag to zero
@@ -479,83 +612,267 @@ eigrp_topology_update_node_flags(struct eigrp_prefix_entry *dest)
         {
           entry->flags &= 0xfc; // 1111 1100 set successor and fs flag to zero
         }
+
+      if ((old_flags ^ entry->flags) & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
+        changed = 1;
     }
+
+  if (changed)
+    dest->successors_valid = 0;
+
+  return changed;
 }
 
+/*
+ * Recompute distances of all passive routes after metric formula changed,
+ * i.e. K-values changed or classic and wide metrics switched.  Entries are
+ * sorted again, successors reselected and the RIB refreshed on next flush.
+ * Active routes are left alone, replies to their queries recompute them.
+ */
 void
-eigrp_update_routing_table(struct eigrp_prefix_entry * prefix)
+eigrp_topology_recalculate(struct eigrp *eigrp)
 {
-  struct listnode *node;
-  struct eigrp_neighbor_entry *entry;
+  struct route_node *rn;
+  struct eigrp_prefix_entry *pe;
+  struct eigrp_neighbor_entry *entry, *head;
+  struct listnode *node, *nnode;
+  struct list *sorted = list_new();
 
-  for (ALL_LIST_ELEMENTS_RO(prefix->entries, node, entry))
+  for (rn = route_top(eigrp->topology_table); rn; rn = route_next(rn))
     {
-      if (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
+      if ((pe = rn->info) == NULL || pe->state != EIGRP_FSM_STATE_PASSIVE)
+        continue;
+
+      for (ALL_LIST_ELEMENTS(pe->entries, node, nnode, entry))
         {
-          if (!(entry->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG))
+          if (entry->adv_router == eigrp->neighbor_self || !entry->ei)
+            entry->distance = eigrp_calculate_metrics(eigrp,
+                                                      &entry->total_metric);
+          else
             {
-              eigrp_zebra_route_add(prefix->destination_ipv4, entry);
-              entry->flags += EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+              entry->reported_distance =
+                  eigrp_calculate_metrics(eigrp, &entry->reported_metric);
+              entry->distance = eigrp_calculate_total_metrics(eigrp, entry);
             }
+
+          list_delete_node(pe->entries, entry->pnode);
+          entry->pnode = NULL;
+          listnode_add(sorted, entry);
+        }
+
+      /* insert one by one, list stays sorted */
+      for (ALL_LIST_ELEMENTS_RO(sorted, node, entry))
+        eigrp_neighbor_entry_place(pe, entry);
+      list_delete_all_node(sorted);
+
+      if ((head = listnode_head(pe->entries)) == NULL)
+        continue;
+
+      if (head->adv_router != eigrp->neighbor_self)
+        pe->reported_metric = head->total_metric;
+      pe->distance = pe->fdistance = pe->rdistance = head->distance;
+      pe->successors_valid = 0;
+      eigrp_topology_update_node_flags(pe);
+      eigrp_topology_change_add(eigrp, pe, EIGRP_FSM_NEED_RIB);
+    }
+
+  list_delete(sorted);
+}
+
+/*
+ * Installs successors and feasible successors within variance as a single
+ * multipath route. Nothing is sent to zebra if the path set and metric did
+ * not change, otherwise the whole set is replaced by one message.
+ */
+void
+eigrp_update_routing_table(struct eigrp_prefix_entry * prefix)
+{
+  struct listnode *node;
+  struct eigrp_neighbor_entry *entry, *best;
+  struct eigrp *eigrp = eigrp_lookup();
+  struct list *successors;
+  struct list *paths;
+  int changed;
+
+  /* summary has discard route installed by its own */
+  if (prefix->nt == EIGRP_TOPOLOGY_TYPE_SUMMARY)
+    return;
+
+  successors = eigrp_topology_get_successor(prefix);
+  paths = list_new();
+
+  /* connected and redistributed routes are in zebra already */
+  best = listhead(successors) ? listgetdata(listhead(successors)) : NULL;
+  if (best && best->adv_router && best->adv_router != eigrp->neighbor_self)
+    {
+      for (ALL_LIST_ELEMENTS_RO(successors, node, entry))
+        {
+          if (listcount(paths) >= eigrp->max_paths)
+            break;
+          /* entry of neighbor already gone has no nexthop */
+          if (entry->adv_router == eigrp->neighbor_self || !entry->ei
+              || !entry->adv_router)
+            continue;
+          /* unequal cost paths must be loop free */
+          if (entry->distance != best->distance
+              && entry->reported_distance >= prefix->fdistance)
+            continue;
+          listnode_add(paths, entry);
         }
-      else if (entry->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG)
+    }
+
+  changed = (listcount(paths) != prefix->rib_paths);
+  if (listcount(paths)
+      && eigrp_rib_metric(eigrp, best->distance) != prefix->rib_metric)
+    changed = 1;
+  for (ALL_LIST_ELEMENTS_RO(paths, node, entry))
+    if (!(entry->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG))
+      changed = 1;
+
+  if (changed)
+    {
+      if (listcount(paths))
         {
-          eigrp_zebra_route_delete(prefix->destination_ipv4, entry);
-          entry->flags -= EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+          eigrp_zebra_route_add(prefix->destination_ipv4, paths);
+          prefix->rib_metric = eigrp_rib_metric(eigrp, best->distance);
         }
+      else
+        eigrp_zebra_route_delete(prefix->destination_ipv4);
+      prefix->rib_paths = listcount(paths);
+
+      for (ALL_LIST_ELEMENTS_RO(prefix->entries, node, entry))
+        entry->flags &= ~EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+      for (ALL_LIST_ELEMENTS_RO(paths, node, entry))
+        entry->flags |= EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
     }
+
+  list_delete(paths);
 }
 
 void
 eigrp_topology_neighbor_down(struct eigrp *eigrp, struct eigrp_neighbor * nbr)
 {
-  struct listnode *node1, *node11, *node2, *node22;
-  struct eigrp_prefix_entry *prefix;
+  struct eigrp_neighbor_entry *entry, *next;
+
+  struct eigrp_fsm_action_message msg;
+  struct TLV_IPv4_Internal_type * tlv = eigrp_IPv4_InternalTLV_new();
+
+  tlv->metric.delay = EIGRP_MAX_METRIC;
+
+  /* FSM may free entry, so remember its successor beforehand */
+  for (entry = nbr->routes; entry; entry = next)
+    {
+      next = entry->nbr_next;
+      memset(&msg, 0, sizeof(msg));
+      /* route of neighbor we wait for is its reply, RFC 7868 3.4 */
+      msg.packet_type = eigrp_nbr_set_test(&entry->prefix->rij, nbr) ?
+          EIGRP_OPC_REPLY : EIGRP_OPC_UPDATE;
+      msg.eigrp = eigrp;
+      msg.data_type = EIGRP_TLV_IPv4_INT;
+      msg.adv_router = nbr;
+      msg.data.ipv4_int_type = tlv;
+      msg.entry = entry;
+      msg.prefix = entry->prefix;
+      int event = eigrp_get_fsm_event(&msg);
+      eigrp_fsm_event(&msg, event);
+    }
+  eigrp_IPv4_InternalTLV_free(tlv);
+
+  eigrp_sia_neighbor_down(eigrp, nbr);
+
+  eigrp_fsm_batch_flush(eigrp, nbr->ei);
+}
+
+/*
+ * Neighbor is being freed.  Entries of its prefixes still active after
+ * eigrp_topology_neighbor_down() stay in topology until the diffusing
+ * computation ends, they are unlinked from it and lose their advertising
+ * router, so nothing reaches freed neighbor through them.
+ */
+void
+eigrp_topology_neighbor_detach(struct eigrp_neighbor *nbr)
+{
   struct eigrp_neighbor_entry *entry;
 
-  for (ALL_LIST_ELEMENTS(eigrp->topology_table, node1, node11, prefix))
+  while ((entry = nbr->routes) != NULL)
     {
-      for (ALL_LIST_ELEMENTS(prefix->entries, node2, node22, entry))
-        {
-          if (entry->adv_router == nbr)
-            {
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
-              struct TLV_IPv4_Internal_type * tlv = eigrp_IPv4_InternalTLV_new();
-              tlv->metric.delay = EIGRP_MAX_METRIC;
-              msg->packet_type = EIGRP_OPC_UPDATE;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = prefix;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
-            }
-        }
+      eigrp_neighbor_entry_unlink(entry);
+      entry->adv_router = NULL;
     }
+}
+
+/*
+ * Queue prefix for pending actions (EIGRP_FSM_NEED_*), prefix is
+ * put on each change list only once no matter how many DUAL events
+ * asked for the same action
+ */
+void
+eigrp_topology_change_add(struct eigrp *eigrp,
+    struct eigrp_prefix_entry *prefix, u_char action)
+{
+  u_char pending = EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_QUERY;
+
+  if ((action & pending) && !(prefix->req_action & pending))
+    listnode_add(eigrp->topology_changes_internalIPV4, prefix);
+
+  /* lets Graceful restart resync catch prefixes changed behind its cursor */
+  if (action & EIGRP_FSM_NEED_UPDATE)
+    prefix->serno = ++eigrp->serno;
+
+  if ((action & EIGRP_FSM_NEED_RIB)
+      && !(prefix->req_action & EIGRP_FSM_NEED_RIB))
+    listnode_add(eigrp->topology_changes_rib, prefix);
+
+  prefix->req_action |= action;
+}
+
+/*
+ * Push routing table changes collected during DUAL processing to zebra,
+ * once per prefix, and drop unreachable entries of passive prefixes
+ */
+void
+eigrp_topology_rib_flush(struct eigrp *eigrp)
+{
+  struct listnode *node, *nnode;
+  struct eigrp_prefix_entry *prefix;
 
-  eigrp_query_send_all(eigrp);
-  eigrp_update_send_all(eigrp,nbr->ei);
+  for (ALL_LIST_ELEMENTS(eigrp->topology_changes_rib, node, nnode, prefix))
+    {
+      prefix->req_action &= ~EIGRP_FSM_NEED_RIB;
+      listnode_delete(eigrp->topology_changes_rib, prefix);
 
+      eigrp_update_routing_table(prefix);
+
+      if (prefix->state != EIGRP_FSM_STATE_PASSIVE)
+        continue;
+
+      /* prefix may be freed below, do not leave it on pending list */
+      if (prefix->distance == EIGRP_MAX_DISTANCE
+          && prefix->nt != EIGRP_TOPOLOGY_TYPE_CONNECTED
+          && (prefix->req_action & (EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_QUERY)))
+        {
+          prefix->req_action &= ~(EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_QUERY);
+          listnode_delete(eigrp->topology_changes_internalIPV4, prefix);
+        }
+
+      eigrp_update_topology_table_prefix(eigrp->topology_table, prefix);
+    }
 }
 
 void
-eigrp_update_topology_table_prefix(struct list * table, struct eigrp_prefix_entry * prefix)
+eigrp_update_topology_table_prefix(struct route_table * table, struct eigrp_prefix_entry * prefix)
 {
 	struct listnode *node1, *node2;
 
 	  struct eigrp_neighbor_entry *entry;
 	      for (ALL_LIST_ELEMENTS(prefix->entries, node1, node2, entry))
 	        {
-	    	  if(entry->distance == EIGRP_MAX_METRIC)
+	    	  if(entry->distance == EIGRP_MAX_DISTANCE)
 	    	  {
 	    		  eigrp_neighbor_entry_delete(prefix,entry);
 	    	  }
 	        }
-	      if(prefix->distance == EIGRP_MAX_METRIC && prefix->nt != EIGRP_TOPOLOGY_TYPE_CONNECTED)
+	      if(prefix->distance == EIGRP_MAX_DISTANCE && prefix->nt != EIGRP_TOPOLOGY_TYPE_CONNECTED)
 	      {
 	    	  eigrp_prefix_entry_delete(table,prefix);
 	      }
@@ -35,29 +35,32 @@
 
 
 /* EIGRP Topology table related functions. */
-extern struct list *eigrp_topology_new (void);
-extern void eigrp_topology_init (struct list*);
+extern struct route_table *eigrp_topology_new (void);
 extern struct eigrp_prefix_entry *eigrp_prefix_entry_new (void);
 extern struct eigrp_neighbor_entry *eigrp_neighbor_entry_new (void);
-extern void eigrp_topology_free (struct list *);
-extern void eigrp_topology_cleanup (struct list *);
-extern void eigrp_prefix_entry_add (struct list *, struct eigrp_prefix_entry *);
+extern void eigrp_topology_free (struct route_table *);
+extern void eigrp_topology_cleanup (struct route_table *);
+extern void eigrp_prefix_entry_add (struct route_table *, struct eigrp_prefix_entry *);
 extern void eigrp_neighbor_entry_add (struct eigrp_prefix_entry *, struct eigrp_neighbor_entry *);
-extern void eigrp_prefix_entry_delete (struct list *, struct eigrp_prefix_entry *);
+extern void eigrp_prefix_entry_delete (struct route_table *, struct eigrp_prefix_entry *);
 extern void eigrp_neighbor_entry_delete (struct eigrp_prefix_entry *, struct eigrp_neighbor_entry *);
-extern void eigrp_topology_delete_all (struct list *);
-extern unsigned int eigrp_topology_table_isempty (struct list *);
-extern struct eigrp_prefix_entry *eigrp_topology_table_lookup_ipv4 (struct list *, struct prefix_ipv4 *);
+extern void eigrp_topology_delete_all (struct route_table *);
+extern unsigned int eigrp_topology_table_isempty (struct route_table *);
+extern struct eigrp_prefix_entry *eigrp_topology_table_lookup_ipv4 (struct route_table *, struct prefix_ipv4 *);
 extern struct list *eigrp_topology_get_successor (struct eigrp_prefix_entry *);
 //extern struct eigrp_neighbor_entry *eigrp_topology_get_fsuccessor (struct eigrp_prefix_entry *);
 extern struct eigrp_neighbor_entry *eigrp_prefix_entry_lookup (struct list *, struct eigrp_neighbor *);
 extern struct list *eigrp_neighbor_prefixes_lookup(struct eigrp *, struct eigrp_neighbor *);
 extern void eigrp_topology_update_all_node_flags (struct eigrp *);
-extern void eigrp_topology_update_node_flags (struct eigrp_prefix_entry *);
+extern int eigrp_topology_update_node_flags (struct eigrp_prefix_entry *);
 extern int eigrp_topology_update_distance ( struct eigrp_fsm_action_message *);
 extern void eigrp_update_routing_table(struct eigrp_prefix_entry *);
 extern void eigrp_topology_neighbor_down(struct eigrp *, struct eigrp_neighbor *);
-extern void eigrp_update_topology_table_prefix(struct list *, struct eigrp_prefix_entry * );
+extern void eigrp_topology_neighbor_detach(struct eigrp_neighbor *);
+extern void eigrp_topology_change_add(struct eigrp *, struct eigrp_prefix_entry *, u_char);
+extern void eigrp_topology_rib_flush(struct eigrp *);
+extern void eigrp_topology_recalculate(struct eigrp *);
+extern void eigrp_update_topology_table_prefix(struct route_table *, struct eigrp_prefix_entry * );
 //extern int eigrp_topology_get_successor_count (struct eigrp_prefix_entry *);
 /* Set all stats to -1 (LSA_SPF_NOT_EXPLORED). */
 /*extern void eigrp_lsdb_clean_stat (struct eigrp_lsdb *lsdb);
@@ -45,6 +45,8 @@
 #include "checksum.h"
 #include "md5.h"
 #include "plist.h"
+#include "filter.h"
+#include "distribute.h"
 #include "routemap.h"
 #include "vty.h"
 
@@ -59,6 +61,9 @@
 #include "eigrpd/eigrp_macros.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_filter.h"
+#include "eigrpd/eigrp_network.h"
 
 /**
  * @fn remove_received_prefix_gr
@@ -89,6 +94,83 @@ remove_received_prefix_gr (struct list *nbr_prefixes, struct eigrp_prefix_entry
 	}
 }
 
+/**
+ * @fn eigrp_update_stub_suppressed
+ *
+ * @param[in]		eigrp		EIGRP process
+ * @param[in]		pe	 		Prefix which is going to be advertised
+ *
+ * @return int		1 if prefix must not be advertised
+ *
+ * @par
+ * Stub router advertises only route types it was configured for
+ * and never routes learned from its neighbors.
+ */
+static int
+eigrp_update_stub_suppressed (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+	if (eigrp->stub == 0)
+		return 0;
+
+	if (eigrp->stub & EIGRP_STUB_RECEIVE_ONLY)
+		return 1;
+
+	switch (pe->nt)
+	{
+	case EIGRP_TOPOLOGY_TYPE_CONNECTED:
+		return !(eigrp->stub & EIGRP_STUB_CONNECTED);
+	case EIGRP_TOPOLOGY_TYPE_SUMMARY:
+		return !(eigrp->stub & EIGRP_STUB_SUMMARY);
+	case EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL:
+		if (pe->extTLV->originating_router.s_addr != eigrp->router_id)
+			return 1;
+		switch (pe->extTLV->external_protocol)
+		{
+		case CONN_PROTID:
+			return !(eigrp->stub & EIGRP_STUB_CONNECTED);
+		case STATIC_PROTID:
+			return !(eigrp->stub & EIGRP_STUB_STATIC);
+		default:
+			return !(eigrp->stub & EIGRP_STUB_REDISTRIBUTED);
+		}
+	default:
+		return 1;
+	}
+}
+
+/**
+ * @fn eigrp_update_external_set
+ *
+ * @param[in]		eigrp		EIGRP process
+ * @param[in]		pe	 		Prefix external TLV was received for
+ * @param[in]		ext			External data of received TLV
+ *
+ * @return void
+ *
+ * @par
+ * Learned prefix takes over external data of the last advertisement
+ * received for it, so it is passed on unchanged. Connected, summary
+ * and our own redistributed prefixes keep what they have.
+ */
+static void
+eigrp_update_external_set (struct eigrp *eigrp, struct eigrp_prefix_entry *pe,
+		struct TLV_IPv4_External_type *ext)
+{
+	if ((pe->nt != EIGRP_TOPOLOGY_TYPE_REMOTE
+			&& pe->nt != EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL)
+		|| (pe->extTLV
+			&& pe->extTLV->originating_router.s_addr == eigrp->router_id))
+	{
+		eigrp_IPv4_ExternalTLV_free (ext);
+		return;
+	}
+
+	if (pe->extTLV)
+		eigrp_IPv4_ExternalTLV_free (pe->extTLV);
+	pe->extTLV = ext;
+	pe->nt = EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL;
+}
+
 /**
  * @fn eigrp_update_receive_GR_ask
  *
@@ -129,24 +211,23 @@ eigrp_update_receive_GR_ask (struct eigrp *eigrp, struct eigrp_neighbor *nbr, st
 
 
 		/* prepare message for FSM */
-		struct eigrp_fsm_action_message *fsm_msg;
-		fsm_msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-		  sizeof(struct eigrp_fsm_action_message));
+		struct eigrp_fsm_action_message fsm_msg;
+		memset(&fsm_msg, 0, sizeof(fsm_msg));
 
 		struct eigrp_neighbor_entry *entry =
 		  eigrp_prefix_entry_lookup(prefix->entries, nbr);
 
-		fsm_msg->packet_type = EIGRP_OPC_UPDATE;
-		fsm_msg->eigrp = eigrp;
-		fsm_msg->data_type = EIGRP_TLV_IPv4_INT;
-		fsm_msg->adv_router = nbr;
-		fsm_msg->data.ipv4_int_type = tlv_max;
-		fsm_msg->entry = entry;
-		fsm_msg->prefix = prefix;
+		fsm_msg.packet_type = EIGRP_OPC_UPDATE;
+		fsm_msg.eigrp = eigrp;
+		fsm_msg.data_type = EIGRP_TLV_IPv4_INT;
+		fsm_msg.adv_router = nbr;
+		fsm_msg.data.ipv4_int_type = tlv_max;
+		fsm_msg.entry = entry;
+		fsm_msg.prefix = prefix;
 
 		/* send message to FSM */
-		int event = eigrp_get_fsm_event(fsm_msg);
-		eigrp_fsm_event(fsm_msg, event);
+		int event = eigrp_get_fsm_event(&fsm_msg);
+		eigrp_fsm_event(&fsm_msg, event);
 
 		/* free memory used by TLV */
 		eigrp_IPv4_InternalTLV_free (tlv_max);
@@ -162,6 +243,7 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 {
   struct eigrp_neighbor *nbr;
   struct TLV_IPv4_Internal_type *tlv;
+  struct TLV_IPv4_External_type *ext;
   struct eigrp_prefix_entry *pe;
   struct eigrp_neighbor_entry *ne;
   u_int32_t flags;
@@ -185,12 +267,8 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
   /* neighbor must be valid, eigrp_nbr_get creates if none existed */
   assert(nbr);
 
-  flags = ntohl(eigrph->flags);
-
-  if (flags & EIGRP_CR_FLAG)
-    {
-      return;
-    }
+  /* CR packets were already filtered by eigrp_read() */
+  flags = ntohl(eigrph->flags) & ~EIGRP_CR_FLAG;
 
   same = 0;
   graceful_restart = 0;
@@ -287,59 +365,88 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
   while (s->endp > s->getp)
     {
       type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      if (EIGRP_TLV_IS_ROUTE(type))
         {
           stream_set_getp(s, s->getp - sizeof(u_int16_t));
 
-          tlv = eigrp_read_ipv4_tlv(s);
+          tlv = eigrp_read_route_tlv(s, type, &ext, eigrp->pkt_arena);
+          if (tlv == NULL)
+            continue;
+
+          /* our own redistributed route came back */
+          if (ext && ext->originating_router.s_addr == eigrp->router_id)
+            {
+              eigrp_IPv4_ExternalTLV_free (ext);
+              continue;
+            }
 
           /*searching if destination exists */
           struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
+          dest_addr = mem_arena_alloc(eigrp->pkt_arena,
+              sizeof(struct prefix_ipv4));
+          dest_addr->family = AF_INET;
           dest_addr->prefix = tlv->destination;
           dest_addr->prefixlen = tlv->prefix_length;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
               eigrp->topology_table, dest_addr);
 
+          /* our own summary wins over the same prefix learned */
+          if (dest != NULL && dest->nt == EIGRP_TOPOLOGY_TYPE_SUMMARY)
+            {
+              if(graceful_restart)
+                remove_received_prefix_gr(nbr_prefixes, dest);
+            }
           /*if exists it comes to DUAL*/
-          if (dest != NULL)
+          else if (dest != NULL)
             {
         	  /* remove received prefix from neighbor prefix list if in GR */
         	  if(graceful_restart)
         		  remove_received_prefix_gr(nbr_prefixes, dest);
 
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
+              if (ext)
+                {
+                  eigrp_update_external_set(eigrp, dest, ext);
+                  ext = NULL;
+                }
+
+              struct eigrp_fsm_action_message msg;
+              memset(&msg, 0, sizeof(msg));
               struct eigrp_neighbor_entry *entry =
                   eigrp_prefix_entry_lookup(dest->entries, nbr);
 
-              msg->packet_type = EIGRP_OPC_UPDATE;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = dest;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
+              msg.packet_type = EIGRP_OPC_UPDATE;
+              msg.eigrp = eigrp;
+              msg.data_type = EIGRP_TLV_IPv4_INT;
+              msg.adv_router = nbr;
+              msg.data.ipv4_int_type = tlv;
+              msg.entry = entry;
+              msg.prefix = dest;
+              int event = eigrp_get_fsm_event(&msg);
+              eigrp_fsm_event(&msg, event);
             }
           else
             {
               /*Here comes topology information save*/
               pe = eigrp_prefix_entry_new();
-              pe->serno = eigrp->serno;
-              pe->destination_ipv4 = dest_addr;
+              pe->serno = ++eigrp->serno;
+              pe->destination_ipv4 = prefix_ipv4_new();
+              *pe->destination_ipv4 = *dest_addr;
               pe->af = AF_INET;
               pe->state = EIGRP_FSM_STATE_PASSIVE;
               pe->nt = EIGRP_TOPOLOGY_TYPE_REMOTE;
+              if (ext)
+                {
+                  pe->nt = EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL;
+                  pe->extTLV = ext;
+                  ext = NULL;
+                }
 
               ne = eigrp_neighbor_entry_new();
               ne->ei = ei;
               ne->adv_router = nbr;
               ne->reported_metric = tlv->metric;
               ne->reported_distance = eigrp_calculate_metrics(eigrp,
-                  &tlv->metric);
+                  &ne->reported_metric);
 
               //TODO: Work in progress
               /*
@@ -363,7 +470,6 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 				  zlog_info("PROC alist IN: Skipping");
 				  //ne->reported_metric.delay = EIGRP_MAX_METRIC;
 				  zlog_info("PROC IN Prefix: %s", inet_ntoa(dest_addr->prefix));
-				  eigrp_IPv4_InternalTLV_free (tlv);
 				  continue;
 			  } else {
 				  zlog_info("PROC alist IN: NENastavujem metriku ");
@@ -385,7 +491,6 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 				  zlog_info("PLIST PROC IN: Skipping");
 				  //ne->reported_metric.delay = EIGRP_MAX_METRIC;
 				  zlog_info("PLIST PROC IN Prefix: %s", inet_ntoa(dest_addr->prefix));
-				  eigrp_IPv4_InternalTLV_free (tlv);
 				  continue;
 			  } else {
 				  zlog_info("PLIST PROC IN: NENastavujem metriku ");
@@ -421,7 +526,6 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 			  	  zlog_info("INT alist IN: Skipping");
 			  	  //ne->reported_metric.delay = EIGRP_MAX_METRIC;
 			  	  zlog_info("INT IN Prefix: %s", inet_ntoa(dest_addr->prefix));
-			  	  eigrp_IPv4_InternalTLV_free (tlv);
 			  	  continue;
 			  	} else {
 			  	  zlog_info("INT IN: NENastavujem metriku ");
@@ -443,7 +547,6 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 				  zlog_info("PLIST INT IN: Skipping");
 				  //ne->reported_metric.delay = EIGRP_MAX_METRIC;
 				  zlog_info("PLIST INT IN Prefix: %s", inet_ntoa(dest_addr->prefix));
-				  eigrp_IPv4_InternalTLV_free (tlv);
 				  continue;
 			  } else {
 				  zlog_info("PLIST INT IN: NENastavujem metriku ");
@@ -468,7 +571,7 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 
 			  ne->distance = eigrp_calculate_total_metrics(eigrp, ne);
 
-			  zlog_info("<DEBUG PROC IN Distance: %x", ne->distance);
+			  zlog_info("<DEBUG PROC IN Distance: %llx", (unsigned long long) ne->distance);
 			  zlog_info("<DEBUG PROC IN Delay: %x", ne->total_metric.delay);
 
               pe->fdistance = pe->distance = pe->rdistance =
@@ -482,10 +585,11 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
               pe->reported_metric = ne->total_metric;
               eigrp_topology_update_node_flags(pe);
 
-              pe->req_action |= EIGRP_FSM_NEED_UPDATE;
-              listnode_add(eigrp->topology_changes_internalIPV4, pe);
+              eigrp_topology_change_add(eigrp, pe,
+                  EIGRP_FSM_NEED_UPDATE | EIGRP_FSM_NEED_RIB);
             }
-          eigrp_IPv4_InternalTLV_free (tlv);
+          if (ext)
+            eigrp_IPv4_ExternalTLV_free (ext);
         }
     }
 
@@ -504,8 +608,8 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
       eigrp_hello_send_ack(nbr);
     }
 
-  eigrp_query_send_all(eigrp);
-  eigrp_update_send_all(eigrp, ei);
+  /* all TLVs went through DUAL, now send results once */
+  eigrp_fsm_batch_flush(eigrp, ei);
 }
 
 /*send EIGRP Update packet*/
@@ -564,13 +668,8 @@ eigrp_update_send_EOT (struct eigrp_neighbor *nbr)
   u_int16_t length = EIGRP_HEADER_LEN;
   struct eigrp_neighbor_entry *te;
   struct eigrp_prefix_entry *pe;
-  struct listnode *node, *node2, *nnode, *nnode2;
-  struct access_list *alist;
-  struct prefix_list *plist;
-  struct access_list *alist_i;
-  struct prefix_list *plist_i;
-  struct eigrp *e;
-  struct prefix_ipv4 *dest_addr;
+  struct route_node *rn;
+  struct listnode *node2, *nnode2;
 
   ep = eigrp_packet_new(nbr->ei->ifp->mtu);
 
@@ -585,55 +684,27 @@ eigrp_update_send_EOT (struct eigrp_neighbor *nbr)
       length += eigrp_add_authTLV_MD5_to_stream(ep->s,nbr->ei);
     }
 
-  for (ALL_LIST_ELEMENTS(nbr->ei->eigrp->topology_table, node, nnode, pe))
+  for (rn = route_top(nbr->ei->eigrp->topology_table); rn; rn = route_next(rn))
     {
+      if ((pe = rn->info) == NULL)
+        continue;
+
       for (ALL_LIST_ELEMENTS(pe->entries, node2, nnode2, te))
         {
           if ((te->ei == nbr->ei)
               && (te->prefix->nt == EIGRP_TOPOLOGY_TYPE_REMOTE))
             continue;
 
+          if (eigrp_summary_suppressed(nbr->ei, pe)
+              || eigrp_update_stub_suppressed(nbr->ei->eigrp, pe))
+            continue;
 
-          /* Get destination address from prefix */
-		  dest_addr = pe->destination_ipv4;
-
-		  /*
-		   * Filtering
-		   */
-		  //TODO: Work in progress
-		  /* get list from eigrp process */
-		  e = eigrp_lookup();
-		  /* Get access-lists and prefix-lists from process and interface */
-		  alist = e->list[EIGRP_FILTER_OUT];
-		  plist = e->prefix[EIGRP_FILTER_OUT];
-		  alist_i = nbr->ei->list[EIGRP_FILTER_OUT];
-		  plist_i = nbr->ei->prefix[EIGRP_FILTER_OUT];
-
-		  /* Check if any list fits */
-		  if ((alist && access_list_apply (alist,
-					 (struct prefix *) dest_addr) == FILTER_DENY)||
-				  (plist && prefix_list_apply (plist,
-							(struct prefix *) dest_addr) == FILTER_DENY)||
-				  (alist_i && access_list_apply (alist_i,
-							(struct prefix *) dest_addr) == FILTER_DENY)||
-				  (plist_i && prefix_list_apply (plist_i,
-							(struct prefix *) dest_addr) == FILTER_DENY))
-		  {
-			  zlog_info("PROC OUT EOT: Skipping");
-			  //pe->reported_metric.delay = EIGRP_MAX_METRIC;
-			  zlog_info("PROC OUT EOT Prefix: %s", inet_ntoa(dest_addr->prefix));
-			  continue;
-		  } else {
-			  zlog_info("PROC OUT EOT: NENastavujem metriku ");
-			  length += eigrp_add_internalTLV_to_stream(ep->s, pe);
-		  }
-		  /*
-		   * End of filtering
-		   */
-
-		  /* NULL the pointer */
-		  dest_addr = NULL;
+          /* new neighbor has nothing to withdraw, filtered routes are skipped */
+          if (eigrp_filter_out_peek(nbr->ei, pe) == EIGRP_FILTER_DENY)
+            continue;
 
+          length += eigrp_add_internalTLV_to_stream(ep->s, pe,
+                                                    eigrp_nbr_tlv_wide(nbr));
         }
     }
 
@@ -665,122 +736,141 @@ eigrp_update_send_EOT (struct eigrp_neighbor *nbr)
 
 }
 
+/*
+ * Append prefix to update being built, filtered prefix goes with
+ * unreachable metric so neighbors drop it.
+ */
+static u_int16_t
+eigrp_update_add_prefix (struct stream *s, struct eigrp_prefix_entry *pe,
+                         u_char verdict, size_t *last_tlv, size_t limit,
+                         int wide)
+{
+  u_int32_t delay;
+  u_int16_t added;
+
+  if (verdict != EIGRP_FILTER_DENY)
+    return eigrp_add_internalTLV_packed(s, pe, last_tlv, limit, wide);
+
+  delay = pe->reported_metric.delay;
+  pe->reported_metric.delay = EIGRP_MAX_METRIC;
+  added = eigrp_add_internalTLV_packed(s, pe, last_tlv, limit, wide);
+  pe->reported_metric.delay = delay;
+
+  return added;
+}
+
 void
 eigrp_update_send (struct eigrp_interface *ei)
 {
   struct eigrp_packet *ep;
-  struct listnode *node, *nnode, *nnode2;
-  struct eigrp_neighbor *nbr;
+  struct listnode *node, *nnode;
   struct eigrp_prefix_entry *pe;
-  u_char has_tlv;
-  struct access_list *alist;
-  struct prefix_list *plist;
-  struct access_list *alist_i;
-  struct prefix_list *plist_i;
-  struct eigrp *e;
-  struct prefix_ipv4 *dest_addr;
+  size_t last_tlv = 0;
+  size_t limit = eigrp_packet_max_length(ei);
+  int wide = eigrp_if_tlv_wide(ei);
+  u_int16_t added;
+  u_char verdict, prev;
 
   u_int16_t length = EIGRP_HEADER_LEN;
 
-  ep = eigrp_packet_new(ei->ifp->mtu);
-
-  /* Prepare EIGRP INIT UPDATE header */
-  eigrp_packet_header_init(EIGRP_OPC_UPDATE, ei, ep->s, 0,
-                           ei->eigrp->sequence_number, 0);
-
-  // encode Authentication TLV, if needed
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
-    {
-      length += eigrp_add_authTLV_MD5_to_stream(ep->s,ei);
-    }
-
-  has_tlv = 0;
+  /* packets are started lazily, one per MTU worth of routes */
+  ep = NULL;
   for (ALL_LIST_ELEMENTS(ei->eigrp->topology_changes_internalIPV4, node, nnode, pe))
     {
       if(pe->req_action & EIGRP_FSM_NEED_UPDATE)
         {
 
-    	  /* Get destination address from prefix */
-    	  dest_addr = pe->destination_ipv4;
-
-    	  /*
-		   * Filtering
-		   */
-    	  //TODO: Work in progress
-		  /* get list from eigrp process */
-		  e = eigrp_lookup();
-		  /* Get access-lists and prefix-lists from process and interface */
-		  alist = e->list[EIGRP_FILTER_OUT];
-		  plist = e->prefix[EIGRP_FILTER_OUT];
-		  alist_i = ei->list[EIGRP_FILTER_OUT];
-		  plist_i = ei->prefix[EIGRP_FILTER_OUT];
-
-		  /* Check if any list fits */
-		  if ((alist && access_list_apply (alist,
-					 (struct prefix *) dest_addr) == FILTER_DENY)||
-				  (plist && prefix_list_apply (plist,
-							 (struct prefix *) dest_addr) == FILTER_DENY)||
-				  (alist_i && access_list_apply (alist_i,
-							(struct prefix *) dest_addr) == FILTER_DENY)||
-				  (plist_i && prefix_list_apply (plist_i,
-							(struct prefix *) dest_addr) == FILTER_DENY))
-		  {
-			  zlog_info("PROC OUT: Skipping");
-			  //pe->reported_metric.delay = EIGRP_MAX_METRIC;
-			  zlog_info("PROC OUT Prefix: %s", inet_ntoa(dest_addr->prefix));
-			  continue;
-		  } else {
-			  zlog_info("PROC OUT: NENastavujem metriku ");
-			  length += eigrp_add_internalTLV_to_stream(ep->s, pe);
-			  has_tlv = 1;
-		  }
-		  /*
-		   * End of filtering
-		   */
-
-		  /* NULL the pointer */
-		  dest_addr = NULL;
-
+    	  /* components stay behind summary configured on interface */
+    	  if (eigrp_summary_suppressed(ei, pe)
+    	      || eigrp_update_stub_suppressed(ei->eigrp, pe))
+    	    continue;
+
+    	  /* route permitted before filter change has to be withdrawn */
+    	  verdict = eigrp_filter_out(ei, pe, &prev);
+    	  if (verdict == EIGRP_FILTER_DENY && prev != EIGRP_FILTER_PERMIT)
+    	    continue;
+
+    	  if (ep == NULL)
+    	    ep = eigrp_packet_multicast_new(ei, EIGRP_OPC_UPDATE, &length);
+    	  added = eigrp_update_add_prefix(ep->s, pe, verdict, &last_tlv, limit, wide);
+    	  if (added == 0)
+    	    {
+    	      /* packet is full, send it and continue in next one */
+    	      eigrp_packet_multicast_enqueue(ei, ep, length);
+    	      ep = eigrp_packet_multicast_new(ei, EIGRP_OPC_UPDATE, &length);
+    	      last_tlv = 0;
+    	      added = eigrp_update_add_prefix(ep->s, pe, verdict, &last_tlv, limit, wide);
+    	    }
+    	  length += added;
         }
     }
 
-  if(!has_tlv)
-    {
-      eigrp_packet_free(ep);
-      return;
-    }
-
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
-    {
-      eigrp_make_md5_digest(ei,ep->s, EIGRP_AUTH_UPDATE_FLAG);
-    }
-
-  /* EIGRP Checksum */
-  eigrp_packet_checksum(ei, ep->s, length);
-  ep->length = length;
-
-  ep->dst.s_addr = htonl(EIGRP_MULTICAST_ADDRESS);
-
-  /*This ack number we await from neighbor*/
-  ep->sequence_number = ei->eigrp->sequence_number;
+  if (ep)
+    eigrp_packet_multicast_enqueue(ei, ep, length);
+}
 
-  if (IS_DEBUG_EIGRP_PACKET(0, RECV))
-    zlog_debug("Enqueuing Update length[%u] Seq [%u]",
-               length, ep->sequence_number);
+/**
+ * @fn eigrp_update_send_filter_delta
+ *
+ * @param[in]		ei		interface whose outbound filters changed
+ *
+ * @return void
+ *
+ * @par
+ * Re-evaluates outbound filters of interface for every prefix and sends
+ * update only with prefixes whose verdict changed since they were last
+ * advertised: newly permitted go with their metric, newly denied as
+ * unreachable.  Neighbors keep the rest of their tables, so no
+ * Graceful restart is needed.
+ */
+void
+eigrp_update_send_filter_delta (struct eigrp_interface *ei)
+{
+  struct eigrp_packet *ep = NULL;
+  struct eigrp_prefix_entry *pe;
+  struct route_node *rn;
+  size_t last_tlv = 0;
+  size_t limit = eigrp_packet_max_length(ei);
+  int wide = eigrp_if_tlv_wide(ei);
+  u_int16_t length = EIGRP_HEADER_LEN;
+  u_int16_t added;
+  u_char verdict, prev;
+  unsigned int changed = 0;
 
-  for (ALL_LIST_ELEMENTS(ei->nbrs, node, nnode, nbr))
+  for (rn = route_top(ei->eigrp->topology_table); rn; rn = route_next(rn))
     {
-      if (nbr->state == EIGRP_NEIGHBOR_UP)
+      if ((pe = rn->info) == NULL)
+        continue;
+
+      if (eigrp_summary_suppressed(ei, pe)
+          || eigrp_update_stub_suppressed(ei->eigrp, pe))
+        continue;
+
+      /* prefix never advertised on interface has nothing to correct */
+      verdict = eigrp_filter_out(ei, pe, &prev);
+      if (prev == EIGRP_FILTER_UNKNOWN || verdict == prev)
+        continue;
+
+      if (ep == NULL)
+        ep = eigrp_packet_multicast_new(ei, EIGRP_OPC_UPDATE, &length);
+      added = eigrp_update_add_prefix(ep->s, pe, verdict, &last_tlv, limit, wide);
+      if (added == 0)
         {
-          /*Put packet to retransmission queue*/
-          eigrp_fifo_push_head(nbr->retrans_queue, ep);
-
-          if (nbr->retrans_queue->count == 1)
-            {
-              eigrp_send_packet_reliably(nbr);
-            }
+          eigrp_packet_multicast_enqueue(ei, ep, length);
+          ep = eigrp_packet_multicast_new(ei, EIGRP_OPC_UPDATE, &length);
+          last_tlv = 0;
+          added = eigrp_update_add_prefix(ep->s, pe, verdict, &last_tlv, limit, wide);
         }
+      length += added;
+      changed++;
     }
+
+  if (ep)
+    eigrp_packet_multicast_enqueue(ei, ep, length);
+
+  if (IS_DEBUG_EIGRP_PACKET(0, SEND))
+    zlog_debug("Filter change on %s: %u prefixes resent",
+               ei->ifp->name, changed);
 }
 
 void
@@ -804,12 +894,33 @@ eigrp_update_send_all (struct eigrp *eigrp, struct eigrp_interface *exception)
       if(pe->req_action & EIGRP_FSM_NEED_UPDATE)
         {
           pe->req_action &= ~EIGRP_FSM_NEED_UPDATE;
-          listnode_delete(eigrp->topology_changes_internalIPV4, pe);
+          /* keep prefix queued while query is still pending */
+          if (!(pe->req_action & EIGRP_FSM_NEED_QUERY))
+            listnode_delete(eigrp->topology_changes_internalIPV4, pe);
           zlog_debug("UPDATE COUNT: %d", eigrp->topology_changes_internalIPV4->count);
         }
     }
 }
 
+/*
+ * Advance Graceful restart cursor. At the end of table start another pass
+ * over prefixes changed during previous one, if there are any.
+ */
+static struct route_node *
+eigrp_update_GR_next(struct eigrp *eigrp, struct eigrp_neighbor *nbr,
+    struct route_node *rn)
+{
+  rn = route_next(rn);
+  if (rn == NULL && eigrp->serno != nbr->nbr_gr_serno)
+    {
+      nbr->nbr_gr_serno_from = nbr->nbr_gr_serno;
+      nbr->nbr_gr_serno = eigrp->serno;
+      rn = route_top(eigrp->topology_table);
+    }
+
+  return rn;
+}
+
 /**
  * @fn eigrp_update_send_GR_part
  *
@@ -822,6 +933,10 @@ eigrp_update_send_all (struct eigrp *eigrp, struct eigrp_interface *exception)
  * and if there are multiple chunks, send only one of them.
  * It is called from thread. Do not call it directly.
  *
+ * Walks topology table from nbr_gr_cursor. When the walk reaches
+ * the end and topology changed since the pass started, another pass
+ * sends only prefixes changed meanwhile. Last chunk carries EOT flag.
+ *
  * Uses nbr_gr_packet_type from neighbor.
  */
 static void
@@ -829,20 +944,16 @@ eigrp_update_send_GR_part(struct eigrp_neighbor *nbr)
 {
 	struct eigrp_packet *ep;
 	u_int16_t length = EIGRP_HEADER_LEN;
-	struct listnode *node, *nnode;
+	struct route_node *rn;
 	struct eigrp_prefix_entry *pe;
 	struct prefix_ipv4 *dest_addr;
 	struct eigrp *e;
 	struct access_list *alist, *alist_i;
 	struct prefix_list *plist, *plist_i;
-	struct list *prefixes;
 	u_int32_t flags;
 	unsigned int send_prefixes;
 	struct TLV_IPv4_Internal_type *tlv_max;
 
-	/* get prefixes to send to neighbor */
-	prefixes = nbr->nbr_gr_prefixes_send;
-
 	send_prefixes = 0;
 	length = EIGRP_HEADER_LEN;
 
@@ -850,40 +961,14 @@ eigrp_update_send_GR_part(struct eigrp_neighbor *nbr)
 	if(nbr->nbr_gr_packet_type == EIGRP_PACKET_PART_LAST)
 		return;
 
-	/* if this is first packet chunk, we need to decide,
-	 * if there will be one or more chunks */
+	/* first chunk starts resync, EOT is added when walk is done */
 	if(nbr->nbr_gr_packet_type == EIGRP_PACKET_PART_FIRST)
-	{
-		if(prefixes->count <= EIGRP_TLV_MAX_IPv4)
-		{
-			/* there will be only one chunk */
-			flags = EIGRP_INIT_FLAG + EIGRP_RS_FLAG + EIGRP_EOT_FLAG;
-			nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_LAST;
-		}
-		else
-		{
-			/* there will be more chunks */
-			flags = EIGRP_INIT_FLAG + EIGRP_RS_FLAG;
-			nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_NA;
-		}
-	}
+		flags = EIGRP_INIT_FLAG + EIGRP_RS_FLAG;
 	else
-	{
-		/* this is not first chunk, and we need to decide,
-		 * if there will be more chunks */
-		if(prefixes->count <= EIGRP_TLV_MAX_IPv4)
-		{
-			/* this is last chunk */
-			flags = EIGRP_EOT_FLAG;
-			nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_LAST;
-		}
-		else
-		{
-			/* there will be more chunks */
-			flags = 0;
-			nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_NA;
-		}
-	}
+		flags = 0;
+	nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_NA;
+
+	e = nbr->ei->eigrp;
 
 	ep = eigrp_packet_new(nbr->ei->ifp->mtu);
 
@@ -899,40 +984,47 @@ eigrp_update_send_GR_part(struct eigrp_neighbor *nbr)
 		length += eigrp_add_authTLV_MD5_to_stream(ep->s,nbr->ei);
 	}
 
-	for (ALL_LIST_ELEMENTS(nbr->ei->eigrp->topology_table, node, nnode, pe))
+	/* take over cursor reference, it is given back if walk stops early */
+	rn = nbr->nbr_gr_cursor;
+	nbr->nbr_gr_cursor = NULL;
+
+	while (rn != NULL)
 	{
+		/* if there are enough prefixes, send packet */
+		if(send_prefixes >= EIGRP_TLV_MAX_IPv4)
+		{
+			nbr->nbr_gr_cursor = rn;
+			break;
+		}
+
+		pe = rn->info;
+		if (pe == NULL || pe->serno <= nbr->nbr_gr_serno_from)
+		{
+			rn = eigrp_update_GR_next(e, nbr, rn);
+			continue;
+		}
 
 		/*
 		* Filtering
 		*/
 		dest_addr = pe->destination_ipv4;
-		/* get list from eigrp process */
-		e = eigrp_lookup();
-		/* Get access-lists and prefix-lists from process and interface */
-		alist = e->list[EIGRP_FILTER_OUT];
-		plist = e->prefix[EIGRP_FILTER_OUT];
-		alist_i = nbr->ei->list[EIGRP_FILTER_OUT];
-		plist_i = nbr->ei->prefix[EIGRP_FILTER_OUT];
 
 
 		/* Check if any list fits */
-		if ((alist && access_list_apply (alist,
-				 (struct prefix *) dest_addr) == FILTER_DENY)||
-			  (plist && prefix_list_apply (plist,
-						(struct prefix *) dest_addr) == FILTER_DENY)||
-			  (alist_i && access_list_apply (alist_i,
-						(struct prefix *) dest_addr) == FILTER_DENY)||
-			  (plist_i && prefix_list_apply (plist_i,
-						(struct prefix *) dest_addr) == FILTER_DENY))
+		if (eigrp_summary_suppressed(nbr->ei, pe)
+		    || eigrp_update_stub_suppressed(e, pe))
 		{
-			/* do not send filtered route */
-			zlog_info("Filtered prefix %s won't be sent out.",
-					inet_ntoa(dest_addr->prefix));
+			/* component of summary or route type stub does not send */
+		}
+		else if (eigrp_filter_out_peek(nbr->ei, pe) == EIGRP_FILTER_DENY)
+		{
+			/* do not send filtered route, resync drops it on neighbor */
 		}
 		else
 		{
 			/* sending route which wasn't filtered */
-			length += eigrp_add_internalTLV_to_stream(ep->s, pe);
+			length += eigrp_add_internalTLV_to_stream(ep->s, pe,
+			                                          eigrp_nbr_tlv_wide(nbr));
 			send_prefixes++;
 		}
 
@@ -969,24 +1061,23 @@ eigrp_update_send_GR_part(struct eigrp_neighbor *nbr)
 
 
 			/* prepare message for FSM */
-			struct eigrp_fsm_action_message *fsm_msg;
-			fsm_msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-			  sizeof(struct eigrp_fsm_action_message));
+			struct eigrp_fsm_action_message fsm_msg;
+			memset(&fsm_msg, 0, sizeof(fsm_msg));
 
 			struct eigrp_neighbor_entry *entry =
 			  eigrp_prefix_entry_lookup(pe->entries, nbr);
 
-			fsm_msg->packet_type = EIGRP_OPC_UPDATE;
-			fsm_msg->eigrp = e;
-			fsm_msg->data_type = EIGRP_TLV_IPv4_INT;
-			fsm_msg->adv_router = nbr;
-			fsm_msg->data.ipv4_int_type = tlv_max;
-			fsm_msg->entry = entry;
-			fsm_msg->prefix = pe;
+			fsm_msg.packet_type = EIGRP_OPC_UPDATE;
+			fsm_msg.eigrp = e;
+			fsm_msg.data_type = EIGRP_TLV_IPv4_INT;
+			fsm_msg.adv_router = nbr;
+			fsm_msg.data.ipv4_int_type = tlv_max;
+			fsm_msg.entry = entry;
+			fsm_msg.prefix = pe;
 
 			/* send message to FSM */
-			int event = eigrp_get_fsm_event(fsm_msg);
-			eigrp_fsm_event(fsm_msg, event);
+			int event = eigrp_get_fsm_event(&fsm_msg);
+			eigrp_fsm_event(&fsm_msg, event);
 
 			/* free memory used by TLV */
 			eigrp_IPv4_InternalTLV_free (tlv_max);
@@ -998,13 +1089,17 @@ eigrp_update_send_GR_part(struct eigrp_neighbor *nbr)
 		/* NULL the pointer */
 		dest_addr = NULL;
 
-		/* delete processed prefix from list */
-		listnode_delete(prefixes, pe);
+		/* route_next keeps the node alive even if FSM removed prefix */
+		rn = eigrp_update_GR_next(e, nbr, rn);
+	}
 
-		/* if there are enough prefixes, send packet */
-		if(send_prefixes >= EIGRP_TLV_MAX_IPv4)
-			break;
+	/* walk is done, this is last chunk */
+	if (nbr->nbr_gr_cursor == NULL)
+	{
+		flags += EIGRP_EOT_FLAG;
+		nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_LAST;
 	}
+	stream_putl_at(ep->s, offsetof(struct eigrp_header, flags), flags);
 
 	/* compute Auth digest */
 	if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
@@ -1033,6 +1128,9 @@ eigrp_update_send_GR_part(struct eigrp_neighbor *nbr)
 	{
 		eigrp_send_packet_reliably(nbr);
 	}
+
+	/* send queries, withdraws and RIB changes caused by filtered prefixes */
+	eigrp_fsm_batch_flush(e, NULL);
 }
 
 /**
@@ -1045,6 +1143,8 @@ eigrp_update_send_GR_part(struct eigrp_neighbor *nbr)
  * @par
  * Function used for sending Graceful restart Update packet
  * in thread, it is prepared for multiple chunks of packet.
+ * While neighbor did not acknowledge previous chunks, next one
+ * is delayed proportionally to its retransmit queue depth.
  *
  * Uses nbr_gr_packet_type and t_nbr_send_gr from neighbor.
  */
@@ -1052,17 +1152,21 @@ int
 eigrp_update_send_GR_thread(struct thread *thread)
 {
 	struct eigrp_neighbor *nbr;
+	long delay;
 
 	/* get argument from thread */
 	nbr = THREAD_ARG(thread);
 	/* remove this thread pointer */
 	nbr->t_nbr_send_gr = NULL;
 
-	/* if there is packet waiting in queue,
-	 * schedule this thread again with small delay */
+	/* if there are packets waiting in queue,
+	 * schedule this thread again, slower the deeper the queue is */
 	if(nbr->retrans_queue->count > 0)
 	{
-		nbr->t_nbr_send_gr = thread_add_timer_msec(master, eigrp_update_send_GR_thread, nbr, 10);
+		delay = EIGRP_GR_PACE_MSEC * nbr->retrans_queue->count;
+		if (delay > EIGRP_GR_PACE_MAX_MSEC)
+			delay = EIGRP_GR_PACE_MAX_MSEC;
+		nbr->t_nbr_send_gr = thread_add_timer_msec(master, eigrp_update_send_GR_thread, nbr, delay);
 		return 0;
 	}
 
@@ -1071,11 +1175,35 @@ eigrp_update_send_GR_thread(struct thread *thread)
 
 	/* if it wasn't last chunk, schedule this thread again */
 	if(nbr->nbr_gr_packet_type != EIGRP_PACKET_PART_LAST)
-		nbr->t_nbr_send_gr = thread_execute(master, eigrp_update_send_GR_thread, nbr, 0);
+		nbr->t_nbr_send_gr = thread_add_event(master, eigrp_update_send_GR_thread, nbr, 0);
 
 	return 0;
 }
 
+/**
+ * @fn eigrp_update_send_GR_stop
+ *
+ * @param[in]		nbr		Neighbor whose Graceful restart is cancelled
+ *
+ * @return void
+ *
+ * @par
+ * Function used for cancelling Graceful restart Update packet
+ * sending in progress, releases cursor of topology walk.
+ */
+void
+eigrp_update_send_GR_stop (struct eigrp_neighbor *nbr)
+{
+	THREAD_OFF(nbr->t_nbr_send_gr);
+
+	if(nbr->nbr_gr_cursor != NULL)
+	{
+		route_unlock_node(nbr->nbr_gr_cursor);
+		nbr->nbr_gr_cursor = NULL;
+	}
+	nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_NA;
+}
+
 /**
  * @fn eigrp_update_send_GR
  *
@@ -1093,9 +1221,7 @@ eigrp_update_send_GR_thread(struct thread *thread)
 void
 eigrp_update_send_GR (struct eigrp_neighbor *nbr, enum GR_type gr_type, struct vty *vty)
 {
-	struct eigrp_prefix_entry *pe2;
-	struct listnode *node2, *nnode2;
-	struct list *prefixes;
+	struct eigrp *eigrp = nbr->ei->eigrp;
 
 	if(gr_type == EIGRP_GR_FILTER)
 	{
@@ -1119,19 +1245,17 @@ eigrp_update_send_GR (struct eigrp_neighbor *nbr, enum GR_type gr_type, struct v
 		}
 	}
 
-	prefixes = list_new();
-	/* add all prefixes from topology table to list */
-	for (ALL_LIST_ELEMENTS(nbr->ei->eigrp->topology_table, node2, nnode2, pe2))
-	{
-		listnode_add(prefixes, pe2);
-	}
+	/* resync already in progress starts over */
+	eigrp_update_send_GR_stop(nbr);
 
-	/* save prefixes to neighbor */
-	nbr->nbr_gr_prefixes_send = prefixes;
+	/* walk whole topology table, cursor holds lock on its node */
+	nbr->nbr_gr_cursor = route_top(eigrp->topology_table);
+	nbr->nbr_gr_serno = eigrp->serno;
+	nbr->nbr_gr_serno_from = 0;
 	/* indicate, that this is first GR Update packet chunk */
 	nbr->nbr_gr_packet_type = EIGRP_PACKET_PART_FIRST;
-	/* execute packet sending in thread */
-	nbr->t_nbr_send_gr = thread_execute(master, eigrp_update_send_GR_thread, nbr, 0);
+	/* send first chunk now, thread reschedules itself in t_nbr_send_gr */
+	thread_execute(master, eigrp_update_send_GR_thread, nbr, 0);
 }
 
 /**
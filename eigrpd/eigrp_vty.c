@@ -43,6 +43,7 @@
 #include "zclient.h"
 #include "keychain.h"
 #include "linklist.h"
+#include "routemap.h"
 
 #include "eigrpd/eigrp_structs.h"
 #include "eigrpd/eigrpd.h"
@@ -54,6 +55,9 @@
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_dump.h"
 #include "eigrpd/eigrp_const.h"
+#include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_topology.h"
 
 
 static int
@@ -108,6 +112,13 @@ config_write_interfaces (struct vty *vty, struct eigrp *eigrp)
           vty_out (vty, " ip hold-time eigrp %d%s", IF_DEF_PARAMS (ei->ifp)->v_wait, VTY_NEWLINE);
         }
 
+      if ((IF_DEF_PARAMS (ei->ifp)->bandwidth_percent) != EIGRP_BANDWIDTH_PERCENT_DEFAULT)
+        {
+          vty_out (vty, " ip bandwidth-percent eigrp %u%s", IF_DEF_PARAMS (ei->ifp)->bandwidth_percent, VTY_NEWLINE);
+        }
+
+      eigrp_summary_config_write (vty, eigrp, ei->ifp);
+
       /*Separate this EIGRP interface configuration from the others*/
         vty_out (vty, "!%s", VTY_NEWLINE);
     }
@@ -140,6 +151,36 @@ config_write_eigrp_distribute (struct vty *vty, struct eigrp *eigrp)
 /**
  * Writes 'router eigrp' section to config
  */
+static int
+config_write_eigrp_redistribute (struct vty *vty, struct eigrp *eigrp)
+{
+  struct eigrp_metrics *metric;
+  int type;
+
+  for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+    {
+      if (type == ZEBRA_ROUTE_EIGRP || !eigrp_is_type_redistributed (type))
+        continue;
+
+      vty_out (vty, " redistribute %s", zebra_route_string (type));
+      if (eigrp->route_map[type].metric_config)
+        {
+          metric = &eigrp->dmetric[type];
+          vty_out (vty, " metric %u %u %u %u %u",
+                   eigrp_scaled_to_bandwidth (metric->bandwith),
+                   eigrp_scaled_to_delay (metric->delay),
+                   metric->reliability, metric->load,
+                   metric->mtu[0] | (metric->mtu[1] << 8)
+                   | (metric->mtu[2] << 16));
+        }
+      if (eigrp->route_map[type].name)
+        vty_out (vty, " route-map %s", eigrp->route_map[type].name);
+      vty_out (vty, "%s", VTY_NEWLINE);
+    }
+
+  return 0;
+}
+
 static int
 config_write_eigrp_router (struct vty *vty, struct eigrp *eigrp)
 {
@@ -162,9 +203,49 @@ config_write_eigrp_router (struct vty *vty, struct eigrp *eigrp)
 			 inet_ntoa (router_id_static), VTY_NEWLINE);
     }
 
+  /* Metric weights print. */
+  if (eigrp->k_values[0] != EIGRP_K1_DEFAULT
+      || eigrp->k_values[1] != EIGRP_K2_DEFAULT
+      || eigrp->k_values[2] != EIGRP_K3_DEFAULT
+      || eigrp->k_values[3] != EIGRP_K4_DEFAULT
+      || eigrp->k_values[4] != EIGRP_K5_DEFAULT)
+    vty_out (vty, " metric weights %d %d %d %d %d%s",
+             eigrp->k_values[0], eigrp->k_values[1], eigrp->k_values[2],
+             eigrp->k_values[3], eigrp->k_values[4], VTY_NEWLINE);
+
+  /* Active timer print. */
+  if (eigrp->active_time == 0)
+    vty_out (vty, " timers active-time disabled%s", VTY_NEWLINE);
+  else if (eigrp->active_time != EIGRP_ACTIVE_TIME_DEFAULT)
+    vty_out (vty, " timers active-time %u%s", eigrp->active_time, VTY_NEWLINE);
+
+  /* Metric version print. */
+  if (eigrp->wide_metrics)
+    vty_out (vty, " metric version 64bit%s", VTY_NEWLINE);
+
+  /* Stub routing print. */
+  if (eigrp->stub != 0)
+    {
+      vty_out (vty, " eigrp stub");
+      if (eigrp->stub & EIGRP_STUB_RECEIVE_ONLY)
+        vty_out (vty, " receive-only");
+      if (eigrp->stub & EIGRP_STUB_CONNECTED)
+        vty_out (vty, " connected");
+      if (eigrp->stub & EIGRP_STUB_STATIC)
+        vty_out (vty, " static");
+      if (eigrp->stub & EIGRP_STUB_SUMMARY)
+        vty_out (vty, " summary");
+      if (eigrp->stub & EIGRP_STUB_REDISTRIBUTED)
+        vty_out (vty, " redistributed");
+      vty_out (vty, "%s", VTY_NEWLINE);
+    }
+
   /* Network area print. */
   config_write_network (vty, eigrp);
 
+  /* Redistribution print. */
+  config_write_eigrp_redistribute (vty, eigrp);
+
   /* Distribute-list and default-information print. */
   config_write_eigrp_distribute (vty, eigrp);
 
@@ -262,7 +343,12 @@ DEFUN (eigrp_timers_active,
        "Disable time limit for active state\n")
 {
   struct eigrp *eigrp = vty->index;
-  /*TODO: */
+
+  /* routes active already keep their running timer */
+  if (strncmp (argv[0], "d", 1) == 0)
+    eigrp->active_time = 0;
+  else
+    eigrp->active_time = atoi (argv[0]);
 
   return CMD_SUCCESS;
 }
@@ -277,12 +363,22 @@ DEFUN (no_eigrp_timers_active,
        "Disable time limit for active state\n")
 {
   struct eigrp *eigrp = vty->index;
-  /*TODO: */
+
+  eigrp->active_time = EIGRP_ACTIVE_TIME_DEFAULT;
 
   return CMD_SUCCESS;
 }
 
 
+/* K-values changed, distances computed with old ones are stale */
+static void
+eigrp_metric_weights_apply (struct eigrp *eigrp)
+{
+  eigrp_metric_kernel_update (eigrp);
+  eigrp_topology_recalculate (eigrp);
+  eigrp_fsm_batch_flush (eigrp, NULL);
+}
+
 DEFUN (eigrp_metric_weights,
        eigrp_metric_weights_cmd,
        "metric weights <0-255> <0-255> <0-255> <0-255> <0-255> ",
@@ -295,7 +391,12 @@ DEFUN (eigrp_metric_weights,
        "K5\n")
 {
   struct eigrp *eigrp = vty->index;
-  /*TODO: */
+  int i;
+
+  /* neighbors with other K-values drop adjacency on their next hello */
+  for (i = 0; i < 5; i++)
+    eigrp->k_values[i] = atoi (argv[i]);
+  eigrp_metric_weights_apply (eigrp);
 
   return CMD_SUCCESS;
 }
@@ -312,7 +413,50 @@ DEFUN (no_eigrp_metric_weights,
        "K5\n")
 {
   struct eigrp *eigrp = vty->index;
-  /*TODO: */
+
+  eigrp->k_values[0] = EIGRP_K1_DEFAULT;
+  eigrp->k_values[1] = EIGRP_K2_DEFAULT;
+  eigrp->k_values[2] = EIGRP_K3_DEFAULT;
+  eigrp->k_values[3] = EIGRP_K4_DEFAULT;
+  eigrp->k_values[4] = EIGRP_K5_DEFAULT;
+  eigrp_metric_weights_apply (eigrp);
+
+  return CMD_SUCCESS;
+}
+
+/* Switch composite metric formula and recompute topology with it */
+static void
+eigrp_metric_version_set (struct eigrp *eigrp, u_char wide)
+{
+  if (eigrp->wide_metrics == wide)
+    return;
+
+  eigrp->wide_metrics = wide;
+  eigrp_topology_recalculate (eigrp);
+  eigrp_fsm_batch_flush (eigrp, NULL);
+}
+
+DEFUN (eigrp_metric_version,
+       eigrp_metric_version_cmd,
+       "metric version 64bit",
+       "Modify metrics and parameters for advertisement\n"
+       "Metric version\n"
+       "64-bit wide metrics, TLV version 2.0\n")
+{
+  eigrp_metric_version_set (vty->index, 1);
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_eigrp_metric_version,
+       no_eigrp_metric_version_cmd,
+       "no metric version 64bit",
+       NO_STR
+       "Modify metrics and parameters for advertisement\n"
+       "Metric version\n"
+       "64-bit wide metrics, TLV version 2.0\n")
+{
+  eigrp_metric_version_set (vty->index, 0);
 
   return CMD_SUCCESS;
 }
@@ -400,7 +544,8 @@ DEFUN (show_ip_eigrp_topology,
        "IP-EIGRP topology\n")
 {
   struct eigrp *eigrp;
-  struct listnode *node, *nnode, *node2, *nnode2;
+  struct route_node *rn;
+  struct listnode *node2, *nnode2;
   struct eigrp_prefix_entry *tn;
   struct eigrp_neighbor_entry *te;
 
@@ -413,8 +558,11 @@ DEFUN (show_ip_eigrp_topology,
 
   show_ip_eigrp_topology_header (vty, eigrp);
 
-  for (ALL_LIST_ELEMENTS (eigrp->topology_table, node, nnode, tn))
+  for (rn = route_top (eigrp->topology_table); rn; rn = route_next (rn))
   {
+    if ((tn = rn->info) == NULL)
+      continue;
+
     show_ip_eigrp_prefix_entry (vty,tn);
     for (ALL_LIST_ELEMENTS (tn->entries, node2, nnode2, te))
       {
@@ -437,7 +585,8 @@ DEFUN (show_ip_eigrp_topology_all_links,
        "Show all links in topology table\n")
 {
   struct eigrp *eigrp;
-  struct listnode *node, *nnode, *node2, *nnode2;
+  struct route_node *rn;
+  struct listnode *node2, *nnode2;
   struct eigrp_prefix_entry *tn;
   struct eigrp_neighbor_entry *te;
 
@@ -450,8 +599,11 @@ DEFUN (show_ip_eigrp_topology_all_links,
 
   show_ip_eigrp_topology_header (vty, eigrp);
 
-  for (ALL_LIST_ELEMENTS (eigrp->topology_table, node, nnode, tn))
+  for (rn = route_top (eigrp->topology_table); rn; rn = route_next (rn))
     {
+      if ((tn = rn->info) == NULL)
+        continue;
+
       show_ip_eigrp_prefix_entry (vty,tn);
       for (ALL_LIST_ELEMENTS (tn->entries, node2, nnode2, te))
         {
@@ -609,6 +761,7 @@ DEFUN (eigrp_if_delay,
 
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->delay = delay;
+  eigrp_if_metric_reset (eigrp, ifp);
 
 
   return CMD_SUCCESS;
@@ -637,6 +790,7 @@ DEFUN (no_eigrp_if_delay,
 
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->delay = EIGRP_DELAY_DEFAULT;
+  eigrp_if_metric_reset (eigrp, ifp);
 
   return CMD_SUCCESS;
 }
@@ -673,6 +827,7 @@ DEFUN (eigrp_if_bandwidth,
 
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->bandwidth = bandwidth;
+  eigrp_if_metric_reset (eigrp, ifp);
 
 
   return CMD_SUCCESS;
@@ -688,6 +843,7 @@ DEFUN (no_eigrp_if_bandwidth,
   struct eigrp *eigrp;
   struct eigrp_interface *ei;
   struct listnode *node, *nnode, *node2, *nnode2;
+  struct route_node *rn;
   struct interface *ifp;
   struct eigrp_prefix_entry *pe;
   struct eigrp_neighbor_entry *ne;
@@ -710,6 +866,7 @@ DEFUN (no_eigrp_if_bandwidth,
 
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->bandwidth = bandwidth;
+  eigrp_if_metric_reset (eigrp, ifp);
 
   for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
     {
@@ -717,8 +874,11 @@ DEFUN (no_eigrp_if_bandwidth,
         break;
     }
 
-  for (ALL_LIST_ELEMENTS (eigrp->topology_table, node, nnode, pe))
+  for (rn = route_top (eigrp->topology_table); rn; rn = route_next (rn))
     {
+      if ((pe = rn->info) == NULL)
+        continue;
+
       for (ALL_LIST_ELEMENTS (pe->entries, node2, nnode2, ne))
         {
           /*TODO: */
@@ -728,6 +888,64 @@ DEFUN (no_eigrp_if_bandwidth,
   return CMD_SUCCESS;
 }
 
+DEFUN (eigrp_if_ip_bandwidth_percent,
+       eigrp_if_ip_bandwidth_percent_cmd,
+       "ip bandwidth-percent eigrp <1-999999>",
+       "Interface Internet Protocol config commands\n"
+       "Set EIGRP bandwidth limit\n"
+       "Enhanced Interior Gateway Routing Protocol (EIGRP)\n"
+       "Maximum bandwidth percentage that EIGRP may use\n")
+{
+  u_int32_t percent;
+  struct eigrp *eigrp;
+  struct interface *ifp;
+
+  eigrp = eigrp_lookup ();
+  if (eigrp == NULL)
+    {
+      vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  percent = atoi (argv[0]);
+
+  /* bandwidth-percent range is <1-999999> */
+  if ((percent < 1) || (percent > 999999))
+    {
+      vty_out (vty, "Bandwidth-percent value is invalid%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  ifp = vty->index;
+  IF_DEF_PARAMS (ifp)->bandwidth_percent = percent;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_eigrp_if_ip_bandwidth_percent,
+       no_eigrp_if_ip_bandwidth_percent_cmd,
+       "no ip bandwidth-percent eigrp",
+       NO_STR
+       "Interface Internet Protocol config commands\n"
+       "Set EIGRP bandwidth limit\n"
+       "Enhanced Interior Gateway Routing Protocol (EIGRP)\n")
+{
+  struct eigrp *eigrp;
+  struct interface *ifp;
+
+  eigrp = eigrp_lookup ();
+  if (eigrp == NULL)
+    {
+      vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  ifp = vty->index;
+  IF_DEF_PARAMS (ifp)->bandwidth_percent = EIGRP_BANDWIDTH_PERCENT_DEFAULT;
+
+  return CMD_SUCCESS;
+}
+
 DEFUN (eigrp_if_ip_hellointerval,
        eigrp_if_ip_hellointerval_cmd,
        "ip hello-interval eigrp <1-65535>",
@@ -823,6 +1041,23 @@ DEFUN (eigrp_if_ip_holdinterval,
   return CMD_SUCCESS;
 }
 
+/*
+ * Send pending summary changes and resync neighbors on interface,
+ * so they drop components hidden by summary (or learn them back)
+ */
+static void
+eigrp_summary_resync (struct eigrp *eigrp, struct interface *ifp)
+{
+  struct eigrp_interface *ei;
+  struct listnode *node;
+
+  eigrp_fsm_batch_flush (eigrp, NULL);
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    if (ei->ifp == ifp)
+      eigrp_update_send_interface_GR (ei, EIGRP_GR_FILTER, NULL);
+}
+
 DEFUN (eigrp_ip_summary_address,
        eigrp_ip_summary_address_cmd,
        "ip summary-address eigrp <1-65535> A.B.C.D/M",
@@ -835,6 +1070,7 @@ DEFUN (eigrp_ip_summary_address,
   u_int32_t AS;
   struct eigrp *eigrp;
   struct interface *ifp;
+  struct prefix_ipv4 p;
 
   eigrp = eigrp_lookup ();
   if (eigrp == NULL)
@@ -852,9 +1088,23 @@ DEFUN (eigrp_ip_summary_address,
       return CMD_WARNING;
     }
 
+  if (AS != eigrp->AS)
+    {
+      vty_out (vty, "AS number does not match EIGRP process%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  if (!str2prefix_ipv4 (argv[1], &p))
+    {
+      vty_out (vty, "Malformed summary address%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+  apply_mask_ipv4 (&p);
+
   ifp = vty->index;
 
-  /*TODO: */
+  if (eigrp_summary_set (eigrp, ifp, &p))
+    eigrp_summary_resync (eigrp, ifp);
 
   return CMD_SUCCESS;
 }
@@ -872,6 +1122,7 @@ DEFUN (no_eigrp_ip_summary_address,
   u_int32_t AS;
   struct eigrp *eigrp;
   struct interface *ifp;
+  struct prefix_ipv4 p;
 
   eigrp = eigrp_lookup ();
   if (eigrp == NULL)
@@ -889,9 +1140,23 @@ DEFUN (no_eigrp_ip_summary_address,
       return CMD_WARNING;
     }
 
+  if (AS != eigrp->AS)
+    {
+      vty_out (vty, "AS number does not match EIGRP process%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  if (!str2prefix_ipv4 (argv[1], &p))
+    {
+      vty_out (vty, "Malformed summary address%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+  apply_mask_ipv4 (&p);
+
   ifp = vty->index;
 
-  /*TODO: */
+  if (eigrp_summary_unset (eigrp, ifp, &p))
+    eigrp_summary_resync (eigrp, ifp);
 
   return CMD_SUCCESS;
 }
@@ -1076,6 +1341,26 @@ DEFUN (no_eigrp_authentication_keychain,
 }
 
 
+static void
+eigrp_routemap_set (struct eigrp *eigrp, int type, const char *name)
+{
+  if (eigrp->route_map[type].name)
+    free (eigrp->route_map[type].name);
+
+  eigrp->route_map[type].name = strdup (name);
+  eigrp->route_map[type].map = route_map_lookup_by_name (name);
+}
+
+static void
+eigrp_routemap_unset (struct eigrp *eigrp, int type)
+{
+  if (eigrp->route_map[type].name)
+    free (eigrp->route_map[type].name);
+
+  eigrp->route_map[type].name = NULL;
+  eigrp->route_map[type].map = NULL;
+}
+
 DEFUN (eigrp_redistribute_source_metric,
     eigrp_redistribute_source_metric_cmd,
        "redistribute " QUAGGA_REDIST_STR_EIGRPD
@@ -1091,18 +1376,82 @@ DEFUN (eigrp_redistribute_source_metric,
 {
   struct eigrp *eigrp = vty->index;
   struct eigrp_metrics metrics_from_command;
+  u_int64_t delay;
+  u_int32_t mtu;
   int source;
 
   /* Get distribute source. */
   source = proto_redistnum(AFI_IP, argv[0]);
-  if (source < 0 )
+  if (source < 0 || source == ZEBRA_ROUTE_EIGRP)
     return CMD_WARNING;
 
-  /* Get metrics values */
+  /* Get metrics values, interface defaults if not given */
+  memset (&metrics_from_command, 0, sizeof (metrics_from_command));
+  if (argc >= 6)
+    {
+      delay = (u_int64_t) strtoul (argv[2], NULL, 10) * 256;
+      metrics_from_command.bandwith =
+          eigrp_bandwidth_to_scaled (strtoul (argv[1], NULL, 10));
+      metrics_from_command.delay =
+          delay < EIGRP_MAX_METRIC ? (u_int32_t) delay : EIGRP_MAX_METRIC;
+      metrics_from_command.reliability = atoi (argv[3]);
+      metrics_from_command.load = atoi (argv[4]);
+      mtu = strtoul (argv[5], NULL, 10);
+      eigrp->route_map[source].metric_config = 1;
+    }
+  else
+    {
+      metrics_from_command.bandwith =
+          eigrp_bandwidth_to_scaled (EIGRP_BANDWIDTH_DEFAULT);
+      metrics_from_command.delay = eigrp_delay_to_scaled (EIGRP_DELAY_DEFAULT);
+      metrics_from_command.reliability = EIGRP_RELIABILITY_DEFAULT;
+      metrics_from_command.load = EIGRP_LOAD_DEFAULT;
+      mtu = 1500;
+      eigrp->route_map[source].metric_config = 0;
+    }
+  eigrp_metric_classic_to_wide (&metrics_from_command);
+  metrics_from_command.mtu[0] = mtu & 0xFF;
+  metrics_from_command.mtu[1] = (mtu >> 8) & 0xFF;
+  metrics_from_command.mtu[2] = (mtu >> 16) & 0xFF;
+
+  /* Route-map is always the last argument */
+  if (argc == 2 || argc == 7)
+    eigrp_routemap_set (eigrp, source, argv[argc - 1]);
+  else
+    eigrp_routemap_unset (eigrp, source);
 
   return eigrp_redistribute_set (eigrp, source, metrics_from_command);
 }
 
+ALIAS (eigrp_redistribute_source_metric,
+    eigrp_redistribute_source_cmd,
+       "redistribute " QUAGGA_REDIST_STR_EIGRPD,
+       REDIST_STR
+       QUAGGA_REDIST_HELP_STR_EIGRPD)
+
+ALIAS (eigrp_redistribute_source_metric,
+    eigrp_redistribute_source_routemap_cmd,
+       "redistribute " QUAGGA_REDIST_STR_EIGRPD " route-map WORD",
+       REDIST_STR
+       QUAGGA_REDIST_HELP_STR_EIGRPD
+       "Route map reference\n"
+       "Pointer to route-map entries\n")
+
+ALIAS (eigrp_redistribute_source_metric,
+    eigrp_redistribute_source_metric_routemap_cmd,
+       "redistribute " QUAGGA_REDIST_STR_EIGRPD
+         " metric <1-4294967295> <0-4294967295> <0-255> <1-255> <1-65535>"
+         " route-map WORD",
+       REDIST_STR
+       QUAGGA_REDIST_HELP_STR_EIGRPD
+       "Metric for redistributed routes\n"
+       "Bandwidth metric in Kbits per second\n"
+       "EIGRP delay metric, in 10 microsecond units\n"
+       "EIGRP reliability metric where 255 is 100% reliable2 ?\n"
+       "EIGRP Effective bandwidth metric (Loading) where 255 is 100% loaded\n"
+       "EIGRP MTU of the path\n"
+       "Route map reference\n"
+       "Pointer to route-map entries\n")
 
 DEFUN (no_eigrp_redistribute_source_metric,
     no_eigrp_redistribute_source_metric_cmd,
@@ -1119,19 +1468,26 @@ DEFUN (no_eigrp_redistribute_source_metric,
        "EIGRP MTU of the path\n")
 {
   struct eigrp *eigrp = vty->index;
-  struct eigrp_metrics metrics_from_command;
   int source;
 
   /* Get distribute source. */
   source = proto_redistnum(AFI_IP, argv[0]);
-  if (source < 0 )
+  if (source < 0 || source == ZEBRA_ROUTE_EIGRP)
     return CMD_WARNING;
 
-  /* Get metrics values */
+  eigrp_routemap_unset (eigrp, source);
+  eigrp->route_map[source].metric_config = 0;
 
   return eigrp_redistribute_unset (eigrp, source);
 }
 
+ALIAS (no_eigrp_redistribute_source_metric,
+    no_eigrp_redistribute_source_cmd,
+       "no redistribute " QUAGGA_REDIST_STR_EIGRPD,
+         "Disable\n"
+       REDIST_STR
+       QUAGGA_REDIST_HELP_STR_EIGRPD)
+
 DEFUN (eigrp_variance,
     eigrp_variance_cmd,
     "variance <1-128>",
@@ -1244,6 +1600,124 @@ DEFUN (no_eigrp_maximum_paths,
     return CMD_SUCCESS;
 }
 
+#define EIGRP_STUB_TYPE_STR \
+  "Do advertise connected routes\n" \
+  "Do advertise static routes\n" \
+  "Do advertise summary routes\n" \
+  "Do advertise redistributed routes\n"
+
+DEFUN (eigrp_stub,
+    eigrp_stub_cmd,
+    "eigrp stub",
+    "EIGRP specific commands\n"
+    "Set EIGRP as a stub router\n")
+{
+    struct eigrp *eigrp;
+    u_int16_t stub;
+    int i;
+
+    eigrp = eigrp_lookup ();
+    if (eigrp == NULL)
+      {
+        vty_out (vty, "EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+        return CMD_SUCCESS;
+      }
+
+    stub = (argc == 0) ? EIGRP_STUB_DEFAULT : 0;
+    for (i = 0; i < argc; i++)
+      {
+        if (strncmp (argv[i], "connected", strlen (argv[i])) == 0)
+          stub |= EIGRP_STUB_CONNECTED;
+        else if (strncmp (argv[i], "static", strlen (argv[i])) == 0)
+          stub |= EIGRP_STUB_STATIC;
+        else if (strncmp (argv[i], "summary", strlen (argv[i])) == 0)
+          stub |= EIGRP_STUB_SUMMARY;
+        else if (strncmp (argv[i], "redistributed", strlen (argv[i])) == 0)
+          stub |= EIGRP_STUB_REDISTRIBUTED;
+        else
+          stub |= EIGRP_STUB_RECEIVE_ONLY;
+      }
+
+    if (eigrp->stub == stub)
+      return CMD_SUCCESS;
+
+    eigrp->stub = stub;
+
+    /* neighbors learn stub flags from next Hello, routes we may not
+     * advertise any more are withdrawn by resync */
+    eigrp_update_send_process_GR (eigrp, EIGRP_GR_FILTER, NULL);
+
+    return CMD_SUCCESS;
+}
+
+ALIAS (eigrp_stub,
+    eigrp_stub_receive_only_cmd,
+    "eigrp stub receive-only",
+    "EIGRP specific commands\n"
+    "Set EIGRP as a stub router\n"
+    "Set receive only neighbor\n")
+
+ALIAS (eigrp_stub,
+    eigrp_stub_type_cmd,
+    "eigrp stub (connected|static|summary|redistributed)",
+    "EIGRP specific commands\n"
+    "Set EIGRP as a stub router\n"
+    EIGRP_STUB_TYPE_STR)
+
+ALIAS (eigrp_stub,
+    eigrp_stub_type2_cmd,
+    "eigrp stub (connected|static|summary|redistributed) (connected|static|summary|redistributed)",
+    "EIGRP specific commands\n"
+    "Set EIGRP as a stub router\n"
+    EIGRP_STUB_TYPE_STR
+    EIGRP_STUB_TYPE_STR)
+
+ALIAS (eigrp_stub,
+    eigrp_stub_type3_cmd,
+    "eigrp stub (connected|static|summary|redistributed) (connected|static|summary|redistributed) "
+    "(connected|static|summary|redistributed)",
+    "EIGRP specific commands\n"
+    "Set EIGRP as a stub router\n"
+    EIGRP_STUB_TYPE_STR
+    EIGRP_STUB_TYPE_STR
+    EIGRP_STUB_TYPE_STR)
+
+ALIAS (eigrp_stub,
+    eigrp_stub_type4_cmd,
+    "eigrp stub (connected|static|summary|redistributed) (connected|static|summary|redistributed) "
+    "(connected|static|summary|redistributed) (connected|static|summary|redistributed)",
+    "EIGRP specific commands\n"
+    "Set EIGRP as a stub router\n"
+    EIGRP_STUB_TYPE_STR
+    EIGRP_STUB_TYPE_STR
+    EIGRP_STUB_TYPE_STR
+    EIGRP_STUB_TYPE_STR)
+
+DEFUN (no_eigrp_stub,
+    no_eigrp_stub_cmd,
+    "no eigrp stub",
+    NO_STR
+    "EIGRP specific commands\n"
+    "Set EIGRP as a stub router\n")
+{
+    struct eigrp *eigrp;
+
+    eigrp = eigrp_lookup ();
+    if (eigrp == NULL)
+      {
+        vty_out (vty, "EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+        return CMD_SUCCESS;
+      }
+
+    if (eigrp->stub == 0)
+      return CMD_SUCCESS;
+
+    eigrp->stub = 0;
+    eigrp_update_send_process_GR (eigrp, EIGRP_GR_FILTER, NULL);
+
+    return CMD_SUCCESS;
+}
+
 /*
  * Execute hard restart for all neighbors
  */
@@ -1597,6 +2071,8 @@ eigrp_vty_if_init (void)
   /* Delay and bandwidth configuration commands*/
   install_element (INTERFACE_NODE, &eigrp_if_delay_cmd);
   install_element (INTERFACE_NODE, &eigrp_if_bandwidth_cmd);
+  install_element (INTERFACE_NODE, &eigrp_if_ip_bandwidth_percent_cmd);
+  install_element (INTERFACE_NODE, &no_eigrp_if_ip_bandwidth_percent_cmd);
 
   /*Hello-interval and hold-time interval configuration commands*/
   install_element (INTERFACE_NODE, &eigrp_if_ip_holdinterval_cmd);
@@ -1625,7 +2101,11 @@ static void
 eigrp_vty_zebra_init (void)
 {
   install_element (EIGRP_NODE, &eigrp_redistribute_source_metric_cmd);
+  install_element (EIGRP_NODE, &eigrp_redistribute_source_cmd);
+  install_element (EIGRP_NODE, &eigrp_redistribute_source_routemap_cmd);
+  install_element (EIGRP_NODE, &eigrp_redistribute_source_metric_routemap_cmd);
   install_element (EIGRP_NODE, &no_eigrp_redistribute_source_metric_cmd);
+  install_element (EIGRP_NODE, &no_eigrp_redistribute_source_cmd);
 
 }
 
@@ -1651,8 +2131,17 @@ eigrp_vty_init (void)
   install_element (EIGRP_NODE, &no_eigrp_timers_active_cmd);
   install_element (EIGRP_NODE, &eigrp_metric_weights_cmd);
   install_element (EIGRP_NODE, &no_eigrp_metric_weights_cmd);
+  install_element (EIGRP_NODE, &eigrp_metric_version_cmd);
+  install_element (EIGRP_NODE, &no_eigrp_metric_version_cmd);
   install_element (EIGRP_NODE, &eigrp_maximum_paths_cmd);
   install_element (EIGRP_NODE, &no_eigrp_maximum_paths_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_receive_only_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_type_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_type2_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_type3_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_type4_cmd);
+  install_element (EIGRP_NODE, &no_eigrp_stub_cmd);
   install_element (EIGRP_NODE, &eigrp_neighbor_cmd);
   install_element (EIGRP_NODE, &no_eigrp_neighbor_cmd);
 
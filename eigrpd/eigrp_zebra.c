@@ -52,6 +52,7 @@
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_external.h"
 
 static int eigrp_interface_add (int , struct zclient *, zebra_size_t);
 static int eigrp_interface_delete (int , struct zclient *,
@@ -124,7 +125,6 @@ eigrp_zebra_read_ipv4 (int command, struct zclient *zclient,
   unsigned long ifindex;
   struct in_addr nexthop;
   struct prefix_ipv4 p;
-  struct TLV_IPv4_External_type *external_tlv;
   struct eigrp *eigrp;
 
   s = zclient->ibuf;
@@ -166,13 +166,25 @@ eigrp_zebra_read_ipv4 (int command, struct zclient *zclient,
   if (eigrp == NULL)
     return 0;
 
+  if (api.type == ZEBRA_ROUTE_EIGRP)
+    return 0;
+
+  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+    zlog_debug ("Zebra: Redistribute %s %s %s/%d",
+                command == ZEBRA_IPV4_ROUTE_ADD ? "add" : "delete",
+                zebra_route_string (api.type),
+                inet_ntoa (p.prefix), p.prefixlen);
+
+  /* routes are only recorded here, origination is batched */
   if (command == ZEBRA_IPV4_ROUTE_ADD)
     {
-
+      eigrp_external_add (eigrp, api.type, &p, nexthop, ifindex,
+                          CHECK_FLAG (api.message, ZAPI_MESSAGE_METRIC) ?
+                          api.metric : 0);
     }
   else                          /* if (command == ZEBRA_IPV4_ROUTE_DELETE) */
     {
-
+      eigrp_external_delete (eigrp, api.type, &p);
     }
 
   return 0;
@@ -398,13 +410,19 @@ zebra_interface_if_lookup (struct stream *s)
                                strnlen (ifname_tmp, INTERFACE_NAMSIZ));
 }
 
+/*
+ * Install all paths to the prefix as one multipath route, zebra replaces
+ * previously installed route of the same type and prefix.
+ */
 void
-eigrp_zebra_route_add (struct prefix_ipv4 *p, struct eigrp_neighbor_entry *te)
+eigrp_zebra_route_add (struct prefix_ipv4 *p, struct list *paths)
 {
   u_char message;
   u_char flags;
   int psize;
   struct stream *s;
+  struct listnode *node;
+  struct eigrp_neighbor_entry *te;
 
   if (zclient->redist[ZEBRA_ROUTE_EIGRP])
     {
@@ -437,23 +455,28 @@ eigrp_zebra_route_add (struct prefix_ipv4 *p, struct eigrp_neighbor_entry *te)
       stream_write (s, (u_char *) & p->prefix, psize);
 
       /* Nexthop count. */
-      stream_putc (s, 1);
+      stream_putc (s, listcount (paths));
 
       /* Nexthop, ifindex, distance and metric information. */
-      stream_putc (s, ZEBRA_NEXTHOP_IPV4_IFINDEX);
-      stream_put_in_addr (s, &te->adv_router->src);
-      stream_putl (s, te->ei->ifp->ifindex);
-
-      if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+      for (ALL_LIST_ELEMENTS_RO (paths, node, te))
         {
-          char buf[2][INET_ADDRSTRLEN];
-          zlog_debug ("Zebra: Route add %s/%d nexthop %s",
-		      inet_ntop(AF_INET, &p->prefix, buf[0], sizeof (buf[0])),
-		      p->prefixlen,
-		      inet_ntop(AF_INET, 0 /*&p->nexthop*/, buf[1], sizeof (buf[1])));
+          stream_putc (s, ZEBRA_NEXTHOP_IPV4_IFINDEX);
+          stream_put_in_addr (s, &te->adv_router->src);
+          stream_putl (s, te->ei->ifp->ifindex);
+
+          if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+            {
+              char buf[2][INET_ADDRSTRLEN];
+              zlog_debug ("Zebra: Route add %s/%d nexthop %s",
+                          inet_ntop (AF_INET, &p->prefix, buf[0], sizeof (buf[0])),
+                          p->prefixlen,
+                          inet_ntop (AF_INET, &te->adv_router->src, buf[1], sizeof (buf[1])));
+            }
         }
 
-      stream_putl (s, te->distance);
+      /* paths are in distance order, first one is the best */
+      te = listgetdata (listhead (paths));
+      stream_putl (s, eigrp_rib_metric (eigrp_lookup (), te->distance));
       stream_putw_at (s, 0, stream_get_endp (s));
 
       zclient_send_message (zclient);
@@ -461,7 +484,7 @@ eigrp_zebra_route_add (struct prefix_ipv4 *p, struct eigrp_neighbor_entry *te)
 }
 
 void
-eigrp_zebra_route_delete (struct prefix_ipv4 *p, struct eigrp_neighbor_entry *te)
+eigrp_zebra_route_delete (struct prefix_ipv4 *p)
 {
   u_char message;
   u_char flags;
@@ -488,29 +511,70 @@ eigrp_zebra_route_delete (struct prefix_ipv4 *p, struct eigrp_neighbor_entry *te
       stream_putc (s, p->prefixlen);
       stream_write (s, (u_char *) & p->prefix, psize);
 
-      /* Nexthop count. */
-      stream_putc (s, 1);
-
-      /* Nexthop, ifindex, distance and metric information. */
-      stream_putc (s, ZEBRA_NEXTHOP_IPV4_IFINDEX);
-      stream_put_in_addr (s, &te->adv_router->src);
-      stream_putl (s, te->ei->ifp->ifindex);
-
       if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
         {
-          char buf[2][INET_ADDRSTRLEN];
-          zlog_debug ("Zebra: Route del %s/%d nexthop %s",
-		      inet_ntop (AF_INET, &p->prefix,  buf[0], sizeof (buf[0])),
-		      p->prefixlen,
-		      inet_ntop (AF_INET, 0 /*&p->nexthop*/, buf[1], sizeof (buf[1])));
+          char buf[INET_ADDRSTRLEN];
+          zlog_debug ("Zebra: Route del %s/%d",
+		      inet_ntop (AF_INET, &p->prefix, buf, sizeof (buf)),
+		      p->prefixlen);
         }
 
+      stream_putw_at (s, 0, stream_get_endp (s));
+
+      zclient_send_message (zclient);
+    }
+}
+
+/*
+ * Summary address discard route, it catches traffic to parts of summary
+ * which are not reachable, instead of following less specific route
+ */
+void
+eigrp_zebra_summary_add (struct prefix_ipv4 *p)
+{
+  u_char message;
+  u_char flags;
+  int psize;
+  struct stream *s;
 
-      if (CHECK_FLAG (message, ZAPI_MESSAGE_METRIC))
+  if (zclient->redist[ZEBRA_ROUTE_EIGRP])
+    {
+      message = 0;
+      flags = 0;
+
+      SET_FLAG (flags, ZEBRA_FLAG_BLACKHOLE);
+      SET_FLAG (message, ZAPI_MESSAGE_NEXTHOP);
+      SET_FLAG (message, ZAPI_MESSAGE_DISTANCE);
+
+      /* Make packet. */
+      s = zclient->obuf;
+      stream_reset (s);
+
+      /* Put command, type, flags, message. */
+      zclient_create_header (s, ZEBRA_IPV4_ROUTE_ADD);
+      stream_putc (s, ZEBRA_ROUTE_EIGRP);
+      stream_putc (s, flags);
+      stream_putc (s, message);
+      stream_putw (s, SAFI_UNICAST);
+
+      /* Put prefix information. */
+      psize = PSIZE (p->prefixlen);
+      stream_putc (s, p->prefixlen);
+      stream_write (s, (u_char *) & p->prefix, psize);
+
+      /* Nexthop count and Null0 nexthop. */
+      stream_putc (s, 1);
+      stream_putc (s, ZEBRA_NEXTHOP_BLACKHOLE);
+
+      if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
         {
-          stream_putl (s, te->distance);
+          char buf[INET_ADDRSTRLEN];
+          zlog_debug ("Zebra: Summary add %s/%d nexthop Null0",
+		      inet_ntop(AF_INET, &p->prefix, buf, sizeof (buf)),
+		      p->prefixlen);
         }
 
+      stream_putc (s, EIGRP_SUMMARY_DISTANCE);
       stream_putw_at (s, 0, stream_get_endp (s));
 
       zclient_send_message (zclient);
@@ -530,11 +594,12 @@ eigrp_redistribute_set (struct eigrp *eigrp, int type, struct eigrp_metrics metr
 
   if (eigrp_is_type_redistributed (type))
     {
-      if (eigrp_metrics_is_same(&metric, &eigrp->dmetric[type]))
+      if (!eigrp_metrics_is_same(&metric, &eigrp->dmetric[type]))
         {
           eigrp->dmetric[type] = metric;
         }
 
+      /* metric or route-map may have changed */
       eigrp_external_routes_refresh (eigrp, type);
 
 //      if (IS_DEBUG_EIGRP(zebra, ZEBRA_REDISTRIBUTE))
@@ -567,6 +632,9 @@ eigrp_redistribute_unset (struct eigrp *eigrp, int type)
       memset(&eigrp->dmetric[type], 0, sizeof(struct eigrp_metrics));
       zclient_redistribute (ZEBRA_REDISTRIBUTE_DELETE, zclient, type);
       --eigrp->redistribute;
+
+      /* zebra doesn't withdraw routes, drop them ourselves */
+      eigrp_external_routes_refresh (eigrp, type);
     }
 
 //  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
@@ -43,6 +43,7 @@
 #include "plist.h"
 #include "sockopt.h"
 #include "keychain.h"
+#include "hash.h"
 
 #include "eigrpd/eigrp_structs.h"
 #include "eigrpd/eigrpd.h"
@@ -53,6 +54,9 @@
 #include "eigrpd/eigrp_packet.h"
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_external.h"
+#include "eigrpd/eigrp_sia.h"
 
 
 static struct eigrp_master eigrp_master;
@@ -97,6 +101,7 @@ eigrp_router_id_update (struct eigrp *eigrp)
   struct interface *ifp;
   struct listnode *node;
   u_int32_t router_id, router_id_old;
+  int type;
 
   router_id_old = eigrp->router_id;
 
@@ -118,6 +123,10 @@ eigrp_router_id_update (struct eigrp *eigrp)
       /* update eigrp_interface's */
       for (ALL_LIST_ELEMENTS_RO(eigrp_om->iflist, node, ifp))
         eigrp_if_update(ifp);
+
+      /* redistributed routes carry router-id as their originator */
+      for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+        eigrp_external_routes_refresh(eigrp, type);
     }
 }
 
@@ -129,7 +138,18 @@ eigrp_master_init ()
   eigrp_om = &eigrp_master;
   eigrp_om->eigrp = list_new();
   eigrp_om->master = thread_master_create();
+  /* hold, hello and retransmit timers are re-armed per neighbor constantly */
+  thread_master_set_timer_backend(eigrp_om->master, THREAD_TIMER_WHEEL);
   eigrp_om->start_time = quagga_time(NULL);
+
+  eigrp_om->prefix_pool = mem_pool_new(MTYPE_EIGRP_PREFIX_ENTRY,
+      sizeof(struct eigrp_prefix_entry), EIGRP_POOL_SLAB_OBJECTS);
+  eigrp_om->entry_pool = mem_pool_new(MTYPE_EIGRP_NEIGHBOR_ENTRY,
+      sizeof(struct eigrp_neighbor_entry), EIGRP_POOL_SLAB_OBJECTS);
+  eigrp_om->int_tlv_pool = mem_pool_new(MTYPE_EIGRP_IPV4_INT_TLV,
+      sizeof(struct TLV_IPv4_Internal_type), EIGRP_POOL_SLAB_OBJECTS);
+  eigrp_om->ext_tlv_pool = mem_pool_new(MTYPE_EIGRP_IPV4_EXT_TLV,
+      sizeof(struct TLV_IPv4_External_type), EIGRP_POOL_SLAB_OBJECTS);
 }
 
 
@@ -139,6 +159,7 @@ eigrp_new (const char *AS)
 {
   struct eigrp *new = XCALLOC(MTYPE_EIGRP_TOP, sizeof (struct eigrp));
   int eigrp_socket;
+  int i;
 
   /* init information relevant to peers */
   new->vrid = 0;
@@ -154,9 +175,11 @@ eigrp_new (const char *AS)
   new->k_values[3] = EIGRP_K4_DEFAULT;
   new->k_values[4] = EIGRP_K5_DEFAULT;
   new->k_values[5] = EIGRP_K6_DEFAULT;
+  eigrp_metric_kernel_update(new);
 
   /* init internal data structures */
   new->eiflist = list_new();
+  new->nbrs_hash = eigrp_nbr_hash_new();
   new->passive_interface_default = EIGRP_IF_ACTIVE;
   new->networks = route_table_init();
 
@@ -170,28 +193,36 @@ eigrp_new (const char *AS)
   new->fd = eigrp_socket;
   new->maxsndbuflen = getsockopt_so_sendbuf(new->fd);
 
-  if ((new->ibuf = stream_new(EIGRP_PACKET_MAX_LEN+1)) == NULL)
-    {
-      zlog_err("eigrp_new: fatal error: stream_new (%u) failed allocating ibuf",
-               EIGRP_PACKET_MAX_LEN+1);
-      exit(1);
-    }
+  for (i = 0; i < EIGRP_READ_BATCH; i++)
+    if ((new->ibuf[i] = stream_new(EIGRP_PACKET_MAX_LEN+1)) == NULL)
+      {
+        zlog_err("eigrp_new: fatal error: stream_new (%u) failed allocating ibuf",
+                 EIGRP_PACKET_MAX_LEN+1);
+        exit(1);
+      }
 
   new->t_read = thread_add_read(master, eigrp_read, new, new->fd);
   new->oi_write_q = list_new();
 
   new->topology_table = eigrp_topology_new();
+  new->pkt_arena = mem_arena_new(MTYPE_EIGRP_PACKET_ARENA,
+      EIGRP_PACKET_ARENA_SIZE);
+  new->summaries = route_table_init();
+  new->externals = route_table_init();
+  new->externals_queue = list_new();
 
   new->neighbor_self = eigrp_nbr_new(NULL);
   inet_aton("127.0.0.1", &new->neighbor_self->src);
 
   new->variance = EIGRP_VARIANCE_DEFAULT;
   new->max_paths = EIGRP_MAX_PATHS_DEFAULT;
+  eigrp_sia_init(new);
 
   new->serno = 0;
   new->serno_last_update = 0;
   new->topology_changes_externalIPV4 = list_new ();
   new->topology_changes_internalIPV4 = list_new ();
+  new->topology_changes_rib = list_new ();
 
   new->list[EIGRP_FILTER_IN] = NULL;
   new->list[EIGRP_FILTER_OUT] = NULL;
@@ -271,9 +302,13 @@ eigrp_finish (struct eigrp *eigrp)
 static void
 eigrp_finish_final (struct eigrp *eigrp)
 {
+  int i;
 
   close(eigrp->fd);
 
+  for (i = 0; i < EIGRP_READ_BATCH; i++)
+    stream_free(eigrp->ibuf[i]);
+
   if (zclient)
     zclient_free(zclient);
 
@@ -281,11 +316,17 @@ eigrp_finish_final (struct eigrp *eigrp)
   list_delete(eigrp->oi_write_q);
   list_delete(eigrp->topology_changes_externalIPV4);
   list_delete(eigrp->topology_changes_internalIPV4);
+  list_delete(eigrp->topology_changes_rib);
 
+  eigrp_summary_free_all(eigrp);
+  eigrp_external_free_all(eigrp);
   eigrp_topology_cleanup(eigrp->topology_table);
   eigrp_topology_free(eigrp->topology_table);
 
   eigrp_nbr_delete(eigrp->neighbor_self);
+  hash_free(eigrp->nbrs_hash);
+  eigrp_sia_finish(eigrp);
+  mem_arena_delete(eigrp->pkt_arena);
 
   eigrp_delete(eigrp);
 
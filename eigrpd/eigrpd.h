@@ -34,9 +34,11 @@
 #include "filter.h"
 #include "log.h"
 
-/* Set EIGRP version is "classic" - wide metrics comes next */
+/* Set EIGRP version is "classic" - wide metrics announce 2.0 */
 #define EIGRP_MAJOR_VERSION     1
 #define EIGRP_MINOR_VERSION	2
+#define EIGRP_WIDE_MAJOR_VERSION	2
+#define EIGRP_WIDE_MINOR_VERSION	0
 
 /* Extern variables. */
 extern struct zclient *zclient;
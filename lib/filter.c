@@ -27,6 +27,9 @@
 #include "command.h"
 #include "sockunion.h"
 #include "buffer.h"
+#include "table.h"
+#include "hash.h"
+#include "jhash.h"
 #include "log.h"
 
 struct filter_cisco
@@ -66,6 +69,26 @@ struct filter
       struct filter_cisco cfilter;
       struct filter_zebra zfilter;
     } u;
+
+  /* Position in access list, first match is the lowest one. */
+  unsigned int order;
+
+  /* Next filter of the same trie node or tuple key, by order. */
+  struct filter *match_next;
+};
+
+/* Cisco filters sharing wildcard masks.  Masked address and mask of a
+   prefix are a key which finds all filters of tuple it matches. */
+struct filter_tuple
+{
+  struct filter_tuple *next;
+
+  int extended;
+  struct in_addr addr_mask;
+  struct in_addr mask_mask;
+
+  /* Filters by addr and mask, chained by order. */
+  struct hash *filters;
 };
 
 /* List of access_list. */
@@ -158,33 +181,6 @@ filter_type_str (struct filter *filter)
     }
 }
 
-/* If filter match to the prefix then return 1. */
-static int
-filter_match_cisco (struct filter *mfilter, struct prefix *p)
-{
-  struct filter_cisco *filter;
-  struct in_addr mask;
-  u_int32_t check_addr;
-  u_int32_t check_mask;
-
-  filter = &mfilter->u.cfilter;
-  check_addr = p->u.prefix4.s_addr & ~filter->addr_mask.s_addr;
-
-  if (filter->extended)
-    {
-      masklen2ip (p->prefixlen, &mask);
-      check_mask = mask.s_addr & ~filter->mask_mask.s_addr;
-
-      if (memcmp (&check_addr, &filter->addr.s_addr, 4) == 0
-          && memcmp (&check_mask, &filter->mask.s_addr, 4) == 0)
-	return 1;
-    }
-  else if (memcmp (&check_addr, &filter->addr.s_addr, 4) == 0)
-    return 1;
-
-  return 0;
-}
-
 /* If filter match to the prefix then return 1. */
 static int
 filter_match_zebra (struct filter *mfilter, struct prefix *p)
@@ -213,17 +209,236 @@ filter_match_zebra (struct filter *mfilter, struct prefix *p)
 static struct access_list *
 access_list_new (void)
 {
-  return (struct access_list *) XCALLOC (MTYPE_ACCESS_LIST,
-					 sizeof (struct access_list));
+  struct access_list *access;
+
+  access = XCALLOC (MTYPE_ACCESS_LIST, sizeof (struct access_list));
+  access->trie_ipv4 = route_table_init ();
+#ifdef HAVE_IPV6
+  access->trie_ipv6 = route_table_init ();
+#endif /* HAVE_IPV6 */
+  return access;
 }
 
 /* Free allocated access_list. */
 static void
 access_list_free (struct access_list *access)
 {
+  struct filter_tuple *tuple;
+  struct filter_tuple *next;
+
+  route_table_finish (access->trie_ipv4);
+#ifdef HAVE_IPV6
+  route_table_finish (access->trie_ipv6);
+#endif /* HAVE_IPV6 */
+
+  for (tuple = access->tuples; tuple; tuple = next)
+    {
+      next = tuple->next;
+      hash_clean (tuple->filters, NULL);
+      hash_free (tuple->filters);
+      XFREE (MTYPE_ACCESS_FILTER_TUPLE, tuple);
+    }
+
   XFREE (MTYPE_ACCESS_LIST, access);
 }
 
+static unsigned int
+filter_cisco_hash_key (void *arg)
+{
+  struct filter_cisco *filter = &((struct filter *) arg)->u.cfilter;
+
+  return jhash_2words (filter->addr.s_addr, filter->mask.s_addr, 0);
+}
+
+static int
+filter_cisco_hash_cmp (const void *arg1, const void *arg2)
+{
+  const struct filter_cisco *f1 = &((const struct filter *) arg1)->u.cfilter;
+  const struct filter_cisco *f2 = &((const struct filter *) arg2)->u.cfilter;
+
+  return (f1->addr.s_addr == f2->addr.s_addr
+	  && f1->mask.s_addr == f2->mask.s_addr);
+}
+
+/* Tuple of cisco filter, NULL if there is none and create is not set. */
+static struct filter_tuple *
+filter_tuple_get (struct access_list *access, struct filter *mfilter,
+		  int create)
+{
+  struct filter_cisco *filter = &mfilter->u.cfilter;
+  struct filter_tuple *tuple;
+
+  for (tuple = access->tuples; tuple; tuple = tuple->next)
+    if (tuple->extended == filter->extended
+	&& tuple->addr_mask.s_addr == filter->addr_mask.s_addr
+	&& tuple->mask_mask.s_addr == filter->mask_mask.s_addr)
+      return tuple;
+
+  if (! create)
+    return NULL;
+
+  tuple = XCALLOC (MTYPE_ACCESS_FILTER_TUPLE, sizeof (struct filter_tuple));
+  tuple->extended = filter->extended;
+  tuple->addr_mask = filter->addr_mask;
+  tuple->mask_mask = filter->mask_mask;
+  tuple->filters = hash_create (filter_cisco_hash_key, filter_cisco_hash_cmp);
+  tuple->next = access->tuples;
+  access->tuples = tuple;
+  return tuple;
+}
+
+static struct route_table *
+filter_zebra_trie (struct access_list *access, u_char family)
+{
+  if (family == AF_INET)
+    return access->trie_ipv4;
+#ifdef HAVE_IPV6
+  if (family == AF_INET6)
+    return access->trie_ipv6;
+#endif /* HAVE_IPV6 */
+  return NULL;
+}
+
+/* First filter of trie node of zebra filter's prefix. */
+static struct filter *
+filter_zebra_trie_lookup (struct access_list *access, struct filter *mfilter)
+{
+  struct filter *first = NULL;
+  struct route_table *trie;
+  struct route_node *rn;
+  struct prefix p;
+
+  trie = filter_zebra_trie (access, mfilter->u.zfilter.prefix.family);
+  if (trie == NULL)
+    return NULL;
+
+  prefix_copy (&p, &mfilter->u.zfilter.prefix);
+  apply_mask (&p);
+  rn = route_node_lookup (trie, &p);
+  if (rn)
+    {
+      first = rn->info;
+      route_unlock_node (rn);
+    }
+  return first;
+}
+
+/* Index filter just appended to access list. */
+static void
+access_list_index_add (struct access_list *access, struct filter *mfilter)
+{
+  struct filter_tuple *tuple;
+  struct route_table *trie;
+  struct route_node *rn;
+  struct filter *first;
+  struct filter **fp;
+  struct prefix p;
+
+  mfilter->order = ++access->order;
+  mfilter->match_next = NULL;
+
+  if (mfilter->cisco)
+    {
+      tuple = filter_tuple_get (access, mfilter, 1);
+      first = hash_get (tuple->filters, mfilter, hash_alloc_intern);
+      if (first == mfilter)
+	return;
+      fp = &first->match_next;
+    }
+  else
+    {
+      trie = filter_zebra_trie (access, mfilter->u.zfilter.prefix.family);
+      if (trie == NULL)
+	return;
+
+      prefix_copy (&p, &mfilter->u.zfilter.prefix);
+      apply_mask (&p);
+      rn = route_node_get (trie, &p);
+
+      /* node is locked once for all its filters */
+      if (rn->info)
+	route_unlock_node (rn);
+      fp = (struct filter **) &rn->info;
+    }
+
+  /* last one added has highest order */
+  while (*fp)
+    fp = &(*fp)->match_next;
+  *fp = mfilter;
+}
+
+static void
+access_list_index_delete (struct access_list *access, struct filter *mfilter)
+{
+  struct filter_tuple *tuple;
+  struct filter_tuple **tp;
+  struct route_table *trie;
+  struct route_node *rn;
+  struct filter *first;
+  struct filter **fp;
+  struct prefix p;
+
+  if (mfilter->cisco)
+    {
+      tuple = filter_tuple_get (access, mfilter, 0);
+      if (tuple == NULL)
+	return;
+
+      first = hash_lookup (tuple->filters, mfilter);
+      if (first == mfilter)
+	{
+	  hash_release (tuple->filters, mfilter);
+	  if (mfilter->match_next)
+	    hash_get (tuple->filters, mfilter->match_next, hash_alloc_intern);
+	}
+      else if (first)
+	{
+	  for (fp = &first->match_next; *fp; fp = &(*fp)->match_next)
+	    if (*fp == mfilter)
+	      {
+		*fp = mfilter->match_next;
+		break;
+	      }
+	}
+
+      if (tuple->filters->count == 0)
+	{
+	  for (tp = &access->tuples; *tp; tp = &(*tp)->next)
+	    if (*tp == tuple)
+	      {
+		*tp = tuple->next;
+		break;
+	      }
+	  hash_free (tuple->filters);
+	  XFREE (MTYPE_ACCESS_FILTER_TUPLE, tuple);
+	}
+    }
+  else
+    {
+      trie = filter_zebra_trie (access, mfilter->u.zfilter.prefix.family);
+      if (trie == NULL)
+	return;
+
+      prefix_copy (&p, &mfilter->u.zfilter.prefix);
+      apply_mask (&p);
+      rn = route_node_lookup (trie, &p);
+      if (rn == NULL)
+	return;
+
+      for (fp = (struct filter **) &rn->info; *fp; fp = &(*fp)->match_next)
+	if (*fp == mfilter)
+	  {
+	    *fp = mfilter->match_next;
+	    break;
+	  }
+
+      route_unlock_node (rn);
+      if (rn->info == NULL)
+	route_unlock_node (rn);
+    }
+  mfilter->match_next = NULL;
+}
+
 /* Delete access_list from access_master and free it. */
 static void
 access_list_delete (struct access_list *access)
@@ -400,6 +615,12 @@ enum filter_type
 access_list_apply (struct access_list *access, void *object)
 {
   struct filter *filter;
+  struct filter *match = NULL;
+  struct filter key;
+  struct filter_tuple *tuple;
+  struct route_table *trie;
+  struct route_node *node;
+  struct in_addr mask;
   struct prefix *p;
 
   p = (struct prefix *) object;
@@ -407,20 +628,48 @@ access_list_apply (struct access_list *access, void *object)
   if (access == NULL)
     return FILTER_DENY;
 
-  for (filter = access->head; filter; filter = filter->next)
+  /* Zebra filters which can match are those on the path to p in the
+     trie. */
+  trie = filter_zebra_trie (access, p->family);
+  node = trie ? trie->top : NULL;
+  while (node && node->p.prefixlen <= p->prefixlen
+	 && prefix_match (&node->p, p))
     {
-      if (filter->cisco)
-	{
-	  if (filter_match_cisco (filter, p))
-	    return filter->type;
-	}
-      else
+      for (filter = node->info; filter; filter = filter->match_next)
 	{
+	  if (match && filter->order > match->order)
+	    break;
 	  if (filter_match_zebra (filter, p))
-	    return filter->type;
+	    {
+	      match = filter;
+	      break;
+	    }
 	}
+
+      if (node->p.prefixlen == p->prefixlen)
+	break;
+      node = node->link[prefix_bit (&p->u.prefix, node->p.prefixlen)];
     }
 
+  /* Each tuple of cisco filters has at most one key p can match. */
+  memset (&key, 0, sizeof (struct filter));
+  masklen2ip (p->prefixlen, &mask);
+  for (tuple = access->tuples; tuple; tuple = tuple->next)
+    {
+      key.u.cfilter.addr.s_addr = p->u.prefix4.s_addr
+				  & ~tuple->addr_mask.s_addr;
+      key.u.cfilter.mask.s_addr = 0;
+      if (tuple->extended)
+	key.u.cfilter.mask.s_addr = mask.s_addr & ~tuple->mask_mask.s_addr;
+
+      filter = hash_lookup (tuple->filters, &key);
+      if (filter && (match == NULL || filter->order < match->order))
+	match = filter;
+    }
+
+  if (match)
+    return match->type;
+
   return FILTER_DENY;
 }
 
@@ -457,6 +706,8 @@ access_list_filter_add (struct access_list *access, struct filter *filter)
     access->head = filter;
   access->tail = filter;
 
+  access_list_index_add (access, filter);
+
   /* Run hook function. */
   if (access->master->add_hook)
     (*access->master->add_hook) (access);
@@ -481,6 +732,8 @@ access_list_filter_delete (struct access_list *access, struct filter *filter)
 
   master = access->master;
 
+  access_list_index_delete (access, filter);
+
   if (filter->next)
     filter->next->prev = filter->prev;
   else
@@ -517,33 +770,17 @@ access_list_filter_delete (struct access_list *access, struct filter *filter)
 static struct filter *
 filter_lookup_cisco (struct access_list *access, struct filter *mnew)
 {
+  struct filter_tuple *tuple;
   struct filter *mfilter;
-  struct filter_cisco *filter;
-  struct filter_cisco *new;
 
-  new = &mnew->u.cfilter;
-
-  for (mfilter = access->head; mfilter; mfilter = mfilter->next)
-    {
-      filter = &mfilter->u.cfilter;
+  tuple = filter_tuple_get (access, mnew, 0);
+  if (tuple == NULL)
+    return NULL;
 
-      if (filter->extended)
-	{
-	  if (mfilter->type == mnew->type
-	      && filter->addr.s_addr == new->addr.s_addr
-	      && filter->addr_mask.s_addr == new->addr_mask.s_addr
-	      && filter->mask.s_addr == new->mask.s_addr
-	      && filter->mask_mask.s_addr == new->mask_mask.s_addr)
-	    return mfilter;
-	}
-      else
-	{
-	  if (mfilter->type == mnew->type
-	      && filter->addr.s_addr == new->addr.s_addr
-	      && filter->addr_mask.s_addr == new->addr_mask.s_addr)
-	    return mfilter;
-	}
-    }
+  for (mfilter = hash_lookup (tuple->filters, mnew); mfilter;
+       mfilter = mfilter->match_next)
+    if (mfilter->type == mnew->type)
+      return mfilter;
 
   return NULL;
 }
@@ -557,7 +794,8 @@ filter_lookup_zebra (struct access_list *access, struct filter *mnew)
 
   new = &mnew->u.zfilter;
 
-  for (mfilter = access->head; mfilter; mfilter = mfilter->next)
+  for (mfilter = filter_zebra_trie_lookup (access, mnew); mfilter;
+       mfilter = mfilter->match_next)
     {
       filter = &mfilter->u.zfilter;
 
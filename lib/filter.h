@@ -39,6 +39,9 @@ enum access_type
   ACCESS_TYPE_NUMBER
 };
 
+struct route_table;
+struct filter_tuple;
+
 /* Access list */
 struct access_list
 {
@@ -54,6 +57,15 @@ struct access_list
 
   struct filter *head;
   struct filter *tail;
+
+  /* Filters indexed for matching, zebra filters by prefix and cisco
+     filters by their wildcard masks. */
+  struct route_table *trie_ipv4;
+  struct route_table *trie_ipv6;
+  struct filter_tuple *tuples;
+
+  /* Order given to last filter added. */
+  unsigned int order;
 };
 
 /* Prototypes for access-list. */
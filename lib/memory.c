@@ -151,6 +151,176 @@ zstrdup (int type, const char *str)
   return dup;
 }
 
+/* Alignment of pool objects and arena allocations, same as malloc gives
+ * for the types daemons keep in them. */
+#define MEM_ALIGN	(2 * sizeof (void *))
+#define MEM_ALIGNED(S)	(((S) + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1))
+
+/*
+ * Create pool of objects of given size, accounted to given type.
+ * Slabs of per_slab objects are allocated as pool runs out of them.
+ */
+struct mem_pool *
+mem_pool_new (int type, size_t size, unsigned int per_slab)
+{
+  struct mem_pool *pool;
+
+  pool = XCALLOC (MTYPE_MEM_POOL, sizeof (struct mem_pool));
+  pool->type = type;
+  pool->size = MEM_ALIGNED (size < sizeof (void *) ? sizeof (void *) : size);
+  pool->per_slab = per_slab ? per_slab : 1;
+
+  return pool;
+}
+
+/*
+ * Get zeroed object from pool.  Effects: Returns a pointer to usable
+ * memory, or aborts as zcalloc does.
+ */
+void *
+mem_pool_alloc (struct mem_pool *pool)
+{
+  void *obj;
+
+  if (pool->free == NULL)
+    {
+      char *slab, *p;
+      unsigned int i;
+
+      /* first aligned word of slab links it to the others */
+      slab = XMALLOC (MTYPE_MEM_POOL_SLAB,
+		      MEM_ALIGN + pool->size * pool->per_slab);
+      *(void **) slab = pool->slabs;
+      pool->slabs = slab;
+
+      for (i = 0, p = slab + MEM_ALIGN; i < pool->per_slab; i++, p += pool->size)
+	{
+	  *(void **) p = pool->free;
+	  pool->free = p;
+	}
+    }
+
+  obj = pool->free;
+  pool->free = *(void **) obj;
+  memset (obj, 0, pool->size);
+  alloc_inc (pool->type);
+
+  return obj;
+}
+
+/*
+ * Return object to pool it was taken from.  Memory is kept for
+ * next mem_pool_alloc, it goes back to system with mem_pool_delete.
+ */
+void
+mem_pool_free (struct mem_pool *pool, void *obj)
+{
+  if (obj == NULL)
+    return;
+
+  *(void **) obj = pool->free;
+  pool->free = obj;
+  alloc_dec (pool->type);
+}
+
+/*
+ * Release pool with all its slabs.  Objects still in use are gone too.
+ */
+void
+mem_pool_delete (struct mem_pool *pool)
+{
+  void *slab;
+
+  while ((slab = pool->slabs) != NULL)
+    {
+      pool->slabs = *(void **) slab;
+      XFREE (MTYPE_MEM_POOL_SLAB, slab);
+    }
+  XFREE (MTYPE_MEM_POOL, pool);
+}
+
+/*
+ * Create arena allocating chunks of given size, accounted to given type.
+ */
+struct mem_arena *
+mem_arena_new (int type, size_t size)
+{
+  struct mem_arena *arena;
+
+  arena = XCALLOC (MTYPE_MEM_ARENA, sizeof (struct mem_arena));
+  arena->type = type;
+  arena->size = MEM_ALIGNED (size);
+
+  return arena;
+}
+
+/*
+ * Get zeroed memory from arena.  It is valid until mem_arena_reset.
+ * Requests bigger than chunk size get chunk of their own.
+ */
+void *
+mem_arena_alloc (struct mem_arena *arena, size_t size)
+{
+  char *chunk;
+  size_t csize;
+
+  size = MEM_ALIGNED (size);
+
+  if (arena->chunks == NULL || arena->used + size > arena->size)
+    {
+      /* first aligned word of chunk links it to the others */
+      csize = size > arena->size ? size : arena->size;
+      chunk = XMALLOC (arena->type, MEM_ALIGN + csize);
+      *(void **) chunk = arena->chunks;
+      arena->chunks = chunk;
+      arena->used = 0;
+    }
+
+  chunk = (char *) arena->chunks + MEM_ALIGN + arena->used;
+  arena->used += size;
+  memset (chunk, 0, size);
+
+  return chunk;
+}
+
+/*
+ * Release everything allocated from arena.  The last chunk is kept,
+ * so arena reused for similar work does not allocate again.
+ */
+void
+mem_arena_reset (struct mem_arena *arena)
+{
+  void *chunk, *next;
+
+  if (arena->chunks == NULL)
+    return;
+
+  /* keep the oldest chunk for next round, free the others */
+  while ((next = *(void **) arena->chunks) != NULL)
+    {
+      chunk = arena->chunks;
+      arena->chunks = next;
+      XFREE (arena->type, chunk);
+    }
+  arena->used = 0;
+}
+
+/*
+ * Release arena with all its chunks.
+ */
+void
+mem_arena_delete (struct mem_arena *arena)
+{
+  void *chunk;
+
+  while ((chunk = arena->chunks) != NULL)
+    {
+      arena->chunks = *(void **) chunk;
+      XFREE (arena->type, chunk);
+    }
+  XFREE (MTYPE_MEM_ARENA, arena);
+}
+
 #ifdef MEMORY_LOG
 static struct 
 {
@@ -87,6 +87,40 @@ extern char *mtype_zstrdup (const char *file, int line, int type,
 extern void memory_init (void);
 extern void log_memstats_stderr (const char *);
 
+/* Pool of equally sized objects.  Objects are carved from slabs and
+ * recycled through a free list, so frequently created and deleted
+ * structures do not go to malloc each time.  Objects handed out are
+ * still accounted to the pool's memory type. */
+struct mem_pool
+{
+  int type;			/* memory type of objects */
+  size_t size;			/* object size, aligned */
+  unsigned int per_slab;	/* objects carved from one slab */
+  void *free;			/* free objects, linked through first word */
+  void *slabs;			/* slabs, linked through first word */
+};
+
+/* Bump allocator for short lived temporaries which are all released
+ * at once by mem_arena_reset. */
+struct mem_arena
+{
+  int type;			/* memory type of chunks */
+  size_t size;			/* chunk size */
+  void *chunks;			/* chunks, current one first */
+  size_t used;			/* bytes used in current chunk */
+};
+
+extern struct mem_pool *mem_pool_new (int type, size_t size,
+				      unsigned int per_slab);
+extern void *mem_pool_alloc (struct mem_pool *);
+extern void mem_pool_free (struct mem_pool *, void *);
+extern void mem_pool_delete (struct mem_pool *);
+
+extern struct mem_arena *mem_arena_new (int type, size_t size);
+extern void *mem_arena_alloc (struct mem_arena *, size_t);
+extern void mem_arena_reset (struct mem_arena *);
+extern void mem_arena_delete (struct mem_arena *);
+
 /* return number of allocations outstanding for the type */
 extern unsigned long mtype_stats_alloc (int);
 
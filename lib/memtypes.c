@@ -18,9 +18,14 @@ struct memory_list memory_list_lib[] =
   { MTYPE_VECTOR_INDEX,		"Vector index"			},
   { MTYPE_LINK_LIST,		"Link List"			},
   { MTYPE_LINK_NODE,		"Link Node"			},
+  { MTYPE_MEM_POOL,		"Memory pool"			},
+  { MTYPE_MEM_POOL_SLAB,	"Memory pool slab"		},
+  { MTYPE_MEM_ARENA,		"Memory arena"			},
   { MTYPE_THREAD,		"Thread"			},
   { MTYPE_THREAD_MASTER,	"Thread master"			},
   { MTYPE_THREAD_STATS,		"Thread stats"			},
+  { MTYPE_THREAD_POLL,		"Thread poll state"		},
+  { MTYPE_THREAD_WHEEL,		"Thread timer wheel"		},
   { MTYPE_VTY,			"VTY"				},
   { MTYPE_VTY_OUT_BUF,		"VTY output buffer"		},
   { MTYPE_VTY_HIST,		"VTY history"			},
@@ -45,6 +50,7 @@ struct memory_list memory_list_lib[] =
   { MTYPE_ACCESS_LIST,		"Access List"			},
   { MTYPE_ACCESS_LIST_STR,	"Access List Str"		},
   { MTYPE_ACCESS_FILTER,	"Access Filter"			},
+  { MTYPE_ACCESS_FILTER_TUPLE,	"Access Filter tuple"		},
   { MTYPE_PREFIX_LIST,		"Prefix List"			},
   { MTYPE_PREFIX_LIST_ENTRY,	"Prefix List Entry"		},
   { MTYPE_PREFIX_LIST_STR,	"Prefix List Str"		},
@@ -66,6 +72,8 @@ struct memory_list memory_list_lib[] =
   { MTYPE_WORK_QUEUE,		"Work queue"			},
   { MTYPE_WORK_QUEUE_ITEM,	"Work queue item"		},
   { MTYPE_WORK_QUEUE_NAME,	"Work queue name string"	},
+  { MTYPE_WORKER_POOL,		"Worker pool"			},
+  { MTYPE_WORKER_JOB,		"Worker pool job"		},
   { MTYPE_PQUEUE,		"Priority queue"		},
   { MTYPE_PQUEUE_DATA,		"Priority queue data"		},
   { MTYPE_HOST,			"Host config"			},
@@ -284,10 +292,16 @@ struct memory_list memory_list_eigrp[] =
   { MTYPE_EIGRP_PACKET,          "EIGRP packet structure"         },
   { MTYPE_EIGRP_NEIGHBOR,        "EIGRP neighbor structure"       },
   { MTYPE_EIGRP_IPV4_INT_TLV,    "EIGRP Internal IPv4 TLV "       },
+  { MTYPE_EIGRP_IPV4_EXT_TLV,    "EIGRP External IPv4 TLV "       },
   { MTYPE_EIGRP_AUTH_TLV,        "EIGRP Authentication MD5 TLV"   },
   { MTYPE_EIGRP_AUTH_SHA256_TLV, "EIGRP Authentication SHA256 TLV"},
   { MTYPE_EIGRP_SEQ_TLV,         "EIGRP Sequence TLV "            },
   { MTYPE_EIGRP_FSM_MSG,         "EIGRP FSM action message"       },
+  { MTYPE_EIGRP_SUMMARY,         "EIGRP summary address"          },
+  { MTYPE_EIGRP_EXTERNAL,        "EIGRP redistributed route"      },
+  { MTYPE_EIGRP_FILTER_VERDICT,  "EIGRP cached filter verdict"    },
+  { MTYPE_EIGRP_NBR_SET,         "EIGRP neighbor set"             },
+  { MTYPE_EIGRP_PACKET_ARENA,    "EIGRP received packet arena"    },
   { -1, NULL },
 };
 
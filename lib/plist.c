@@ -28,6 +28,7 @@
 #include "sockunion.h"
 #include "buffer.h"
 #include "stream.h"
+#include "table.h"
 #include "log.h"
 
 /* Each prefix-list's entry. */
@@ -45,9 +46,13 @@ struct prefix_list_entry
 
   unsigned long refcnt;
   unsigned long hitcnt;
+  unsigned long hits;		/* since refcnt was last folded */
 
   struct prefix_list_entry *next;
   struct prefix_list_entry *prev;
+
+  /* Next entry of the same trie node, by seq. */
+  struct prefix_list_entry *trie_next;
 };
 
 /* List of struct prefix_list. */
@@ -156,12 +161,22 @@ prefix_list_new (void)
   struct prefix_list *new;
 
   new = XCALLOC (MTYPE_PREFIX_LIST, sizeof (struct prefix_list));
+  new->seq_index = route_table_init ();
+  new->trie_ipv4 = route_table_init ();
+#ifdef HAVE_IPV6
+  new->trie_ipv6 = route_table_init ();
+#endif /* HAVE_IPV6 */
   return new;
 }
 
 static void
 prefix_list_free (struct prefix_list *plist)
 {
+  route_table_finish (plist->seq_index);
+  route_table_finish (plist->trie_ipv4);
+#ifdef HAVE_IPV6
+  route_table_finish (plist->trie_ipv6);
+#endif /* HAVE_IPV6 */
   XFREE (MTYPE_PREFIX_LIST, plist);
 }
 
@@ -380,31 +395,206 @@ prefix_new_seq_get (struct prefix_list *plist)
 {
   int maxseq;
   int newseq;
-  struct prefix_list_entry *pentry;
 
-  maxseq = newseq = 0;
-
-  for (pentry = plist->head; pentry; pentry = pentry->next)
-    {
-      if (maxseq < pentry->seq)
-	maxseq = pentry->seq;
-    }
+  /* entries are sorted by seq */
+  maxseq = 0;
+  if (plist->tail && plist->tail->seq > 0)
+    maxseq = plist->tail->seq;
 
   newseq = ((maxseq / 5) * 5) + 5;
   
   return newseq;
 }
 
+/* Key of seq in seq_index, ordered as seq is. */
+static void
+prefix_seq_key (struct prefix *key, int seq)
+{
+  memset (key, 0, sizeof (struct prefix));
+  key->family = AF_INET;
+  key->prefixlen = IPV4_MAX_BITLEN;
+  key->u.prefix4.s_addr = htonl ((u_int32_t) seq ^ 0x80000000);
+}
+
 /* Return prefix list entry which has same seq number. */
 static struct prefix_list_entry *
 prefix_seq_check (struct prefix_list *plist, int seq)
+{
+  struct prefix_list_entry *pentry = NULL;
+  struct route_node *rn;
+  struct prefix key;
+
+  prefix_seq_key (&key, seq);
+  rn = route_node_lookup (plist->seq_index, &key);
+  if (rn)
+    {
+      pentry = rn->info;
+      route_unlock_node (rn);
+    }
+  return pentry;
+}
+
+/* Index entry by seq, returns entry it goes before in the list. */
+static struct prefix_list_entry *
+prefix_seq_index_add (struct prefix_list *plist,
+		      struct prefix_list_entry *pentry)
+{
+  struct route_node *rn;
+  struct route_node *next;
+  struct prefix key;
+
+  prefix_seq_key (&key, pentry->seq);
+  rn = route_node_get (plist->seq_index, &key);
+  rn->info = pentry;
+
+  /* appending, as when config is read */
+  if (plist->tail == NULL || plist->tail->seq < pentry->seq)
+    return NULL;
+
+  route_lock_node (rn);
+  for (next = route_next (rn); next; next = route_next (next))
+    if (next->info)
+      {
+	route_unlock_node (next);
+	return next->info;
+      }
+  return NULL;
+}
+
+static void
+prefix_seq_index_delete (struct prefix_list *plist,
+			 struct prefix_list_entry *pentry)
+{
+  struct route_node *rn;
+  struct prefix key;
+
+  prefix_seq_key (&key, pentry->seq);
+  rn = route_node_lookup (plist->seq_index, &key);
+  if (rn == NULL)
+    return;
+  rn->info = NULL;
+  route_unlock_node (rn);
+  route_unlock_node (rn);
+}
+
+static struct route_table *
+prefix_list_trie (struct prefix_list *plist, u_char family)
+{
+  if (family == AF_INET)
+    return plist->trie_ipv4;
+#ifdef HAVE_IPV6
+  if (family == AF_INET6)
+    return plist->trie_ipv6;
+#endif /* HAVE_IPV6 */
+  return NULL;
+}
+
+/* First entry of trie node of prefix, NULL if there is none. */
+static struct prefix_list_entry *
+prefix_list_trie_lookup (struct prefix_list *plist, struct prefix *prefix)
+{
+  struct prefix_list_entry *pentry = NULL;
+  struct route_table *trie;
+  struct route_node *rn;
+  struct prefix p;
+
+  trie = prefix_list_trie (plist, prefix->family);
+  if (trie == NULL)
+    return NULL;
+
+  prefix_copy (&p, prefix);
+  apply_mask (&p);
+  rn = route_node_lookup (trie, &p);
+  if (rn)
+    {
+      pentry = rn->info;
+      route_unlock_node (rn);
+    }
+  return pentry;
+}
+
+/* Add entry to trie node of its prefix, entries of node sorted by seq. */
+static void
+prefix_list_trie_add (struct prefix_list *plist,
+		      struct prefix_list_entry *pentry)
+{
+  struct prefix_list_entry **pp;
+  struct route_table *trie;
+  struct route_node *rn;
+  struct prefix p;
+
+  trie = prefix_list_trie (plist, pentry->prefix.family);
+  if (trie == NULL)
+    return;
+
+  prefix_copy (&p, &pentry->prefix);
+  apply_mask (&p);
+  rn = route_node_get (trie, &p);
+
+  /* node is locked once for all its entries */
+  if (rn->info)
+    route_unlock_node (rn);
+
+  for (pp = (struct prefix_list_entry **) &rn->info; *pp;
+       pp = &(*pp)->trie_next)
+    if ((*pp)->seq > pentry->seq)
+      break;
+  pentry->trie_next = *pp;
+  *pp = pentry;
+}
+
+static void
+prefix_list_trie_delete (struct prefix_list *plist,
+			 struct prefix_list_entry *pentry)
+{
+  struct prefix_list_entry **pp;
+  struct route_table *trie;
+  struct route_node *rn;
+  struct prefix p;
+
+  trie = prefix_list_trie (plist, pentry->prefix.family);
+  if (trie == NULL)
+    return;
+
+  prefix_copy (&p, &pentry->prefix);
+  apply_mask (&p);
+  rn = route_node_lookup (trie, &p);
+  if (rn == NULL)
+    return;
+
+  for (pp = (struct prefix_list_entry **) &rn->info; *pp;
+       pp = &(*pp)->trie_next)
+    if (*pp == pentry)
+      {
+	*pp = pentry->trie_next;
+	break;
+      }
+  pentry->trie_next = NULL;
+
+  route_unlock_node (rn);
+  if (rn->info == NULL)
+    route_unlock_node (rn);
+}
+
+/* Entries visited by prefix_list_apply are not counted one by one, only
+ * applications of the list and hits are.  An entry was consulted by every
+ * application which hit none of entries before it, fold that into refcnt. */
+static void
+prefix_list_refcnt_fold (struct prefix_list *plist)
 {
   struct prefix_list_entry *pentry;
+  unsigned long consulted = plist->applied;
+
+  if (plist->applied == 0)
+    return;
 
   for (pentry = plist->head; pentry; pentry = pentry->next)
-    if (pentry->seq == seq)
-      return pentry;
-  return NULL;
+    {
+      pentry->refcnt += consulted;
+      consulted -= pentry->hits;
+      pentry->hits = 0;
+    }
+  plist->applied = 0;
 }
 
 static struct prefix_list_entry *
@@ -413,7 +603,8 @@ prefix_list_entry_lookup (struct prefix_list *plist, struct prefix *prefix,
 {
   struct prefix_list_entry *pentry;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  for (pentry = prefix_list_trie_lookup (plist, prefix); pentry;
+       pentry = pentry->trie_next)
     if (prefix_same (&pentry->prefix, prefix) && pentry->type == type)
       {
 	if (seq >= 0 && pentry->seq != seq)
@@ -437,6 +628,11 @@ prefix_list_entry_delete (struct prefix_list *plist,
 {
   if (plist == NULL || pentry == NULL)
     return;
+
+  prefix_list_refcnt_fold (plist);
+  prefix_seq_index_delete (plist, pentry);
+  prefix_list_trie_delete (plist, pentry);
+
   if (pentry->prev)
     pentry->prev->next = pentry->next;
   else
@@ -478,10 +674,11 @@ prefix_list_entry_add (struct prefix_list *plist,
   if (replace)
     prefix_list_entry_delete (plist, replace, 0);
 
+  prefix_list_refcnt_fold (plist);
+  prefix_list_trie_add (plist, pentry);
+
   /* Check insert point. */
-  for (point = plist->head; point; point = point->next)
-    if (point->seq >= pentry->seq)
-      break;
+  point = prefix_seq_index_add (plist, pentry);
 
   /* In case of this is the first element of the list. */
   pentry->next = point;
@@ -564,6 +761,9 @@ enum prefix_list_type
 prefix_list_apply (struct prefix_list *plist, void *object)
 {
   struct prefix_list_entry *pentry;
+  struct prefix_list_entry *match = NULL;
+  struct route_table *trie;
+  struct route_node *node;
   struct prefix *p;
 
   p = (struct prefix *) object;
@@ -574,14 +774,36 @@ prefix_list_apply (struct prefix_list *plist, void *object)
   if (plist->count == 0)
     return PREFIX_PERMIT;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  plist->applied++;
+
+  /* Entries which can match are those on the path to p in the trie, the
+     one with lowest seq of them wins. */
+  trie = prefix_list_trie (plist, p->family);
+  node = trie ? trie->top : NULL;
+  while (node && node->p.prefixlen <= p->prefixlen
+	 && prefix_match (&node->p, p))
     {
-      pentry->refcnt++;
-      if (prefix_list_entry_match (pentry, p))
+      for (pentry = node->info; pentry; pentry = pentry->trie_next)
 	{
-	  pentry->hitcnt++;
-	  return pentry->type;
+	  if (match && pentry->seq > match->seq)
+	    break;
+	  if (prefix_list_entry_match (pentry, p))
+	    {
+	      match = pentry;
+	      break;
+	    }
 	}
+
+      if (node->p.prefixlen == p->prefixlen)
+	break;
+      node = node->link[prefix_bit (&p->u.prefix, node->p.prefixlen)];
+    }
+
+  if (match)
+    {
+      match->hitcnt++;
+      match->hits++;
+      return match->type;
     }
 
   return PREFIX_DENY;
@@ -635,7 +857,8 @@ prefix_entry_dup_check (struct prefix_list *plist,
   else
     seq = new->seq;
 
-  for (pentry = plist->head; pentry; pentry = pentry->next)
+  for (pentry = prefix_list_trie_lookup (plist, &new->prefix); pentry;
+       pentry = pentry->trie_next)
     {
       if (prefix_same (&pentry->prefix, &new->prefix)
 	  && pentry->type == new->type
@@ -926,6 +1149,8 @@ vty_show_prefix_entry (struct vty *vty, afi_t afi, struct prefix_list *plist,
 {
   struct prefix_list_entry *pentry;
 
+  prefix_list_refcnt_fold (plist);
+
   /* Print the name of the protocol */
   if (zlog_default)
       vty_out (vty, "%s: ", zlog_proto_names[zlog_default->protocol]);
@@ -1061,6 +1286,8 @@ vty_show_prefix_list_prefix (struct vty *vty, afi_t afi, const char *name,
       return CMD_WARNING;
     }
 
+  prefix_list_refcnt_fold (plist);
+
   for (pentry = plist->head; pentry; pentry = pentry->next)
     {
       match = 0;
@@ -25,6 +25,8 @@
 
 #define AFI_ORF_PREFIX 65535
 
+struct route_table;
+
 enum prefix_list_type 
 {
   PREFIX_DENY,
@@ -52,6 +54,14 @@ struct prefix_list
   struct prefix_list_entry *head;
   struct prefix_list_entry *tail;
 
+  /* Entries indexed by seq, and by prefix for matching. */
+  struct route_table *seq_index;
+  struct route_table *trie_ipv4;
+  struct route_table *trie_ipv6;
+
+  /* Applications not yet folded into entries' refcnt. */
+  unsigned long applied;
+
   struct prefix_list *next;
   struct prefix_list *prev;
 };
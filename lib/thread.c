@@ -40,6 +40,12 @@
 extern int agentx_enabled;
 #endif
 
+/* AgentX needs its descriptors in select() sets, it keeps select backend */
+#if defined HAVE_SYS_EPOLL_H && !(defined HAVE_SNMP && defined SNMP_AGENTX)
+#define THREAD_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #if defined(__APPLE__)
 #include <mach/mach.h>
 #include <mach/mach_time.h>
@@ -520,28 +526,6 @@ thread_timer_update(void *node, int actual_position)
   thread->index = actual_position;
 }
 
-/* Allocate new thread master.  */
-struct thread_master *
-thread_master_create ()
-{
-  struct thread_master *rv;
-
-  if (cpu_record == NULL) 
-    cpu_record 
-      = hash_create ((unsigned int (*) (void *))cpu_record_hash_key,
-		     (int (*) (const void *, const void *))cpu_record_hash_cmp);
-
-  rv = XCALLOC (MTYPE_THREAD_MASTER, sizeof (struct thread_master));
-
-  /* Initialize the timer queues */
-  rv->timer = pqueue_create();
-  rv->background = pqueue_create();
-  rv->timer->cmp = rv->background->cmp = thread_timer_cmp;
-  rv->timer->update = rv->background->update = thread_timer_update;
-
-  return rv;
-}
-
 /* Add a new thread to the list.  */
 static void
 thread_list_add (struct thread_list *list, struct thread *thread)
@@ -573,6 +557,571 @@ thread_list_delete (struct thread_list *list, struct thread *thread)
   return thread;
 }
 
+/* I/O readiness backend.  Read and write threads are indexed by fd in
+ * m->fds, backend is told whenever threads of fd change and reports
+ * which fds are ready, so fetch does not depend on the number of fds
+ * watched. */
+struct thread_io
+{
+  const char *name;
+  int (*init) (struct thread_master *);
+  void (*fini) (struct thread_master *);
+  /* watch fd for threads now in m->fds[fd], -1 if it can not be watched */
+  int (*update) (struct thread_master *, int fd);
+  /* wait for I/O at most timer_wait, NULL waits until there is some */
+  int (*wait) (struct thread_master *, struct timeval *timer_wait);
+  /* move threads of fds reported by successful wait to ready list */
+  void (*process) (struct thread_master *, int num);
+};
+
+/* Get index entry of fd, growing index as needed. */
+static struct thread_fd *
+thread_fd_get (struct thread_master *m, int fd)
+{
+  if (fd >= m->fds_size)
+    {
+      int size = m->fds_size ? m->fds_size : 64;
+
+      while (size <= fd)
+	size *= 2;
+      m->fds = XREALLOC (MTYPE_THREAD_POLL, m->fds,
+			 size * sizeof (struct thread_fd));
+      memset (m->fds + m->fds_size, 0,
+	      (size - m->fds_size) * sizeof (struct thread_fd));
+      m->fds_size = size;
+    }
+  return &m->fds[fd];
+}
+
+/* I/O thread's fd is ready, move it to ready list. */
+static void
+thread_fd_ready (struct thread_master *m, struct thread *thread)
+{
+  struct thread_fd *tf = &m->fds[THREAD_FD (thread)];
+
+  if (thread->type == THREAD_READ)
+    {
+      tf->read = NULL;
+      thread_list_delete (&m->read, thread);
+    }
+  else
+    {
+      tf->write = NULL;
+      thread_list_delete (&m->write, thread);
+    }
+  thread->type = THREAD_READY;
+  thread_list_add (&m->ready, thread);
+}
+
+/* select() backend, fd sets of master are copied for each wait. */
+struct thread_select
+{
+  fd_set readfd;
+  fd_set writefd;
+  fd_set exceptfd;
+};
+
+static int
+thread_select_init (struct thread_master *m)
+{
+  m->poll_events = XCALLOC (MTYPE_THREAD_POLL, sizeof (struct thread_select));
+  return 0;
+}
+
+static void
+thread_select_fini (struct thread_master *m)
+{
+  XFREE (MTYPE_THREAD_POLL, m->poll_events);
+}
+
+static int
+thread_select_update (struct thread_master *m, int fd)
+{
+  struct thread_fd *tf = &m->fds[fd];
+
+  if (fd >= FD_SETSIZE)
+    {
+      zlog (NULL, LOG_WARNING, "fd [%d] does not fit select() set", fd);
+      return -1;
+    }
+
+  if (tf->read)
+    FD_SET (fd, &m->readfd);
+  else
+    FD_CLR (fd, &m->readfd);
+  if (tf->write)
+    FD_SET (fd, &m->writefd);
+  else
+    FD_CLR (fd, &m->writefd);
+
+  return 0;
+}
+
+static int
+thread_select_wait (struct thread_master *m, struct timeval *timer_wait)
+{
+  struct thread_select *sel = m->poll_events;
+  int num;
+#if defined HAVE_SNMP && defined SNMP_AGENTX
+  struct timeval snmp_timer_wait;
+  int snmpblock = 0;
+  int fdsetsize;
+#endif
+
+  /* Structure copy.  */
+  sel->readfd = m->readfd;
+  sel->writefd = m->writefd;
+  sel->exceptfd = m->exceptfd;
+
+#if defined HAVE_SNMP && defined SNMP_AGENTX
+  /* When SNMP is enabled, we may have to select() on additional
+     FD. snmp_select_info() will add them to `readfd'. The trick
+     with this function is its last argument. We need to set it to
+     0 if timer_wait is not NULL and we need to use the provided
+     new timer only if it is still set to 0. */
+  if (agentx_enabled)
+    {
+      fdsetsize = FD_SETSIZE;
+      snmpblock = 1;
+      if (timer_wait)
+        {
+          snmpblock = 0;
+          memcpy(&snmp_timer_wait, timer_wait, sizeof(struct timeval));
+        }
+      snmp_select_info(&fdsetsize, &sel->readfd, &snmp_timer_wait, &snmpblock);
+      if (snmpblock == 0)
+        timer_wait = &snmp_timer_wait;
+    }
+#endif
+  num = select (FD_SETSIZE, &sel->readfd, &sel->writefd, &sel->exceptfd,
+		timer_wait);
+  if (num < 0)
+    return num;
+
+#if defined HAVE_SNMP && defined SNMP_AGENTX
+  if (agentx_enabled)
+    {
+      if (num > 0)
+        snmp_read(&sel->readfd);
+      else if (num == 0)
+        {
+          snmp_timeout();
+          run_alarms();
+        }
+      netsnmp_check_outstanding_agent_requests();
+    }
+#endif
+  return num;
+}
+
+static void
+thread_select_process_fd (struct thread_master *m, struct thread_list *list,
+			  fd_set *fdset, fd_set *mfdset)
+{
+  struct thread *thread;
+  struct thread *next;
+
+  for (thread = list->head; thread; thread = next)
+    {
+      next = thread->next;
+
+      if (FD_ISSET (THREAD_FD (thread), fdset))
+        {
+          assert (FD_ISSET (THREAD_FD (thread), mfdset));
+          FD_CLR(THREAD_FD (thread), mfdset);
+          thread_fd_ready (m, thread);
+        }
+    }
+}
+
+static void
+thread_select_process (struct thread_master *m, int num)
+{
+  struct thread_select *sel = m->poll_events;
+
+  /* Normal priority read thead. */
+  thread_select_process_fd (m, &m->read, &sel->readfd, &m->readfd);
+  /* Write thead. */
+  thread_select_process_fd (m, &m->write, &sel->writefd, &m->writefd);
+}
+
+static const struct thread_io thread_io_select =
+{
+  .name = "select",
+  .init = thread_select_init,
+  .fini = thread_select_fini,
+  .update = thread_select_update,
+  .wait = thread_select_wait,
+  .process = thread_select_process,
+};
+
+#ifdef THREAD_EPOLL
+/* epoll backend.  Fds are registered one shot, so the kernel disarms fd
+ * when it reports it and thread which fired costs no system call; adding
+ * next thread arms it again. */
+#define THREAD_EPOLL_EVENTS 256
+
+static int
+thread_epoll_init (struct thread_master *m)
+{
+  m->poll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (m->poll_fd < 0)
+    return -1;
+  m->poll_events = XCALLOC (MTYPE_THREAD_POLL,
+			    THREAD_EPOLL_EVENTS * sizeof (struct epoll_event));
+  return 0;
+}
+
+static void
+thread_epoll_fini (struct thread_master *m)
+{
+  close (m->poll_fd);
+  m->poll_fd = -1;
+  XFREE (MTYPE_THREAD_POLL, m->poll_events);
+}
+
+static int
+thread_epoll_update (struct thread_master *m, int fd)
+{
+  struct thread_fd *tf = &m->fds[fd];
+  struct epoll_event ev;
+  int ret;
+
+  memset (&ev, 0, sizeof (ev));
+  ev.data.fd = fd;
+  ev.events = (tf->read ? EPOLLIN : 0) | (tf->write ? EPOLLOUT : 0);
+
+  if (ev.events == 0)
+    {
+      /* fd may be closed already, nothing to complain about */
+      if (tf->registered)
+	epoll_ctl (m->poll_fd, EPOLL_CTL_DEL, fd, &ev);
+      tf->registered = 0;
+      return 0;
+    }
+
+  ev.events |= EPOLLONESHOT;
+  ret = epoll_ctl (m->poll_fd, tf->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+		   fd, &ev);
+  /* fd was closed and its number reused since it was registered */
+  if (ret < 0 && errno == ENOENT)
+    ret = epoll_ctl (m->poll_fd, EPOLL_CTL_ADD, fd, &ev);
+  else if (ret < 0 && errno == EEXIST)
+    ret = epoll_ctl (m->poll_fd, EPOLL_CTL_MOD, fd, &ev);
+
+  if (ret < 0)
+    {
+      zlog (NULL, LOG_WARNING, "epoll_ctl fd [%d]: %s",
+	    fd, safe_strerror (errno));
+      tf->registered = 0;
+      return -1;
+    }
+  tf->registered = 1;
+  return 0;
+}
+
+static int
+thread_epoll_wait (struct thread_master *m, struct timeval *timer_wait)
+{
+  int timeout = -1;
+  int num;
+
+  /* round up, so timer is not polled for until it pops */
+  if (timer_wait)
+    timeout = timer_wait->tv_sec * 1000 + (timer_wait->tv_usec + 999) / 1000;
+
+  num = epoll_wait (m->poll_fd, m->poll_events, THREAD_EPOLL_EVENTS, timeout);
+  m->poll_ready = num > 0 ? num : 0;
+  return num;
+}
+
+static void
+thread_epoll_process (struct thread_master *m, int num)
+{
+  struct epoll_event *events = m->poll_events;
+  struct thread_fd *tf;
+  int i;
+
+  for (i = 0; i < m->poll_ready; i++)
+    {
+      tf = &m->fds[events[i].data.fd];
+
+      /* hangup and error are reported to both, as select() does */
+      if (tf->read && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+	thread_fd_ready (m, tf->read);
+      if (tf->write && (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)))
+	thread_fd_ready (m, tf->write);
+
+      /* fd is disarmed now, arm it for thread still waiting */
+      if (tf->read || tf->write)
+	thread_epoll_update (m, events[i].data.fd);
+    }
+  m->poll_ready = 0;
+}
+
+static const struct thread_io thread_io_epoll =
+{
+  .name = "epoll",
+  .init = thread_epoll_init,
+  .fini = thread_epoll_fini,
+  .update = thread_epoll_update,
+  .wait = thread_epoll_wait,
+  .process = thread_epoll_process,
+};
+#endif /* THREAD_EPOLL */
+
+/* Hierarchical timer wheel with 1 msec tick, alternative to timer heaps.
+ * Root level has a slot for each of next 256 ticks, each of upper levels
+ * has 64 slots covering 64 times longer span than level below.  Slots of
+ * upper level are cascaded to levels below as wheel turns, so adding and
+ * cancelling a timer is O(1) instead of O(log n), at the cost of timers
+ * popping up to 1 msec late and idle wakeups every 256 msec while only
+ * distant timers are pending. */
+#define WHEEL_ROOT_BITS		8
+#define WHEEL_ROOT_SIZE		(1 << WHEEL_ROOT_BITS)
+#define WHEEL_LEVEL_BITS	6
+#define WHEEL_LEVEL_SIZE	(1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVELS		4
+#define WHEEL_SLOTS		(WHEEL_ROOT_SIZE + WHEEL_LEVELS * WHEEL_LEVEL_SIZE)
+#define WHEEL_MAX_TICKS		((1ULL << (WHEEL_ROOT_BITS \
+				   + WHEEL_LEVELS * WHEEL_LEVEL_BITS)) - 1)
+
+struct thread_wheel
+{
+  struct thread_master *master;
+  u_int64_t now;		/* next tick to expire */
+  unsigned long count;		/* timers in wheel */
+  struct thread_list slot[WHEEL_SLOTS];
+};
+
+/* Tick of time, rounded up so that timer never pops early. */
+static u_int64_t
+thread_wheel_tick (struct timeval *tv)
+{
+  return (u_int64_t) tv->tv_sec * 1000 + (tv->tv_usec + 999) / 1000;
+}
+
+static struct thread_wheel *
+thread_wheel_new (struct thread_master *m)
+{
+  struct thread_wheel *wheel;
+
+  wheel = XCALLOC (MTYPE_THREAD_WHEEL, sizeof (struct thread_wheel));
+  wheel->master = m;
+  quagga_get_relative (NULL);
+  wheel->now = (u_int64_t) relative_time.tv_sec * 1000
+		+ relative_time.tv_usec / 1000;
+  return wheel;
+}
+
+static void
+thread_wheel_add (struct thread_wheel *wheel, struct thread *thread)
+{
+  u_int64_t expires = thread_wheel_tick (&thread->u.sands);
+  u_int64_t delta;
+  int level;
+  int shift;
+
+  /* already due, pop at next tick */
+  if (expires < wheel->now)
+    expires = wheel->now;
+  delta = expires - wheel->now;
+
+  if (delta < WHEEL_ROOT_SIZE)
+    thread->index = expires & (WHEEL_ROOT_SIZE - 1);
+  else
+    {
+      if (delta > WHEEL_MAX_TICKS)
+	expires = wheel->now + WHEEL_MAX_TICKS;
+      for (level = 0; level < WHEEL_LEVELS - 1; level++)
+	if (delta < 1ULL << (WHEEL_ROOT_BITS + (level + 1) * WHEEL_LEVEL_BITS))
+	  break;
+      shift = WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS;
+      thread->index = WHEEL_ROOT_SIZE + level * WHEEL_LEVEL_SIZE
+		      + ((expires >> shift) & (WHEEL_LEVEL_SIZE - 1));
+    }
+  thread_list_add (&wheel->slot[thread->index], thread);
+  wheel->count++;
+}
+
+static void
+thread_wheel_remove (struct thread_wheel *wheel, struct thread *thread)
+{
+  assert (thread->index >= 0 && thread->index < WHEEL_SLOTS);
+  thread_list_delete (&wheel->slot[thread->index], thread);
+  wheel->count--;
+}
+
+/* Detach all timers of slot, returned linked through next pointers. */
+static struct thread *
+thread_wheel_take (struct thread_wheel *wheel, int index)
+{
+  struct thread *head = wheel->slot[index].head;
+
+  wheel->count -= wheel->slot[index].count;
+  memset (&wheel->slot[index], 0, sizeof (struct thread_list));
+  return head;
+}
+
+/* Redistribute slot of upper level to levels below, returns slot index
+ * within level, wheel of next level turns when it is 0. */
+static int
+thread_wheel_cascade (struct thread_wheel *wheel, int level)
+{
+  int index = (wheel->now >> (WHEEL_ROOT_BITS + level * WHEEL_LEVEL_BITS))
+	      & (WHEEL_LEVEL_SIZE - 1);
+  struct thread *thread;
+  struct thread *next;
+
+  for (thread = thread_wheel_take (wheel, WHEEL_ROOT_SIZE
+				   + level * WHEEL_LEVEL_SIZE + index);
+       thread; thread = next)
+    {
+      next = thread->next;
+      thread->next = thread->prev = NULL;
+      thread_wheel_add (wheel, thread);
+    }
+  return index;
+}
+
+/* Sort expiring timers, so they run in the order heap would run them. */
+static struct thread *
+thread_wheel_sort (struct thread *head)
+{
+  struct thread *slow, *fast, *a, *b;
+  struct thread *sorted = NULL;
+  struct thread **tail = &sorted;
+
+  if (!head || !head->next)
+    return head;
+
+  for (slow = head, fast = head->next; fast && fast->next;
+       fast = fast->next->next)
+    slow = slow->next;
+  b = slow->next;
+  slow->next = NULL;
+  a = thread_wheel_sort (head);
+  b = thread_wheel_sort (b);
+
+  while (a && b)
+    {
+      if (timeval_cmp (b->u.sands, a->u.sands) < 0)
+	{
+	  *tail = b;
+	  b = b->next;
+	}
+      else
+	{
+	  *tail = a;
+	  a = a->next;
+	}
+      tail = &(*tail)->next;
+    }
+  *tail = a ? a : b;
+  return sorted;
+}
+
+static struct timeval *
+thread_wheel_wait (struct thread_wheel *wheel, struct timeval *timer_val)
+{
+  u_int64_t tick = wheel->now;
+  int index = wheel->now & (WHEEL_ROOT_SIZE - 1);
+  int64_t usec;
+
+  if (!wheel->count)
+    return NULL;
+
+  /* at turn of root wheel upper levels cascade first, so wake up then */
+  if (index)
+    {
+      for (; index < WHEEL_ROOT_SIZE; index++, tick++)
+	if (wheel->slot[index].count)
+	  break;
+    }
+
+  usec = (int64_t) tick * 1000
+	 - ((int64_t) relative_time.tv_sec * TIMER_SECOND_MICRO
+	    + relative_time.tv_usec);
+  if (usec < 0)
+    usec = 0;
+  timer_val->tv_sec = usec / TIMER_SECOND_MICRO;
+  timer_val->tv_usec = usec % TIMER_SECOND_MICRO;
+  return timer_val;
+}
+
+static unsigned int
+thread_wheel_process (struct thread_wheel *wheel, struct timeval *timenow)
+{
+  u_int64_t to = (u_int64_t) timenow->tv_sec * 1000 + timenow->tv_usec / 1000;
+  struct thread *thread;
+  struct thread *next;
+  unsigned int ready = 0;
+  int level;
+
+  while (wheel->now <= to)
+    {
+      if (!wheel->count)
+	{
+	  wheel->now = to + 1;
+	  break;
+	}
+
+      if (!(wheel->now & (WHEEL_ROOT_SIZE - 1)))
+	for (level = 0; level < WHEEL_LEVELS; level++)
+	  if (thread_wheel_cascade (wheel, level))
+	    break;
+
+      thread = thread_wheel_take (wheel,
+				  wheel->now & (WHEEL_ROOT_SIZE - 1));
+      for (thread = thread_wheel_sort (thread); thread; thread = next)
+	{
+	  next = thread->next;
+	  thread->type = THREAD_READY;
+	  thread_list_add (&wheel->master->ready, thread);
+	  ready++;
+	}
+      wheel->now++;
+    }
+  return ready;
+}
+
+/* Allocate new thread master.  */
+struct thread_master *
+thread_master_create ()
+{
+  struct thread_master *rv;
+
+  if (cpu_record == NULL) 
+    cpu_record 
+      = hash_create ((unsigned int (*) (void *))cpu_record_hash_key,
+		     (int (*) (const void *, const void *))cpu_record_hash_cmp);
+
+  rv = XCALLOC (MTYPE_THREAD_MASTER, sizeof (struct thread_master));
+
+  /* Initialize the timer queues */
+  rv->timer = pqueue_create();
+  rv->background = pqueue_create();
+  rv->timer->cmp = rv->background->cmp = thread_timer_cmp;
+  rv->timer->update = rv->background->update = thread_timer_update;
+
+  rv->poll_fd = -1;
+#ifdef THREAD_EPOLL
+  rv->io = &thread_io_epoll;
+  if (rv->io->init (rv) < 0)
+    {
+      zlog_warn ("epoll unavailable, using select(): %s",
+		 safe_strerror (errno));
+      rv->io = &thread_io_select;
+      rv->io->init (rv);
+    }
+#else
+  rv->io = &thread_io_select;
+  rv->io->init (rv);
+#endif /* THREAD_EPOLL */
+
+  return rv;
+}
+
 /* Move thread to unuse list. */
 static void
 thread_add_unuse (struct thread_master *m, struct thread *thread)
@@ -612,6 +1161,16 @@ thread_queue_free (struct thread_master *m, struct pqueue *queue)
   pqueue_delete(queue);
 }
 
+static void
+thread_wheel_free (struct thread_master *m, struct thread_wheel *wheel)
+{
+  int i;
+
+  for (i = 0; i < WHEEL_SLOTS; i++)
+    thread_list_free (m, &wheel->slot[i]);
+  XFREE (MTYPE_THREAD_WHEEL, wheel);
+}
+
 /* Stop thread scheduler. */
 void
 thread_master_free (struct thread_master *m)
@@ -623,7 +1182,13 @@ thread_master_free (struct thread_master *m)
   thread_list_free (m, &m->ready);
   thread_list_free (m, &m->unuse);
   thread_queue_free (m, m->background);
-  
+  if (m->timer_wheel)
+    thread_wheel_free (m, m->timer_wheel);
+  if (m->background_wheel)
+    thread_wheel_free (m, m->background_wheel);
+
+  m->io->fini (m);
+  XFREE (MTYPE_THREAD_POLL, m->fds);
   XFREE (MTYPE_THREAD_MASTER, m);
 
   if (cpu_record)
@@ -634,6 +1199,49 @@ thread_master_free (struct thread_master *m)
     }
 }
 
+/* Move pending timers between heap and wheel. */
+static struct thread_wheel *
+thread_timer_move (struct thread_master *m, struct pqueue *queue,
+		   struct thread_wheel *wheel, enum thread_timer_backend backend)
+{
+  struct thread *thread;
+  struct thread *next;
+  int i;
+
+  if (backend == THREAD_TIMER_WHEEL && !wheel)
+    {
+      wheel = thread_wheel_new (m);
+      while (queue->size)
+	{
+	  thread = queue->array[0];
+	  pqueue_dequeue (queue);
+	  thread_wheel_add (wheel, thread);
+	}
+    }
+  else if (backend == THREAD_TIMER_HEAP && wheel)
+    {
+      for (i = 0; i < WHEEL_SLOTS; i++)
+	for (thread = thread_wheel_take (wheel, i); thread; thread = next)
+	  {
+	    next = thread->next;
+	    thread->next = thread->prev = NULL;
+	    pqueue_enqueue (thread, queue);
+	  }
+      XFREE (MTYPE_THREAD_WHEEL, wheel);
+    }
+  return wheel;
+}
+
+/* Select data structure for timers, pending ones are carried over. */
+void
+thread_master_set_timer_backend (struct thread_master *m,
+				 enum thread_timer_backend backend)
+{
+  m->timer_wheel = thread_timer_move (m, m->timer, m->timer_wheel, backend);
+  m->background_wheel = thread_timer_move (m, m->background,
+					   m->background_wheel, backend);
+}
+
 /* Thread list is empty or not.  */
 static int
 thread_empty (struct thread_list *list)
@@ -698,18 +1306,27 @@ funcname_thread_add_read (struct thread_master *m,
 		 debugargdef)
 {
   struct thread *thread;
+  struct thread_fd *tf;
 
   assert (m != NULL);
 
-  if (FD_ISSET (fd, &m->readfd))
+  tf = thread_fd_get (m, fd);
+  if (tf->read)
     {
       zlog (NULL, LOG_WARNING, "There is already read fd [%d]", fd);
       return NULL;
     }
 
   thread = thread_get (m, THREAD_READ, func, arg, debugargpass);
-  FD_SET (fd, &m->readfd);
   thread->u.fd = fd;
+  tf->read = thread;
+  if (m->io->update (m, fd) < 0)
+    {
+      tf->read = NULL;
+      thread->type = THREAD_UNUSED;
+      thread_add_unuse (m, thread);
+      return NULL;
+    }
   thread_list_add (&m->read, thread);
 
   return thread;
@@ -722,18 +1339,27 @@ funcname_thread_add_write (struct thread_master *m,
 		 debugargdef)
 {
   struct thread *thread;
+  struct thread_fd *tf;
 
   assert (m != NULL);
 
-  if (FD_ISSET (fd, &m->writefd))
+  tf = thread_fd_get (m, fd);
+  if (tf->write)
     {
       zlog (NULL, LOG_WARNING, "There is already write fd [%d]", fd);
       return NULL;
     }
 
   thread = thread_get (m, THREAD_WRITE, func, arg, debugargpass);
-  FD_SET (fd, &m->writefd);
   thread->u.fd = fd;
+  tf->write = thread;
+  if (m->io->update (m, fd) < 0)
+    {
+      tf->write = NULL;
+      thread->type = THREAD_UNUSED;
+      thread_add_unuse (m, thread);
+      return NULL;
+    }
   thread_list_add (&m->write, thread);
 
   return thread;
@@ -749,6 +1375,7 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
 {
   struct thread *thread;
   struct pqueue *queue;
+  struct thread_wheel *wheel;
   struct timeval alarm_time;
 
   assert (m != NULL);
@@ -757,6 +1384,7 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
   assert (time_relative);
   
   queue = ((type == THREAD_TIMER) ? m->timer : m->background);
+  wheel = ((type == THREAD_TIMER) ? m->timer_wheel : m->background_wheel);
   thread = thread_get (m, type, func, arg, debugargpass);
 
   /* Do we need jitter here? */
@@ -765,7 +1393,10 @@ funcname_thread_add_timer_timeval (struct thread_master *m,
   alarm_time.tv_usec = relative_time.tv_usec + time_relative->tv_usec;
   thread->u.sands = timeval_adjust(alarm_time);
 
-  pqueue_enqueue(thread, queue);
+  if (wheel)
+    thread_wheel_add (wheel, thread);
+  else
+    pqueue_enqueue(thread, queue);
   return thread;
 }
 
@@ -855,21 +1486,25 @@ thread_cancel (struct thread *thread)
 {
   struct thread_list *list = NULL;
   struct pqueue *queue = NULL;
+  struct thread_wheel *wheel = NULL;
   
   switch (thread->type)
     {
     case THREAD_READ:
-      assert (FD_ISSET (thread->u.fd, &thread->master->readfd));
-      FD_CLR (thread->u.fd, &thread->master->readfd);
+      assert (thread->master->fds[thread->u.fd].read == thread);
+      thread->master->fds[thread->u.fd].read = NULL;
+      thread->master->io->update (thread->master, thread->u.fd);
       list = &thread->master->read;
       break;
     case THREAD_WRITE:
-      assert (FD_ISSET (thread->u.fd, &thread->master->writefd));
-      FD_CLR (thread->u.fd, &thread->master->writefd);
+      assert (thread->master->fds[thread->u.fd].write == thread);
+      thread->master->fds[thread->u.fd].write = NULL;
+      thread->master->io->update (thread->master, thread->u.fd);
       list = &thread->master->write;
       break;
     case THREAD_TIMER:
       queue = thread->master->timer;
+      wheel = thread->master->timer_wheel;
       break;
     case THREAD_EVENT:
       list = &thread->master->event;
@@ -879,13 +1514,18 @@ thread_cancel (struct thread *thread)
       break;
     case THREAD_BACKGROUND:
       queue = thread->master->background;
+      wheel = thread->master->background_wheel;
       break;
     default:
       return;
       break;
     }
 
-  if (queue)
+  if (wheel)
+    {
+      thread_wheel_remove (wheel, thread);
+    }
+  else if (queue)
     {
       assert(thread->index >= 0);
       assert(thread == queue->array[thread->index]);
@@ -949,8 +1589,11 @@ thread_cancel_event (struct thread_master *m, void *arg)
 }
 
 static struct timeval *
-thread_timer_wait (struct pqueue *queue, struct timeval *timer_val)
+thread_timer_wait (struct pqueue *queue, struct thread_wheel *wheel,
+		   struct timeval *timer_val)
 {
+  if (wheel)
+    return thread_wheel_wait (wheel, timer_val);
   if (queue->size)
     {
       struct thread *next_timer = queue->array[0];
@@ -970,39 +1613,16 @@ thread_run (struct thread_master *m, struct thread *thread,
   return fetch;
 }
 
-static int
-thread_process_fd (struct thread_list *list, fd_set *fdset, fd_set *mfdset)
-{
-  struct thread *thread;
-  struct thread *next;
-  int ready = 0;
-  
-  assert (list);
-  
-  for (thread = list->head; thread; thread = next)
-    {
-      next = thread->next;
-
-      if (FD_ISSET (THREAD_FD (thread), fdset))
-        {
-          assert (FD_ISSET (THREAD_FD (thread), mfdset));
-          FD_CLR(THREAD_FD (thread), mfdset);
-          thread_list_delete (list, thread);
-          thread_list_add (&thread->master->ready, thread);
-          thread->type = THREAD_READY;
-          ready++;
-        }
-    }
-  return ready;
-}
-
 /* Add all timers that have popped to the ready list. */
 static unsigned int
-thread_timer_process (struct pqueue *queue, struct timeval *timenow)
+thread_timer_process (struct pqueue *queue, struct thread_wheel *wheel,
+		      struct timeval *timenow)
 {
   struct thread *thread;
   unsigned int ready = 0;
   
+  if (wheel)
+    return thread_wheel_process (wheel, timenow);
   while (queue->size)
     {
       thread = queue->array[0];
@@ -1041,9 +1661,6 @@ struct thread *
 thread_fetch (struct thread_master *m, struct thread *fetch)
 {
   struct thread *thread;
-  fd_set readfd;
-  fd_set writefd;
-  fd_set exceptfd;
   struct timeval timer_val = { .tv_sec = 0, .tv_usec = 0 };
   struct timeval timer_val_bg;
   struct timeval *timer_wait = &timer_val;
@@ -1052,11 +1669,6 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
   while (1)
     {
       int num = 0;
-#if defined HAVE_SNMP && defined SNMP_AGENTX
-      struct timeval snmp_timer_wait;
-      int snmpblock = 0;
-      int fdsetsize;
-#endif
       
       /* Signals pre-empt everything */
       quagga_sigevent_process ();
@@ -1075,82 +1687,41 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
       /* Normal event are the next highest priority.  */
       thread_process (&m->event);
       
-      /* Structure copy.  */
-      readfd = m->readfd;
-      writefd = m->writefd;
-      exceptfd = m->exceptfd;
-      
       /* Calculate select wait timer if nothing else to do */
       if (m->ready.count == 0)
         {
           quagga_get_relative (NULL);
-          timer_wait = thread_timer_wait (m->timer, &timer_val);
-          timer_wait_bg = thread_timer_wait (m->background, &timer_val_bg);
+          timer_wait = thread_timer_wait (m->timer, m->timer_wheel,
+                                          &timer_val);
+          timer_wait_bg = thread_timer_wait (m->background,
+                                             m->background_wheel,
+                                             &timer_val_bg);
           
           if (timer_wait_bg &&
               (!timer_wait || (timeval_cmp (*timer_wait, *timer_wait_bg) > 0)))
             timer_wait = timer_wait_bg;
         }
       
-#if defined HAVE_SNMP && defined SNMP_AGENTX
-      /* When SNMP is enabled, we may have to select() on additional
-	 FD. snmp_select_info() will add them to `readfd'. The trick
-	 with this function is its last argument. We need to set it to
-	 0 if timer_wait is not NULL and we need to use the provided
-	 new timer only if it is still set to 0. */
-      if (agentx_enabled)
-        {
-          fdsetsize = FD_SETSIZE;
-          snmpblock = 1;
-          if (timer_wait)
-            {
-              snmpblock = 0;
-              memcpy(&snmp_timer_wait, timer_wait, sizeof(struct timeval));
-            }
-          snmp_select_info(&fdsetsize, &readfd, &snmp_timer_wait, &snmpblock);
-          if (snmpblock == 0)
-            timer_wait = &snmp_timer_wait;
-        }
-#endif
-      num = select (FD_SETSIZE, &readfd, &writefd, &exceptfd, timer_wait);
+      num = m->io->wait (m, timer_wait);
       
       /* Signals should get quick treatment */
       if (num < 0)
         {
           if (errno == EINTR)
             continue; /* signal received - process it */
-          zlog_warn ("select() error: %s", safe_strerror (errno));
+          zlog_warn ("%s() error: %s", m->io->name, safe_strerror (errno));
             return NULL;
         }
 
-#if defined HAVE_SNMP && defined SNMP_AGENTX
-      if (agentx_enabled)
-        {
-          if (num > 0)
-            snmp_read(&readfd);
-          else if (num == 0)
-            {
-              snmp_timeout();
-              run_alarms();
-            }
-          netsnmp_check_outstanding_agent_requests();
-        }
-#endif
-
       /* Check foreground timers.  Historically, they have had higher
          priority than I/O threads, so let's push them onto the ready
 	 list in front of the I/O threads. */
       quagga_get_relative (NULL);
-      thread_timer_process (m->timer, &relative_time);
+      thread_timer_process (m->timer, m->timer_wheel, &relative_time);
       
       /* Got IO, process it */
       if (num > 0)
-        {
-          /* Normal priority read thead. */
-          thread_process_fd (&m->read, &readfd, &m->readfd);
-          /* Write thead. */
-          thread_process_fd (&m->write, &writefd, &m->writefd);
-        }
+        m->io->process (m, num);
 
 #if 0
       /* If any threads were made ready above (I/O or foreground timer),
@@ -1162,7 +1733,8 @@ thread_fetch (struct thread_master *m, struct thread *fetch)
 #endif
 
       /* Background timer/events, lowest priority */
-      thread_timer_process (m->background, &relative_time);
+      thread_timer_process (m->background, m->background_wheel,
+                            &relative_time);
       
       if ((thread = thread_trim_head (&m->ready)) != NULL)
         return thread_run (m, thread, fetch);
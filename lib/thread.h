@@ -44,6 +44,23 @@ struct thread_list
 };
 
 struct pqueue;
+struct thread_io;
+struct thread_wheel;
+
+/* Data structure keeping timer and background threads. */
+enum thread_timer_backend
+{
+  THREAD_TIMER_HEAP,		/* binary heap, exact order */
+  THREAD_TIMER_WHEEL,		/* hierarchical wheel, O(1) add and cancel */
+};
+
+/* Read and write thread waiting on a file descriptor. */
+struct thread_fd
+{
+  struct thread *read;
+  struct thread *write;
+  int registered;		/* fd is known to I/O backend */
+};
 
 /* Master of the theads. */
 struct thread_master
@@ -55,9 +72,17 @@ struct thread_master
   struct thread_list ready;
   struct thread_list unuse;
   struct pqueue *background;
+  struct thread_wheel *timer_wheel; /* replace timer and background */
+  struct thread_wheel *background_wheel; /* heaps when set */
   fd_set readfd;
   fd_set writefd;
   fd_set exceptfd;
+  struct thread_fd *fds;	/* threads indexed by fd */
+  int fds_size;
+  const struct thread_io *io;	/* I/O readiness backend */
+  int poll_fd;			/* epoll instance, -1 with select */
+  void *poll_events;		/* ready events of last wait */
+  int poll_ready;
   unsigned long alloc;
 };
 
@@ -78,7 +103,8 @@ struct thread
     int fd;			/* file descriptor in case of read/write. */
     struct timeval sands;	/* rest of time sands value. */
   } u;
-  int index;			/* used for timers to store position in queue */
+  int index;			/* used for timers to store position in queue
+				   or slot of wheel */
   struct timeval real;
   struct cpu_thread_history *hist; /* cache pointer to cpu_history */
   const char *funcname;
@@ -178,6 +204,8 @@ enum quagga_clkid {
 /* Prototypes. */
 extern struct thread_master *thread_master_create (void);
 extern void thread_master_free (struct thread_master *);
+extern void thread_master_set_timer_backend (struct thread_master *,
+					     enum thread_timer_backend);
 
 extern struct thread *funcname_thread_add_read (struct thread_master *, 
 				                int (*)(struct thread *),
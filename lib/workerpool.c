@@ -0,0 +1,325 @@
+/*
+ * Quagga Worker Pools.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.  
+ */
+
+#include <lib/zebra.h>
+#include "thread.h"
+#include "memory.h"
+#include "workerpool.h"
+#include "network.h"
+#include "log.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
+/* Job is allocated and freed by master's thread only, workers just pass
+ * it along, so memory accounting needs no locking. */
+struct worker_job
+{
+  struct worker_job *next;
+  void (*work) (void *);
+  int (*done) (struct thread *);
+  void *arg;
+};
+
+#ifdef HAVE_PTHREAD
+struct worker_threads
+{
+  pthread_mutex_t lock;		/* protects job queue and stop */
+  pthread_cond_t cond;
+  struct worker_job *head;	/* submitted, not picked up yet */
+  struct worker_job *tail;
+  int stop;
+  pthread_t id[];
+};
+
+/* Push completed job, lock-free as any number of workers may complete
+ * at once.  Master takes the whole stack at once, so there is no ABA. */
+static void
+worker_pool_post (struct worker_pool *wp, struct worker_job *job)
+{
+  struct worker_job *head;
+  u_int64_t one = 1;
+
+  do
+    {
+      head = wp->done;
+      job->next = head;
+    }
+  while (!__sync_bool_compare_and_swap (&wp->done, head, job));
+
+  /* whoever pushed onto empty stack wakes master up, master can not miss
+   * it since it reads wakeup before taking the stack; wakeup pending
+   * already when write fails with EAGAIN */
+  if (head == NULL)
+    while (write (wp->wakeup_fd[1], &one, sizeof (one)) < 0 && errno == EINTR)
+      ;
+}
+
+static void *
+worker_pool_thread (void *arg)
+{
+  struct worker_pool *wp = arg;
+  struct worker_threads *wt = wp->threads;
+  struct worker_job *job;
+
+  while (1)
+    {
+      pthread_mutex_lock (&wt->lock);
+      while (!wt->stop && !wt->head)
+	pthread_cond_wait (&wt->cond, &wt->lock);
+      if (wt->stop)
+	{
+	  pthread_mutex_unlock (&wt->lock);
+	  return NULL;
+	}
+      job = wt->head;
+      wt->head = job->next;
+      if (!wt->head)
+	wt->tail = NULL;
+      pthread_mutex_unlock (&wt->lock);
+
+      job->work (job->arg);
+      worker_pool_post (wp, job);
+    }
+}
+
+/* Post completion events of jobs finished by workers. */
+static int
+worker_pool_wakeup (struct thread *thread)
+{
+  struct worker_pool *wp = THREAD_ARG (thread);
+  struct worker_job *job;
+  struct worker_job *next;
+  struct worker_job *fifo = NULL;
+  char buf[64];
+
+  wp->t_wakeup = NULL;
+
+  /* drain eventfd counter, or pipe */
+  while (read (wp->wakeup_fd[0], buf, sizeof (buf)) > 0)
+    if (wp->wakeup_fd[0] == wp->wakeup_fd[1])
+      break;
+
+  /* take all completed jobs, and restore completion order */
+  for (job = __sync_lock_test_and_set (&wp->done, NULL); job; job = next)
+    {
+      next = job->next;
+      job->next = fifo;
+      fifo = job;
+    }
+
+  for (job = fifo; job; job = next)
+    {
+      next = job->next;
+      thread_add_event (wp->master, job->done, job->arg, 0);
+      wp->pending--;
+      wp->runs++;
+      XFREE (MTYPE_WORKER_JOB, job);
+    }
+
+  wp->t_wakeup = thread_add_read (wp->master, worker_pool_wakeup, wp,
+				  wp->wakeup_fd[0]);
+  return 0;
+}
+
+static int
+worker_pool_wakeup_open (struct worker_pool *wp)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+  wp->wakeup_fd[0] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wp->wakeup_fd[0] >= 0)
+    {
+      wp->wakeup_fd[1] = wp->wakeup_fd[0];
+      return 0;
+    }
+#endif /* HAVE_SYS_EVENTFD_H */
+  if (pipe (wp->wakeup_fd) < 0)
+    return -1;
+  set_nonblocking (wp->wakeup_fd[0]);
+  set_nonblocking (wp->wakeup_fd[1]);
+  return 0;
+}
+
+static void
+worker_pool_wakeup_close (struct worker_pool *wp)
+{
+  if (wp->wakeup_fd[1] != wp->wakeup_fd[0])
+    close (wp->wakeup_fd[1]);
+  close (wp->wakeup_fd[0]);
+}
+
+/* Stop and join first n threads of pool. */
+static void
+worker_pool_stop (struct worker_pool *wp, int n)
+{
+  struct worker_threads *wt = wp->threads;
+  int i;
+
+  pthread_mutex_lock (&wt->lock);
+  wt->stop = 1;
+  pthread_cond_broadcast (&wt->cond);
+  pthread_mutex_unlock (&wt->lock);
+
+  for (i = 0; i < n; i++)
+    pthread_join (wt->id[i], NULL);
+}
+#endif /* HAVE_PTHREAD */
+
+/* create new worker pool */
+struct worker_pool *
+worker_pool_new (struct thread_master *m, const char *name, int workers)
+{
+  struct worker_pool *new;
+#ifdef HAVE_PTHREAD
+  struct worker_threads *wt;
+  sigset_t all, old;
+  int i;
+  int ret = 0;
+#endif
+
+  new = XCALLOC (MTYPE_WORKER_POOL, sizeof (struct worker_pool));
+  new->name = XSTRDUP (MTYPE_WORKER_POOL, name);
+  new->master = m;
+  new->wakeup_fd[0] = new->wakeup_fd[1] = -1;
+
+#ifdef HAVE_PTHREAD
+  if (workers <= 0)
+    return new;
+
+  if (worker_pool_wakeup_open (new) < 0)
+    {
+      zlog_warn ("worker pool %s: wakeup: %s", name, safe_strerror (errno));
+      goto fail;
+    }
+
+  wt = XCALLOC (MTYPE_WORKER_POOL,
+		sizeof (struct worker_threads) + workers * sizeof (pthread_t));
+  pthread_mutex_init (&wt->lock, NULL);
+  pthread_cond_init (&wt->cond, NULL);
+  new->threads = wt;
+
+  /* signals are handled by the daemon's thread only */
+  sigfillset (&all);
+  pthread_sigmask (SIG_SETMASK, &all, &old);
+  for (i = 0; i < workers; i++)
+    if ((ret = pthread_create (&wt->id[i], NULL, worker_pool_thread, new)))
+      break;
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+
+  if (ret)
+    {
+      zlog_warn ("worker pool %s: thread: %s", name, safe_strerror (ret));
+      worker_pool_stop (new, i);
+      pthread_cond_destroy (&wt->cond);
+      pthread_mutex_destroy (&wt->lock);
+      XFREE (MTYPE_WORKER_POOL, wt);
+      worker_pool_wakeup_close (new);
+      goto fail;
+    }
+  new->workers = workers;
+
+  new->t_wakeup = thread_add_read (m, worker_pool_wakeup, new,
+				   new->wakeup_fd[0]);
+  return new;
+
+ fail:
+  XFREE (MTYPE_WORKER_POOL, new->name);
+  XFREE (MTYPE_WORKER_POOL, new);
+  return NULL;
+#else
+  return new;
+#endif /* HAVE_PTHREAD */
+}
+
+/* destroy worker pool */
+void
+worker_pool_free (struct worker_pool *wp)
+{
+#ifdef HAVE_PTHREAD
+  struct worker_threads *wt = wp->threads;
+  struct worker_job *job;
+  struct worker_job *next;
+
+  if (wt)
+    {
+      worker_pool_stop (wp, wp->workers);
+
+      for (job = wt->head; job; job = next)
+	{
+	  next = job->next;
+	  XFREE (MTYPE_WORKER_JOB, job);
+	}
+      for (job = wp->done; job; job = next)
+	{
+	  next = job->next;
+	  XFREE (MTYPE_WORKER_JOB, job);
+	}
+
+      THREAD_READ_OFF (wp->t_wakeup);
+      worker_pool_wakeup_close (wp);
+      pthread_cond_destroy (&wt->cond);
+      pthread_mutex_destroy (&wt->lock);
+      XFREE (MTYPE_WORKER_POOL, wt);
+    }
+#endif /* HAVE_PTHREAD */
+
+  XFREE (MTYPE_WORKER_POOL, wp->name);
+  XFREE (MTYPE_WORKER_POOL, wp);
+}
+
+/* Submit job to pool */
+void
+worker_pool_submit (struct worker_pool *wp, void (*work) (void *),
+		    int (*done) (struct thread *), void *arg)
+{
+#ifdef HAVE_PTHREAD
+  struct worker_threads *wt = wp->threads;
+  struct worker_job *job;
+
+  if (wt)
+    {
+      job = XCALLOC (MTYPE_WORKER_JOB, sizeof (struct worker_job));
+      job->work = work;
+      job->done = done;
+      job->arg = arg;
+      wp->pending++;
+
+      pthread_mutex_lock (&wt->lock);
+      if (wt->tail)
+	wt->tail->next = job;
+      else
+	wt->head = job;
+      wt->tail = job;
+      pthread_cond_signal (&wt->cond);
+      pthread_mutex_unlock (&wt->lock);
+      return;
+    }
+#endif /* HAVE_PTHREAD */
+
+  /* no threads, do it now */
+  work (arg);
+  thread_add_event (wp->master, done, arg, 0);
+  wp->runs++;
+}
@@ -0,0 +1,76 @@
+/*
+ * Quagga Worker Pools.
+ *
+ * This file is part of Quagga.
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.  
+ */
+
+#ifndef _QUAGGA_WORKER_POOL_H
+#define _QUAGGA_WORKER_POOL_H
+
+/* Worker pools run compute jobs on POSIX threads, off the thread_master
+ * of the daemon, and post completion of each job back to that master as
+ * an event.
+ *
+ * Work function runs concurrently with the daemon and with other jobs.
+ * It may only touch data handed to it in its argument, which the daemon
+ * must leave alone until the job completes; it must not call into lib
+ * (memory, log, thread, stream, ...), none of which is thread-safe.
+ * Completion function runs as an ordinary event thread, with THREAD_ARG
+ * being the job argument, and is where results are consumed.
+ *
+ * Without thread support jobs are run right away on submission, so
+ * callers need no separate code path.
+ */
+
+struct worker_job;
+struct worker_threads;
+
+struct worker_pool
+{
+  /* the following may be read */
+  struct thread_master *master;		/* completions are posted here */
+  char *name;
+  int workers;				/* number of threads */
+  unsigned long pending;		/* jobs not completed yet */
+  unsigned long runs;			/* jobs completed */
+
+  /* remaining fields are private */
+  struct thread *t_wakeup;
+  int wakeup_fd[2];			/* eventfd, or pipe read/write ends */
+  struct worker_job *done;		/* completed, lock-free LIFO */
+  struct worker_threads *threads;	/* threads and their job queue */
+};
+
+/* User API */
+
+/* create a worker pool of given name and number of threads, completions
+ * are posted to thread_master; NULL if threads could not be started */
+extern struct worker_pool *worker_pool_new (struct thread_master *,
+                                            const char *, int);
+/* stop threads, waiting for running jobs; completion function is not
+ * called for jobs which did not complete yet, their arguments stay with
+ * the caller */
+extern void worker_pool_free (struct worker_pool *);
+
+/* run work function with argument on a worker, then schedule completion
+ * function with the same argument on master of the pool */
+extern void worker_pool_submit (struct worker_pool *,
+                                void (*work) (void *),
+                                int (*done) (struct thread *), void *);
+
+#endif /* _QUAGGA_WORKER_POOL_H */
@@ -0,0 +1,273 @@
+/*
+ * Test program to verify that access-lists match as a linear walk of
+ * their filters would.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "memory.h"
+#include "vty.h"
+#include "vector.h"
+#include "prefix.h"
+#include "filter.h"
+#include "prng.h"
+
+#define FILTERS 600
+#define LOOKUPS 50000
+
+struct thread_master *master;
+
+/* Filters as configured, in access list order. */
+struct test_filter
+{
+  int cisco;
+  int extended;
+  int permit;
+  int exact;
+  struct in_addr addr;
+  struct in_addr addr_mask;
+  struct in_addr mask;
+  struct in_addr mask_mask;
+  struct prefix p;
+};
+
+struct test_list
+{
+  const char *name;
+  int count;
+  struct test_filter filters[FILTERS];
+};
+
+static struct test_list lists[] =
+{
+  { "1" },	/* standard */
+  { "100" },	/* extended */
+  { "zebra" },
+};
+
+static struct vty *vty;
+
+static const char *wildcards[] =
+{
+  "0.0.0.0", "0.0.0.255", "0.0.255.255", "0.255.255.255", "0.0.255.0",
+  "0.0.3.255",
+};
+static const char *masks[] =
+{
+  "255.255.0.0", "255.255.255.0", "255.255.255.255", "255.0.0.0",
+};
+
+static void command(const char *fmt, ...)
+{
+  char line[256];
+  va_list args;
+  vector vline;
+
+  va_start(args, fmt);
+  vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+
+  vline = cmd_make_strvec(line);
+  if (cmd_execute_command(vline, vty, NULL, 0) != CMD_SUCCESS)
+    {
+      fprintf(stderr, "Command failed: %s\n", line);
+      exit(1);
+    }
+  cmd_free_strvec(vline);
+}
+
+/* prng_rand() always leaves the lowest bit clear, shift it out */
+static unsigned int random_bits(struct prng *prng)
+{
+  return prng_rand(prng) >> 1;
+}
+
+static void random_addr(struct prng *prng, struct in_addr *addr)
+{
+  /* few first octets, so that filters overlap */
+  addr->s_addr = htonl((10 << 24) | ((random_bits(prng) % 4) << 16)
+                       | (random_bits(prng) & 0xffff));
+}
+
+static int filter_same(struct test_filter *a, struct test_filter *b)
+{
+  if (a->cisco != b->cisco || a->permit != b->permit)
+    return 0;
+  if (!a->cisco)
+    return a->exact == b->exact && prefix_same(&a->p, &b->p);
+  return a->extended == b->extended
+         && a->addr.s_addr == b->addr.s_addr
+         && a->addr_mask.s_addr == b->addr_mask.s_addr
+         && a->mask.s_addr == b->mask.s_addr
+         && a->mask_mask.s_addr == b->mask_mask.s_addr;
+}
+
+/* Configure filter and its "no" form, to keep the reference in sync. */
+static void configure(struct test_list *list, struct test_filter *f, int set)
+{
+  char addr[INET_ADDRSTRLEN], addr_mask[INET_ADDRSTRLEN];
+  char mask[INET_ADDRSTRLEN], mask_mask[INET_ADDRSTRLEN];
+  const char *no = set ? "" : "no ";
+  const char *type = f->permit ? "permit" : "deny";
+  int i;
+
+  inet_ntop(AF_INET, &f->addr, addr, sizeof(addr));
+  inet_ntop(AF_INET, &f->addr_mask, addr_mask, sizeof(addr_mask));
+  inet_ntop(AF_INET, &f->mask, mask, sizeof(mask));
+  inet_ntop(AF_INET, &f->mask_mask, mask_mask, sizeof(mask_mask));
+
+  if (!f->cisco)
+    command("%saccess-list %s %s %s/%d%s", no, list->name, type, addr,
+            f->p.prefixlen, f->exact ? " exact-match" : "");
+  else if (f->extended)
+    command("%saccess-list %s %s ip %s %s %s %s", no, list->name, type,
+            addr, addr_mask, mask, mask_mask);
+  else
+    command("%saccess-list %s %s %s %s", no, list->name, type,
+            addr, addr_mask);
+
+  /* addresses are kept masked, as filters do */
+  f->addr.s_addr &= ~f->addr_mask.s_addr;
+  f->mask.s_addr &= ~f->mask_mask.s_addr;
+
+  for (i = 0; i < list->count; i++)
+    if (filter_same(&list->filters[i], f))
+      break;
+
+  if (set && i == list->count)
+    list->filters[list->count++] = *f;
+  else if (!set && i < list->count)
+    {
+      memmove(&list->filters[i], &list->filters[i + 1],
+              (list->count - i - 1) * sizeof(*f));
+      list->count--;
+    }
+}
+
+static void random_filter(struct prng *prng, struct test_list *list,
+                          struct test_filter *f)
+{
+  memset(f, 0, sizeof(*f));
+  f->permit = random_bits(prng) % 2;
+
+  if (strcmp(list->name, "zebra") == 0)
+    {
+      random_addr(prng, &f->addr);
+      f->p.family = AF_INET;
+      f->p.u.prefix4 = f->addr;
+      f->p.prefixlen = 8 + random_bits(prng) % 25;
+      f->exact = random_bits(prng) % 2;
+      return;
+    }
+
+  f->cisco = 1;
+  f->extended = (strcmp(list->name, "100") == 0);
+  random_addr(prng, &f->addr);
+  inet_aton(wildcards[random_bits(prng) % array_size(wildcards)],
+            &f->addr_mask);
+  if (f->extended)
+    {
+      inet_aton(masks[random_bits(prng) % array_size(masks)], &f->mask);
+      inet_aton(wildcards[random_bits(prng) % 4], &f->mask_mask);
+    }
+}
+
+/* What linear walk of filters returns. */
+static enum filter_type reference_apply(struct test_list *list,
+                                        struct prefix *p)
+{
+  struct test_filter *f;
+  struct in_addr mask;
+  int i;
+
+  masklen2ip(p->prefixlen, &mask);
+  for (i = 0; i < list->count; i++)
+    {
+      f = &list->filters[i];
+      if (!f->cisco)
+        {
+          if (!prefix_match(&f->p, p)
+              || (f->exact && f->p.prefixlen != p->prefixlen))
+            continue;
+        }
+      else if ((p->u.prefix4.s_addr & ~f->addr_mask.s_addr) != f->addr.s_addr
+               || (f->extended && (mask.s_addr & ~f->mask_mask.s_addr)
+                                  != f->mask.s_addr))
+        continue;
+      return f->permit ? FILTER_PERMIT : FILTER_DENY;
+    }
+  return FILTER_DENY;
+}
+
+int main(int argc, char **argv)
+{
+  struct test_filter f;
+  struct test_list *list;
+  struct access_list *access;
+  struct prng *prng;
+  struct prefix p;
+  unsigned int l;
+  int i, mismatch = 0;
+
+  cmd_init(1);
+  access_list_init();
+  vty = vty_new();
+  vty->node = CONFIG_NODE;
+  prng = prng_new(0);
+
+  for (l = 0; l < array_size(lists); l++)
+    {
+      list = &lists[l];
+
+      for (i = 0; i < FILTERS; i++)
+        {
+          random_filter(prng, list, &f);
+          configure(list, &f, 1);
+        }
+      /* remove some, so indexes see deletes in between */
+      for (i = 0; i < FILTERS / 10; i++)
+        configure(list, &list->filters[random_bits(prng) % list->count], 0);
+
+      access = access_list_lookup(AFI_IP, list->name);
+      assert(access);
+
+      for (i = 0; i < LOOKUPS; i++)
+        {
+          memset(&p, 0, sizeof(p));
+          p.family = AF_INET;
+          random_addr(prng, &p.u.prefix4);
+          p.prefixlen = random_bits(prng) % (IPV4_MAX_BITLEN + 1);
+          if (access_list_apply(access, &p) != reference_apply(list, &p))
+            mismatch++;
+        }
+    }
+
+  prng_free(prng);
+
+  if (mismatch)
+    {
+      printf("%d of %d lookups differ from linear walk.\n", mismatch,
+             (int) array_size(lists) * LOOKUPS);
+      return 1;
+    }
+  printf("Access-list lookups match linear walk.\n");
+  return 0;
+}
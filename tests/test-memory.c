@@ -46,6 +46,8 @@ int
 main(int argc, char **argv)
 {
   void *a[10];
+  struct mem_pool *pool;
+  struct mem_arena *arena;
   int i;
 
   printf ("malloc x, malloc x, free, malloc x, free free\n\n");
@@ -118,5 +120,63 @@ main(int argc, char **argv)
       XFREE(MTYPE_VTY, a[2]);
       /* alloc == 0, cache valid next request */
     }
+
+  printf ("pool alloc x 10, free, alloc x 10 from free list\n\n");
+  /* objects are accounted to pool type, slabs to pool slab type */
+  pool = mem_pool_new (MTYPE_VTY, 100, 4);
+  for (i = 0; i < TIMES; i++)
+    {
+      a[i] = mem_pool_alloc (pool);
+      memset (a[i], 1, 100);
+    }
+  if (mtype_stats_alloc (MTYPE_VTY) != TIMES
+      || mtype_stats_alloc (MTYPE_MEM_POOL_SLAB) != 3)
+    {
+      printf ("pool accounting wrong\n");
+      return 1;
+    }
+  for (i = 0; i < TIMES; i++)
+    mem_pool_free (pool, a[i]);
+  for (i = 0; i < TIMES; i++)
+    {
+      a[i] = mem_pool_alloc (pool);
+      if (((char *) a[i])[99] != 0)
+        {
+          printf ("pool object not cleared\n");
+          return 1;
+        }
+    }
+  if (mtype_stats_alloc (MTYPE_MEM_POOL_SLAB) != 3)
+    {
+      printf ("pool did not reuse freed objects\n");
+      return 1;
+    }
+  for (i = 0; i < TIMES; i++)
+    mem_pool_free (pool, a[i]);
+  mem_pool_delete (pool);
+
+  printf ("arena alloc, big alloc, reset\n\n");
+  /* reset keeps one chunk, so next round does not allocate again */
+  arena = mem_arena_new (MTYPE_VTY, 1024);
+  for (i = 0; i < TIMES; i++)
+    {
+      a[0] = mem_arena_alloc (arena, 300);
+      memset (a[0], 1, 300);
+      a[1] = mem_arena_alloc (arena, 4096);
+      memset (a[1], 1, 4096);
+      mem_arena_reset (arena);
+      if (mtype_stats_alloc (MTYPE_VTY) != 1)
+        {
+          printf ("arena reset kept %lu chunks\n",
+                  mtype_stats_alloc (MTYPE_VTY));
+          return 1;
+        }
+    }
+  mem_arena_delete (arena);
+  if (mtype_stats_alloc (MTYPE_VTY) != 0)
+    {
+      printf ("arena chunks leaked\n");
+      return 1;
+    }
   return 0;
 }
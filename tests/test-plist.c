@@ -0,0 +1,175 @@
+/*
+ * Test program to verify that prefix-lists match as a linear walk of
+ * their entries by seq would.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "prefix.h"
+#include "plist.h"
+#include "prng.h"
+
+#define ENTRIES 2000
+#define LOOKUPS 50000
+
+struct thread_master *master;
+
+/* non-const, as prefix_bgp_orf_set() takes it */
+static char name[] = "test";
+
+/* Entries as installed, indexed by seq / 5. */
+struct entry
+{
+  int installed;
+  int permit;
+  struct orf_prefix orf;
+};
+
+static struct entry entries[ENTRIES];
+
+/* prng_rand() always leaves the lowest bit clear, shift it out */
+static unsigned int random_bits(struct prng *prng)
+{
+  return prng_rand(prng) >> 1;
+}
+
+static void random_prefix(struct prng *prng, struct prefix *p, int minlen)
+{
+  memset(p, 0, sizeof(*p));
+  p->family = AF_INET;
+  /* few first octets, so that entries overlap */
+  p->u.prefix4.s_addr = htonl((10 << 24) | ((random_bits(prng) % 4) << 16)
+                              | (random_bits(prng) & 0xffff));
+  p->prefixlen = minlen + random_bits(prng) % (IPV4_MAX_BITLEN + 1 - minlen);
+}
+
+static void install(struct prng *prng, int i)
+{
+  struct entry *e = &entries[i];
+
+  e->orf.seq = (i + 1) * 5;
+  random_prefix(prng, &e->orf.p, 8);
+  apply_mask(&e->orf.p);
+  e->orf.ge = e->orf.le = 0;
+  if (random_bits(prng) % 2 && e->orf.p.prefixlen < IPV4_MAX_BITLEN)
+    {
+      e->orf.le = e->orf.p.prefixlen + 1
+                  + random_bits(prng) % (IPV4_MAX_BITLEN - e->orf.p.prefixlen);
+      if (random_bits(prng) % 2)
+        e->orf.ge = e->orf.p.prefixlen + 1
+                    + random_bits(prng) % (e->orf.le - e->orf.p.prefixlen);
+    }
+  e->permit = random_bits(prng) % 2;
+  e->installed = (prefix_bgp_orf_set(name, AFI_IP, &e->orf, e->permit, 1)
+                  == CMD_SUCCESS);
+}
+
+static void uninstall(int i)
+{
+  struct entry *e = &entries[i];
+
+  if (!e->installed)
+    return;
+  assert(prefix_bgp_orf_set(name, AFI_IP, &e->orf, e->permit, 0)
+         == CMD_SUCCESS);
+  e->installed = 0;
+}
+
+/* What linear walk of entries by seq returns. */
+static enum prefix_list_type reference_apply(struct prefix *p)
+{
+  struct entry *e;
+  int i;
+
+  for (i = 0; i < ENTRIES; i++)
+    {
+      e = &entries[i];
+      if (!e->installed || !prefix_match(&e->orf.p, p))
+        continue;
+      if (!e->orf.le && !e->orf.ge)
+        {
+          if (e->orf.p.prefixlen != p->prefixlen)
+            continue;
+        }
+      else if ((e->orf.le && p->prefixlen > e->orf.le)
+               || (e->orf.ge && p->prefixlen < e->orf.ge))
+        continue;
+      return e->permit ? PREFIX_PERMIT : PREFIX_DENY;
+    }
+  return PREFIX_DENY;
+}
+
+int main(int argc, char **argv)
+{
+  struct prefix_list *plist;
+  struct prng *prng;
+  struct prefix p;
+  int i, order[ENTRIES];
+  int mismatch = 0;
+
+  prng = prng_new(0);
+
+  /* install in random order, so entries are inserted in between */
+  for (i = 0; i < ENTRIES; i++)
+    order[i] = i;
+  for (i = ENTRIES - 1; i > 0; i--)
+    {
+      int j = random_bits(prng) % (i + 1);
+      int tmp = order[i];
+
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+  for (i = 0; i < ENTRIES; i++)
+    install(prng, order[i]);
+
+  /* replace some by seq, remove some */
+  for (i = 0; i < ENTRIES / 10; i++)
+    {
+      int index = random_bits(prng) % ENTRIES;
+
+      uninstall(index);
+      install(prng, index);
+    }
+  for (i = 0; i < ENTRIES / 10; i++)
+    uninstall(random_bits(prng) % ENTRIES);
+
+  plist = prefix_list_lookup(AFI_ORF_PREFIX, name);
+  assert(plist);
+
+  for (i = 0; i < LOOKUPS; i++)
+    {
+      random_prefix(prng, &p, 0);
+      if (prefix_list_apply(plist, &p) != reference_apply(&p))
+        mismatch++;
+    }
+
+  prefix_bgp_orf_remove_all(name);
+  prng_free(prng);
+
+  if (mismatch)
+    {
+      printf("%d of %d lookups differ from linear walk.\n", mismatch, LOOKUPS);
+      return 1;
+    }
+  printf("Prefix-list lookups match linear walk.\n");
+  return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Test program to verify that read and write threads are run when their
+ * file descriptors become ready, and not after they are cancelled.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "thread.h"
+
+#define SOCKET_PAIRS 64
+
+struct thread_master *master;
+
+static int sv[SOCKET_PAIRS][2];
+static struct thread *readers[SOCKET_PAIRS];
+
+static int reads_pending;
+static int reads_done;
+static int writes_done;
+static int failed;
+
+static void terminate_test(void)
+{
+  int i;
+
+  for (i = 0; i < SOCKET_PAIRS; i++)
+    {
+      THREAD_OFF(readers[i]);
+      close(sv[i][0]);
+      close(sv[i][1]);
+    }
+  thread_master_free(master);
+
+  if (failed || reads_done != SOCKET_PAIRS / 2 || writes_done != 1)
+    {
+      fprintf(stderr, "Unexpected I/O: %d reads, %d writes, %d failures\n",
+              reads_done, writes_done, failed);
+      exit(1);
+    }
+  printf("I/O threads run as expected.\n");
+  exit(0);
+}
+
+static int read_func(struct thread *thread)
+{
+  int i = (long)THREAD_ARG(thread);
+  char c;
+
+  readers[i] = NULL;
+  /* only odd sockets were written to */
+  if (!(i % 2) || read(THREAD_FD(thread), &c, 1) != 1 || c != (char)i)
+    failed++;
+  reads_done++;
+
+  if (--reads_pending == 0)
+    terminate_test();
+  return 0;
+}
+
+static int write_func(struct thread *thread)
+{
+  int i;
+  char c;
+
+  writes_done++;
+  /* readers are registered already, make odd ones ready */
+  for (i = 1; i < SOCKET_PAIRS; i += 2)
+    {
+      c = i;
+      if (write(sv[i][1], &c, 1) != 1)
+        failed++;
+    }
+  return 0;
+}
+
+static int timeout_func(struct thread *thread)
+{
+  fprintf(stderr, "Timed out waiting for I/O\n");
+  failed++;
+  terminate_test();
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  struct thread t;
+  long i;
+
+  master = thread_master_create();
+
+  for (i = 0; i < SOCKET_PAIRS; i++)
+    {
+      if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]) < 0)
+        {
+          perror("socketpair");
+          return 1;
+        }
+      readers[i] = thread_add_read(master, read_func, (void *)i, sv[i][0]);
+      assert(readers[i]);
+    }
+  /* second reader of one fd is refused */
+  assert(!thread_add_read(master, read_func, NULL, sv[0][0]));
+
+  /* even readers are cancelled and must never run, some get data anyway */
+  for (i = 0; i < SOCKET_PAIRS; i += 2)
+    {
+      thread_cancel(readers[i]);
+      readers[i] = NULL;
+      if (i % 4 == 0 && write(sv[i][1], "x", 1) != 1)
+        return 1;
+    }
+  reads_pending = SOCKET_PAIRS / 2;
+
+  /* write thread on a fd which also has a reader */
+  thread_add_write(master, write_func, NULL, sv[1][0]);
+  thread_add_timer(master, timeout_func, NULL, 5);
+
+  while (thread_fetch(master, &t))
+    thread_call(&t);
+
+  return 0;
+}
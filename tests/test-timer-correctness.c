@@ -54,20 +54,21 @@ static struct thread **timers;
 
 static int timers_pending;
 
-static void terminate_test(void)
+static int terminate_test(const char *name)
 {
   int exit_code;
 
   if (strcmp(log_buf, expected_buf))
     {
-      fprintf(stderr, "Expected output and received output differ.\n");
+      fprintf(stderr, "%s: Expected output and received output differ.\n",
+              name);
       fprintf(stderr, "---Expected output: ---\n%s", expected_buf);
       fprintf(stderr, "---Actual output: ---\n%s", log_buf);
       exit_code = 1;
     }
   else
     {
-      printf("Expected output and actual output match.\n");
+      printf("%s: Expected output and actual output match.\n", name);
       exit_code = 0;
     }
 
@@ -77,7 +78,7 @@ static void terminate_test(void)
   prng_free(prng);
   XFREE(MTYPE_TMP, timers);
 
-  exit(exit_code);
+  return exit_code;
 }
 
 static int timer_func(struct thread *thread)
@@ -92,8 +93,6 @@ static int timer_func(struct thread *thread)
   XFREE(MTYPE_TMP, thread->arg);
 
   timers_pending--;
-  if (!timers_pending)
-    terminate_test();
 
   return 0;
 }
@@ -110,13 +109,14 @@ static int cmp_timeval(const void* a, const void *b)
   return 0;
 }
 
-int main(int argc, char **argv)
+static int run_test(const char *name, enum thread_timer_backend backend)
 {
   int i, j;
   struct thread t;
   struct timeval **alarms;
 
   master = thread_master_create();
+  thread_master_set_timer_backend(master, backend);
 
   log_buf_len = SCHEDULE_TIMERS * (TIMESTR_LEN + 1) + 1;
   log_buf_pos = 0;
@@ -187,8 +187,15 @@ int main(int argc, char **argv)
     }
   XFREE(MTYPE_TMP, alarms);
 
-  while (thread_fetch(master, &t))
+  while (timers_pending && thread_fetch(master, &t))
     thread_call(&t);
 
-  return 0;
+  return terminate_test(name);
+}
+
+int main(int argc, char **argv)
+{
+  if (run_test("heap", THREAD_TIMER_HEAP))
+    return 1;
+  return run_test("wheel", THREAD_TIMER_WHEEL);
 }
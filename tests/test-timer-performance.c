@@ -41,7 +41,7 @@ static int dummy_func(struct thread *thread)
   return 0;
 }
 
-int main(int argc, char **argv)
+static void run_benchmark(const char *name, enum thread_timer_backend backend)
 {
   struct prng *prng;
   int i;
@@ -50,6 +50,7 @@ int main(int argc, char **argv)
   unsigned long t_schedule, t_remove;
 
   master = thread_master_create();
+  thread_master_set_timer_backend(master, backend);
   prng = prng_new(0);
   timers = calloc(SCHEDULE_TIMERS, sizeof(*timers));
 
@@ -91,14 +92,20 @@ int main(int argc, char **argv)
   t_remove = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
   t_remove += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
 
-  printf("Scheduling %d random timers took %ld.%03ld seconds.\n",
-         SCHEDULE_TIMERS, t_schedule/1000, t_schedule%1000);
-  printf("Removing %d random timers took %ld.%03ld seconds.\n",
-         REMOVE_TIMERS, t_remove/1000, t_remove%1000);
+  printf("%s: Scheduling %d random timers took %ld.%03ld seconds.\n",
+         name, SCHEDULE_TIMERS, t_schedule/1000, t_schedule%1000);
+  printf("%s: Removing %d random timers took %ld.%03ld seconds.\n",
+         name, REMOVE_TIMERS, t_remove/1000, t_remove%1000);
   fflush(stdout);
 
   free(timers);
   thread_master_free(master);
   prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+  run_benchmark("heap", THREAD_TIMER_HEAP);
+  run_benchmark("wheel", THREAD_TIMER_WHEEL);
   return 0;
 }
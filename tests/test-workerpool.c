@@ -0,0 +1,105 @@
+/*
+ * Test program to verify that worker pool jobs run and post their
+ * completions back to the thread master.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "thread.h"
+#include "workerpool.h"
+
+#define WORKERS 4
+#define JOBS    10000
+
+struct thread_master *master;
+
+struct job
+{
+  unsigned long input;
+  unsigned long result;
+};
+
+static struct job jobs[JOBS];
+static int jobs_pending;
+static int failed;
+
+/* some compute, so workers actually overlap */
+static void work_func(void *arg)
+{
+  struct job *job = arg;
+  unsigned long i;
+
+  job->result = 0;
+  for (i = 0; i <= job->input; i++)
+    job->result += i;
+}
+
+static int done_func(struct thread *thread)
+{
+  struct job *job = THREAD_ARG(thread);
+
+  if (job->result != job->input * (job->input + 1) / 2)
+    failed++;
+  jobs_pending--;
+  return 0;
+}
+
+static int run_test(const char *name, int workers)
+{
+  struct worker_pool *wp;
+  struct thread t;
+  int i;
+
+  wp = worker_pool_new(master, name, workers);
+  assert(wp);
+
+  jobs_pending = JOBS;
+  failed = 0;
+  for (i = 0; i < JOBS; i++)
+    {
+      jobs[i].input = i;
+      worker_pool_submit(wp, work_func, done_func, &jobs[i]);
+    }
+
+  while (jobs_pending && thread_fetch(master, &t))
+    thread_call(&t);
+
+  if (failed || wp->pending || wp->runs != JOBS)
+    {
+      fprintf(stderr, "%s: %d wrong results, %lu jobs pending\n",
+              name, failed, wp->pending);
+      return 1;
+    }
+  worker_pool_free(wp);
+  printf("%s: All jobs completed.\n", name);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  master = thread_master_create();
+
+  if (run_test("threads", WORKERS) || run_test("inline", 0))
+    return 1;
+
+  thread_master_free(master);
+  return 0;
+}